@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Minimal timing harness for the benchmark suites.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+namespace bench {
+
+//------------------------------------------------------------------------------
+//! Wall clock timer; std::chrono::high_resolution_clock has a coarse
+//! resolution on MSVC 2012, so this uses the performance counter directly.
+//------------------------------------------------------------------------------
+class timer {
+public:
+    timer() {
+        ::LARGE_INTEGER freq;
+        ::QueryPerformanceFrequency(&freq);
+        frequency_ = static_cast<double>(freq.QuadPart);
+
+        reset();
+    }
+
+    void reset() {
+        ::QueryPerformanceCounter(&start_);
+    }
+
+    //! Seconds since construction or the last reset.
+    double elapsed() const {
+        ::LARGE_INTEGER now;
+        ::QueryPerformanceCounter(&now);
+
+        return static_cast<double>(now.QuadPart - start_.QuadPart) / frequency_;
+    }
+private:
+    ::LARGE_INTEGER start_;
+    double          frequency_;
+};
+
+//------------------------------------------------------------------------------
+//! Prevent the optimizer from discarding a computed value.
+//------------------------------------------------------------------------------
+template <typename T>
+inline void keep(T const& value) {
+    static char volatile sink;
+    sink = *reinterpret_cast<char const volatile*>(&value);
+}
+
+//------------------------------------------------------------------------------
+//! Call @c f repeatedly, doubling the batch size until a batch runs for at
+//! least @c min_time seconds, and print the time per call.
+//! @param items
+//!     Work items processed per call (rects, pixels, ...); if non zero the
+//!     throughput is printed as well.
+//! @param bytes
+//!     Bytes processed per call; if non zero MB/s is printed as well.
+//------------------------------------------------------------------------------
+template <typename F>
+double run(
+    char const* name,
+    F&&         f,
+    double      items    = 0.0,
+    double      bytes    = 0.0,
+    double      min_time = 0.25
+) {
+    f(); // warm up
+
+    size_t iterations = 1;
+    double elapsed    = 0.0;
+
+    for (;;) {
+        timer t;
+        for (size_t i = 0; i < iterations; ++i) {
+            f();
+        }
+        elapsed = t.elapsed();
+
+        if (elapsed >= min_time) break;
+        iterations *= 2;
+    }
+
+    auto const per_call = elapsed / static_cast<double>(iterations);
+
+    std::printf("%-44s %12.3f us", name, per_call * 1.0e6);
+    if (items > 0.0) {
+        std::printf(" %10.3f M items/s", items / per_call / 1.0e6);
+    }
+    if (bytes > 0.0) {
+        std::printf(" %10.1f MB/s", bytes / per_call / (1024.0 * 1024.0));
+    }
+    std::printf("\n");
+
+    return per_call;
+}
+
+//------------------------------------------------------------------------------
+// Suites.
+//------------------------------------------------------------------------------
+void broadphase_benchmarks();
+void image_benchmarks();
+void kd_tree_benchmarks();
+void rect_benchmarks();
+void region_benchmarks();
+
+} //namespace bench
@@ -0,0 +1,82 @@
+#include "pch.hpp"
+#include "benchmark.hpp"
+
+#include "common/broadphase.hpp"
+
+namespace {
+
+typedef bklib::math::broadphase<float> broadphase_t;
+typedef broadphase_t::rect_t           rect_t;
+
+//! @c n windows of 32 to 256 pixels a side scattered over an area scaled so
+//! that the density stays the same as @c n grows.
+std::vector<rect_t> make_rects(size_t n, std::mt19937& gen) {
+    auto const extent = static_cast<float>(std::sqrt(static_cast<double>(n)) * 256.0);
+
+    std::uniform_real_distribution<float> pos(0.0f, extent);
+    std::uniform_real_distribution<float> size(32.0f, 256.0f);
+
+    std::vector<rect_t> result;
+    result.reserve(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        auto const x = pos(gen);
+        auto const y = pos(gen);
+        result.push_back(rect_t(x, y, x + size(gen), y + size(gen)));
+    }
+
+    return result;
+}
+
+void run_frames(size_t n) {
+    std::mt19937 gen(1);
+    auto rects = make_rects(n, gen);
+
+    broadphase_t bp;
+    std::vector<broadphase_t::id_t> ids;
+    for (auto const& r : rects) {
+        ids.push_back(bp.insert(r));
+    }
+
+    std::printf("  n=%u: %u overlapping pairs\n",
+        static_cast<unsigned>(n), static_cast<unsigned>(bp.find_pairs().size())
+    );
+
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::uniform_real_distribution<float> step(-4.0f, 4.0f);
+
+    char name[64];
+
+    // each frame 5% of the windows are dragged a few pixels
+    std::sprintf(name, "sweep and prune, 5%% moving n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        for (size_t i = 0; i < n / 20; ++i) {
+            auto const j = pick(gen);
+            rects[j].translate(step(gen), step(gen));
+            bp.update(ids[j], rects[j]);
+        }
+
+        bench::keep(bp.find_pairs().size());
+    }, static_cast<double>(n));
+
+    std::sprintf(name, "naive pairwise n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        size_t count = 0;
+
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                count += bklib::math::intersects(rects[i], rects[j]);
+            }
+        }
+
+        bench::keep(count);
+    }, static_cast<double>(n));
+}
+
+} //namespace
+
+void bench::broadphase_benchmarks() {
+    run_frames(1000);
+    run_frames(4000);
+    run_frames(16000);
+}
@@ -0,0 +1,215 @@
+#include "pch.hpp"
+#include "benchmark.hpp"
+
+#include "gfx/targa.hpp"
+#include "gfx/targa_writer.hpp"
+#include "gfx/pixel_convert.hpp"
+#include "util/file_util.hpp"
+#include "util/cpu.hpp"
+
+namespace {
+
+namespace gfx = ::bklib::gfx;
+namespace tga = ::bklib::tga;
+
+typedef gfx::pixel_format format_t;
+
+size_t const CONVERT_PIXELS = 1 << 20;
+
+struct format_info {
+    char const* name;
+    format_t    format;
+};
+
+format_info const FORMATS[] = {
+    {"gray8",  format_t::gray8},
+    {"bgr5a1", format_t::bgr5a1},
+    {"bgr8",   format_t::bgr8},
+    {"bgra8",  format_t::bgra8},
+};
+
+unsigned const SIZES[] = {256, 2048};
+
+//------------------------------------------------------------------------------
+//! A w by h image of flat blocks with noisy rows scattered through them, so
+//! that run length encoding finds both runs and raw packets.
+//------------------------------------------------------------------------------
+std::vector<uint8_t> make_pixels(unsigned w, unsigned h, size_t bpp, std::mt19937& gen) {
+    std::uniform_int_distribution<unsigned> byte(0, 255);
+
+    std::vector<uint8_t> result(w * h * bpp);
+
+    for (unsigned y = 0; y < h; ++y) {
+        auto const row   = result.data() + y * w * bpp;
+        auto const noisy = y % 8 == 0;
+
+        for (unsigned x = 0; x < w; ++x) {
+            for (size_t c = 0; c < bpp; ++c) {
+                row[x * bpp + c] = noisy
+                    ? static_cast<uint8_t>(byte(gen))
+                    : static_cast<uint8_t>((x / 32 * 37 + y / 32 * 91 + c * 53) & 0xFF);
+            }
+        }
+    }
+
+    return result;
+}
+
+//! A directory of our own under the user's temp directory.
+bklib::utf8string make_temp_directory() {
+    wchar_t buffer[MAX_PATH + 1];
+    auto const length = ::GetTempPathW(MAX_PATH + 1, buffer);
+
+    auto path = bklib::utf8_16_converter().to_bytes(buffer, buffer + length);
+    path += "bklib_benchmark\\";
+
+    bklib::create_directory(path);
+
+    return path;
+}
+
+//------------------------------------------------------------------------------
+//! Load and decode throughput for one synthetic file; MB/s are of decoded
+//! output. The difference between the bottom up and top down lines is the
+//! cost of the flip.
+//------------------------------------------------------------------------------
+void run_file(
+    bklib::utf8string const& directory,
+    format_info const&       info,
+    unsigned                 size,
+    bool                     rle,
+    bool                     top_down,
+    std::mt19937&            gen,
+    std::vector<bklib::utf8string>& files
+) {
+    auto const bpp    = gfx::bytes_per_pixel(info.format);
+    auto const pixels = make_pixels(size, size, bpp, gen);
+
+    char name[64];
+    std::sprintf(name, "%s_%u_%s_%s",
+        info.name, size, rle ? "rle" : "raw", top_down ? "top" : "bottom"
+    );
+
+    auto const filename = directory + name + ".tga";
+    tga::write(filename, pixels.data(), size, size, static_cast<ptrdiff_t>(size * bpp),
+        info.format, rle, top_down
+    );
+    files.push_back(filename);
+
+    auto const count = static_cast<double>(size) * size;
+
+    std::vector<uint8_t> native(pixels.size());
+    std::vector<uint8_t> bgra(static_cast<size_t>(count) * 4);
+
+    char line[96];
+
+    // maps the file afresh and decodes each time. The file was just written,
+    // so its pages are in the OS file cache; this is the cost of mapping and
+    // first touch rather than of reading the disk.
+    std::sprintf(line, "%s load+decode (warm cache)", name);
+    bench::run(line, [&] {
+        tga::image const image(filename);
+        image.decode(native.data(), size * bpp, info.format);
+        bench::keep(native[0]);
+    }, count, static_cast<double>(native.size()));
+
+    tga::image const image(filename);
+
+    std::sprintf(line, "%s warm decode", name);
+    bench::run(line, [&] {
+        image.decode(native.data(), size * bpp, info.format);
+        bench::keep(native[0]);
+    }, count, static_cast<double>(native.size()));
+
+    std::sprintf(line, "%s warm decode bgra8", name);
+    bench::run(line, [&] {
+        image.decode(bgra.data(), size * 4, format_t::bgra8);
+        bench::keep(bgra[0]);
+    }, count, static_cast<double>(bgra.size()));
+}
+
+//------------------------------------------------------------------------------
+//! Throughput of one conversion kernel over CONVERT_PIXELS pixels; MB/s are
+//! of input.
+//------------------------------------------------------------------------------
+template <typename src, typename dest>
+void run_convert(char const* name, std::mt19937& gen) {
+    std::vector<uint8_t> in(CONVERT_PIXELS * src::bytes);
+    std::vector<uint8_t> out(CONVERT_PIXELS * dest::bytes);
+
+    std::uniform_int_distribution<unsigned> byte(0, 255);
+    for (auto& b : in) {
+        b = static_cast<uint8_t>(byte(gen));
+    }
+
+    bench::run(name, [&] {
+        gfx::convert<src, dest>(
+            in.data(),  in.data()  + in.size(),
+            out.data(), out.data() + out.size()
+        );
+        bench::keep(out[0]);
+    }, static_cast<double>(CONVERT_PIXELS), static_cast<double>(in.size()));
+}
+
+void run_palette(std::mt19937& gen) {
+    std::vector<uint8_t>  in(CONVERT_PIXELS);
+    std::vector<uint32_t> out(CONVERT_PIXELS);
+    std::vector<uint32_t> palette(256);
+
+    for (auto& b : in) {
+        b = static_cast<uint8_t>(gen());
+    }
+
+    for (auto& p : palette) {
+        p = gen();
+    }
+
+    bench::run("convert index8 -> bgra8 (palette)", [&] {
+        gfx::expand_palette(
+            in.data(),  in.data()  + in.size(),
+            out.data(), out.data() + out.size(),
+            palette.data()
+        );
+        bench::keep(out[0]);
+    }, static_cast<double>(CONVERT_PIXELS), static_cast<double>(in.size()));
+}
+
+} //namespace
+
+void bench::image_benchmarks() {
+    auto const cpu = bklib::detect_cpu_features();
+    std::printf("cpu:%s%s%s%s\n",
+        cpu.sse2  ? " sse2"  : "",
+        cpu.ssse3 ? " ssse3" : "",
+        cpu.sse41 ? " sse41" : "",
+        cpu.avx2  ? " avx2"  : ""
+    );
+
+    std::mt19937 gen(1);
+
+    run_convert<gfx::bgr8,   gfx::bgra8>("convert bgr8 -> bgra8",   gen);
+    run_convert<gfx::bgr8,   gfx::rgba8>("convert bgr8 -> rgba8",   gen);
+    run_convert<gfx::bgra8,  gfx::bgr8 >("convert bgra8 -> bgr8",   gen);
+    run_convert<gfx::bgra8,  gfx::rgba8>("convert bgra8 -> rgba8",  gen);
+    run_convert<gfx::rgba8,  gfx::bgr8 >("convert rgba8 -> bgr8",   gen);
+    run_convert<gfx::bgr5a1, gfx::bgra8>("convert bgr5a1 -> bgra8", gen);
+    run_convert<gfx::bgr5a1, gfx::rgba8>("convert bgr5a1 -> rgba8", gen);
+    run_convert<gfx::gray8,  gfx::bgra8>("convert gray8 -> bgra8",  gen);
+    run_palette(gen);
+
+    auto const directory = make_temp_directory();
+    std::vector<bklib::utf8string> files;
+
+    for (auto const size : SIZES) {
+        for (auto const& info : FORMATS) {
+            for (int rle = 0; rle < 2; ++rle) {
+                run_file(directory, info, size, rle != 0, true,  gen, files);
+                run_file(directory, info, size, rle != 0, false, gen, files);
+            }
+        }
+    }
+
+    for (auto const& f : files) {
+        bklib::remove_file(f);
+    }
+}
@@ -0,0 +1,85 @@
+#include "pch.hpp"
+#include "benchmark.hpp"
+
+#include "common/kd_tree.hpp"
+
+namespace {
+
+typedef bklib::math::point<float, 2>   point_t;
+typedef bklib::math::kd_tree<point_t>  tree_t;
+
+size_t const QUERY_COUNT = 1000;
+
+void run_size(size_t n) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> pos(0.0f, 10000.0f);
+
+    std::vector<point_t> points;
+    points.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        points.push_back(point_t(pos(gen), pos(gen)));
+    }
+
+    std::vector<point_t> queries;
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        queries.push_back(point_t(pos(gen), pos(gen)));
+    }
+
+    char name[64];
+    tree_t tree;
+
+    std::sprintf(name, "build n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        tree.build(points.begin(), points.end());
+        bench::keep(tree.size());
+    }, static_cast<double>(n));
+
+    tree_t::result_list_t out;
+
+    std::sprintf(name, "8-nn x%u n=%u",
+        static_cast<unsigned>(QUERY_COUNT), static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        for (auto const& q : queries) {
+            tree.nearest(q, 8, out);
+        }
+        bench::keep(out.front().index);
+    }, static_cast<double>(QUERY_COUNT));
+
+    std::sprintf(name, "radius 50 x%u n=%u",
+        static_cast<unsigned>(QUERY_COUNT), static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        size_t count = 0;
+        for (auto const& q : queries) {
+            tree.within(q, 50.0f, out);
+            count += out.size();
+        }
+        bench::keep(count);
+    }, static_cast<double>(QUERY_COUNT));
+
+    std::sprintf(name, "brute force 1-nn x%u n=%u",
+        static_cast<unsigned>(QUERY_COUNT), static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        size_t best_index = 0;
+
+        for (auto const& q : queries) {
+            auto best = std::numeric_limits<float>::max();
+
+            for (size_t i = 0; i < n; ++i) {
+                auto const d = bklib::math::distance2(points[i], q);
+                if (d < best) {
+                    best       = d;
+                    best_index = i;
+                }
+            }
+        }
+
+        bench::keep(best_index);
+    }, static_cast<double>(QUERY_COUNT));
+}
+
+} //namespace
+
+void bench::kd_tree_benchmarks() {
+    run_size(100000);
+    run_size(1000000);
+}
@@ -0,0 +1,39 @@
+#include "pch.hpp"
+#include "benchmark.hpp"
+
+namespace {
+
+struct suite {
+    char const* name;
+    void (*run)();
+};
+
+suite const SUITES[] = {
+    {"broadphase", bench::broadphase_benchmarks},
+    {"image",      bench::image_benchmarks},
+    {"kd_tree",    bench::kd_tree_benchmarks},
+    {"rect",       bench::rect_benchmarks},
+    {"region",     bench::region_benchmarks},
+};
+
+} //namespace
+
+//------------------------------------------------------------------------------
+//! benchmark [suite...]
+//! Runs the named suites, or all of them if none are given.
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+    for (auto const& s : SUITES) {
+        auto const selected = argc < 2 || std::any_of(argv + 1, argv + argc,
+            [&](char const* arg) { return std::strcmp(arg, s.name) == 0; }
+        );
+
+        if (selected) {
+            std::printf("[%s]\n", s.name);
+            s.run();
+            std::printf("\n");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "pch.hpp"
+#include "benchmark.hpp"
+
+#include "common/fixed.hpp"
+
+namespace {
+
+using bklib::math::fixed24_8;
+using bklib::math::rect;
+
+size_t const RECT_COUNT  = 1024;
+size_t const POINT_COUNT = 1024;
+
+//! Hit test every point against every rect, counting hits and border hits.
+template <typename T>
+void run_hit_test(char const* name, std::vector<rect<T>> const& rects,
+    std::vector<T> const& xs, std::vector<T> const& ys, T border
+) {
+    bench::run(name, [&] {
+        int hits = 0;
+
+        for (size_t i = 0; i < POINT_COUNT; ++i) {
+            for (auto const& r : rects) {
+                hits += bklib::math::intersects(xs[i], ys[i], r);
+                hits += static_cast<bool>(
+                    bklib::math::intersects_border(xs[i], ys[i], r, border)
+                );
+            }
+        }
+
+        bench::keep(hits);
+    }, static_cast<double>(RECT_COUNT * POINT_COUNT));
+}
+
+} //namespace
+
+void bench::rect_benchmarks() {
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int32_t> pos(0, 1919);
+    std::uniform_int_distribution<int32_t> size(8, 256);
+
+    std::vector<rect<float>>     rf;
+    std::vector<rect<int32_t>>   ri;
+    std::vector<rect<fixed24_8>> rx;
+
+    for (size_t i = 0; i < RECT_COUNT; ++i) {
+        auto const x = pos(gen), y = pos(gen);
+        auto const w = size(gen), h = size(gen);
+
+        ri.push_back(rect<int32_t>(x, y, x + w, y + h));
+        rf.push_back(bklib::math::rect_cast<float>(ri.back()));
+        rx.push_back(rect<fixed24_8>(x, y, x + w, y + h));
+    }
+
+    std::vector<float>     xf, yf;
+    std::vector<int32_t>   xi, yi;
+    std::vector<fixed24_8> xx, yx;
+
+    for (size_t i = 0; i < POINT_COUNT; ++i) {
+        auto const x = pos(gen), y = pos(gen);
+
+        xi.push_back(x); yi.push_back(y);
+        xf.push_back(static_cast<float>(x)); yf.push_back(static_cast<float>(y));
+        xx.push_back(x); yx.push_back(y);
+    }
+
+    run_hit_test("hit test float",     rf, xf, yf, 4.0f);
+    run_hit_test("hit test int32_t",   ri, xi, yi, 4);
+    run_hit_test("hit test fixed24_8", rx, xx, yx, fixed24_8(4));
+}
@@ -0,0 +1,118 @@
+#include "pch.hpp"
+#include "benchmark.hpp"
+
+#include "common/region.hpp"
+
+namespace {
+
+typedef bklib::math::region<int> region_t;
+typedef region_t::rect_t         rect_t;
+
+//! @c n random rects of up to @c max_size a side within a @c extent square.
+std::vector<rect_t> make_rects(size_t n, int extent, int max_size, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> pos(0, extent - 1);
+    std::uniform_int_distribution<int> size(1, max_size);
+
+    std::vector<rect_t> result;
+    result.reserve(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        auto const x = pos(gen);
+        auto const y = pos(gen);
+        result.push_back(rect_t(x, y, x + size(gen), y + size(gen)));
+    }
+
+    return result;
+}
+
+void run_build(size_t n) {
+    auto const rects = make_rects(n, 4096, 64, 1);
+    char name[64];
+
+    std::sprintf(name, "build (balanced) n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        region_t r(rects.begin(), rects.end());
+        bench::keep(r.size());
+    }, static_cast<double>(n));
+
+    // the naive approach is quadratic; skip the large cases
+    if (n > 4000) {
+        return;
+    }
+
+    std::sprintf(name, "build (one at a time) n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        region_t r;
+        for (auto const& rect : rects) {
+            r |= region_t(rect);
+        }
+        bench::keep(r.size());
+    }, static_cast<double>(n));
+}
+
+void run_ops(size_t n) {
+    auto const ra = make_rects(n, 4096, 64, 2);
+    auto const rb = make_rects(n, 4096, 64, 3);
+
+    region_t const a(ra.begin(), ra.end());
+    region_t const b(rb.begin(), rb.end());
+
+    std::printf("  operands: %u, %u rects\n",
+        static_cast<unsigned>(a.size()), static_cast<unsigned>(b.size())
+    );
+
+    auto const items = static_cast<double>(a.size() + b.size());
+    char name[64];
+
+    std::sprintf(name, "union n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] { bench::keep((a | b).size()); }, items);
+
+    std::sprintf(name, "intersect n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] { bench::keep((a & b).size()); }, items);
+
+    std::sprintf(name, "subtract n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] { bench::keep((a - b).size()); }, items);
+
+    std::sprintf(name, "translate n=%u", static_cast<unsigned>(n));
+    region_t t = a;
+    bench::run(name, [&] { t.translate(1, -1); bench::keep(t.begin()->left); },
+        static_cast<double>(a.size())
+    );
+
+    std::sprintf(name, "contains x1000 n=%u", static_cast<unsigned>(n));
+    bench::run(name, [&] {
+        int hits = 0;
+        for (int i = 0; i < 1000; ++i) {
+            hits += a.contains((i * 37) % 4096, (i * 91) % 4096);
+        }
+        bench::keep(hits);
+    }, 1000.0);
+}
+
+//! Typical damage tracking: many small overlapping invalidations per frame
+//! clipped against a window.
+void run_damage() {
+    auto const rects = make_rects(2000, 1920, 48, 4);
+    region_t const window(rect_t(0, 0, 1280, 720));
+
+    bench::run("damage: accumulate 2000, clip to window", [&] {
+        region_t damage(rects.begin(), rects.end());
+        damage &= window;
+        bench::keep(damage.area());
+    }, 2000.0);
+}
+
+} //namespace
+
+void bench::region_benchmarks() {
+    run_build(1000);
+    run_build(4000);
+    run_build(16000);
+
+    run_ops(1000);
+    run_ops(4000);
+    run_ops(16000);
+
+    run_damage();
+}
@@ -0,0 +1,229 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  2D affine transformations.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cmath>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace math {
+
+//------------------------------------------------------------------------------
+//! 2D affine transformation stored as a 3x2 matrix for row vectors:
+//!     x' = x*m11 + y*m21 + dx
+//!     y' = x*m12 + y*m22 + dy
+//! This is the same layout and convention used by Direct2D; @c a*b applies
+//! @c a first and then @c b.
+//! @t-param T
+//!     Scalar type.
+//------------------------------------------------------------------------------
+template <typename T>
+struct affine2 {
+    typedef T           scalar_t;
+    typedef point<T, 2> point_t;
+    typedef rect<T>     rect_t;
+
+    //! Components are left uninitialized.
+    affine2() {
+    }
+
+    affine2(T m11, T m12, T m21, T m22, T dx, T dy)
+        : m11(m11), m12(m12), m21(m21), m22(m22), dx(dx), dy(dy)
+    {
+    }
+
+    static affine2 identity() {
+        return affine2(1, 0, 0, 1, 0, 0);
+    }
+
+    static affine2 translation(T x, T y) {
+        return affine2(1, 0, 0, 1, x, y);
+    }
+
+    static affine2 scaling(T sx, T sy) {
+        return affine2(sx, 0, 0, sy, 0, 0);
+    }
+
+    //! Clockwise rotation (y down) by @c radians about the origin.
+    static affine2 rotation(T radians) {
+        auto const c = static_cast<T>(std::cos(radians));
+        auto const s = static_cast<T>(std::sin(radians));
+        return affine2(c, s, -s, c, 0, 0);
+    }
+
+    T determinant() const {
+        return m11*m22 - m12*m21;
+    }
+
+    //! @c true if the transformation is a scale and / or translation only.
+    bool is_axis_aligned() const {
+        return m12 == 0 && m21 == 0;
+    }
+
+    bool is_identity() const {
+        return is_axis_aligned() && m11 == 1 && m22 == 1 && dx == 0 && dy == 0;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Invert in place.
+    //! @return
+    //!     @c false if the transformation is singular; it is left unchanged.
+    //--------------------------------------------------------------------------
+    bool invert() {
+        auto const det = determinant();
+        if (det == 0) {
+            return false;
+        }
+
+        auto const i11 =  m22 / det;
+        auto const i12 = -m12 / det;
+        auto const i21 = -m21 / det;
+        auto const i22 =  m11 / det;
+
+        *this = affine2(
+            i11, i12,
+            i21, i22,
+            -(dx*i11 + dy*i21), -(dx*i12 + dy*i22)
+        );
+
+        return true;
+    }
+
+    point_t apply(point_t const& p) const {
+        return apply(x(p), y(p));
+    }
+
+    point_t apply(T px, T py) const {
+        return point_t(px*m11 + py*m21 + dx, px*m12 + py*m22 + dy);
+    }
+
+    //! Axis aligned bounding rect of the transformed rect @c r.
+    rect_t apply(rect_t const& r) const {
+        if (is_axis_aligned()) {
+            auto const x0 = r.left*m11   + dx;
+            auto const x1 = r.right*m11  + dx;
+            auto const y0 = r.top*m22    + dy;
+            auto const y1 = r.bottom*m22 + dy;
+
+            return rect_t(
+                (std::min)(x0, x1), (std::min)(y0, y1),
+                (std::max)(x0, x1), (std::max)(y0, y1)
+            );
+        }
+
+        auto const p0 = apply(r.left,  r.top);
+        auto const p1 = apply(r.right, r.top);
+        auto const p2 = apply(r.left,  r.bottom);
+        auto const p3 = apply(r.right, r.bottom);
+
+        auto const lo = min(min(p0, p1), min(p2, p3));
+        auto const hi = max(max(p0, p1), max(p2, p3));
+
+        return rect_t(x(lo), y(lo), x(hi), y(hi));
+    }
+
+    T m11, m12;
+    T m21, m22;
+    T dx,  dy;
+};
+
+//------------------------------------------------------------------------------
+//! Composition; the result applies @c a and then @c b.
+//------------------------------------------------------------------------------
+template <typename T>
+affine2<T> operator*(affine2<T> const& a, affine2<T> const& b) {
+    return affine2<T>(
+        a.m11*b.m11 + a.m12*b.m21,       a.m11*b.m12 + a.m12*b.m22,
+        a.m21*b.m11 + a.m22*b.m21,       a.m21*b.m12 + a.m22*b.m22,
+        a.dx*b.m11  + a.dy*b.m21 + b.dx, a.dx*b.m12  + a.dy*b.m22 + b.dy
+    );
+}
+
+template <typename T>
+bool operator==(affine2<T> const& a, affine2<T> const& b) {
+    return a.m11 == b.m11 && a.m12 == b.m12 &&
+           a.m21 == b.m21 && a.m22 == b.m22 &&
+           a.dx  == b.dx  && a.dy  == b.dy;
+}
+
+//------------------------------------------------------------------------------
+//! Inverse of @c m; the result is unspecified if @c m is singular.
+//------------------------------------------------------------------------------
+template <typename T>
+affine2<T> inverse(affine2<T> m) {
+    auto const ok = m.invert();
+    BK_ASSERT_MSG(ok, "singular transformation");
+    BK_UNUSED_VAR(ok);
+
+    return m;
+}
+
+//------------------------------------------------------------------------------
+//! Batch transform @c n points from @c in to @c out; they may alias.
+//------------------------------------------------------------------------------
+template <typename T>
+void transform(
+    affine2<T> const&  m,
+    point<T, 2> const* in,
+    point<T, 2>*       out,
+    size_t             n
+) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = m.apply(in[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+//! Batch transform @c n rects from @c in to @c out; they may alias.
+//------------------------------------------------------------------------------
+template <typename T>
+void transform(
+    affine2<T> const& m,
+    rect<T> const*    in,
+    rect<T>*          out,
+    size_t            n
+) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = m.apply(in[i]);
+    }
+}
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+//------------------------------------------------------------------------------
+//! SSE version; two points per register.
+//------------------------------------------------------------------------------
+inline void transform(
+    affine2<float> const&  m,
+    point<float, 2> const* in,
+    point<float, 2>*       out,
+    size_t                 n
+) {
+    static_assert(sizeof(point<float, 2>) == 2*sizeof(float), "bad size");
+
+    auto const c0 = _mm_setr_ps(m.m11, m.m12, m.m11, m.m12);
+    auto const c1 = _mm_setr_ps(m.m21, m.m22, m.m21, m.m22);
+    auto const d  = _mm_setr_ps(m.dx,  m.dy,  m.dx,  m.dy);
+
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto const v  = _mm_loadu_ps(in[i].p_);             // x0 y0 x1 y1
+        auto const xs = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+        auto const ys = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+
+        _mm_storeu_ps(out[i].p_, _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(xs, c0), _mm_mul_ps(ys, c1)), d
+        ));
+    }
+
+    if (i < n) {
+        out[i] = m.apply(in[i]);
+    }
+}
+#endif // BK_CONFIG_SIMD_SSE2
+
+} //namespace math
+} //namespace bklib
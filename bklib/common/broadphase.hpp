@@ -0,0 +1,255 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Sweep and prune overlap detection for sets of rectangles.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace math {
+
+//------------------------------------------------------------------------------
+//! Finds all pairs of overlapping rectangles (touching edges overlap, as with
+//! intersects(rect, rect)).
+//!
+//! The rectangles' x intervals are kept as a list of endpoints sorted across
+//! calls to find_pairs(). Between calls the rectangles usually move only a
+//! little, so the list is nearly sorted and an insertion sort restores it in
+//! close to linear time. A sweep over the list then tests only those pairs
+//! whose x intervals overlap. A near static scene costs O(n + k) per update,
+//! where k is the number of pairs overlapping on x.
+//! @t-param T
+//!     Scalar type of the rectangles.
+//------------------------------------------------------------------------------
+template <typename T = float>
+class broadphase {
+public:
+    typedef uint32_t                 id_t;
+    typedef rect<T>                  rect_t;
+    typedef std::pair<id_t, id_t>    pair_t;
+    typedef std::vector<pair_t>      pair_list_t;
+
+    broadphase()
+        : removed_(0)
+        , inserted_(0)
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    //! Add a rectangle.
+    //! @return an id to pass to update() and remove(); ids of removed
+    //!         rectangles are reused.
+    //--------------------------------------------------------------------------
+    id_t insert(rect_t const& r) {
+        id_t id;
+
+        if (free_.empty()) {
+            id = static_cast<id_t>(boxes_.size());
+            boxes_.push_back(box(r));
+        } else {
+            id = free_.back();
+            free_.pop_back();
+            boxes_[id] = box(r);
+        }
+
+        endpoints_.push_back(endpoint(r.left,  id, false));
+        endpoints_.push_back(endpoint(r.right, id, true));
+        ++inserted_;
+
+        return id;
+    }
+
+    void update(id_t id, rect_t const& r) {
+        BK_ASSERT_MSG(is_valid_(id), "invalid id");
+        boxes_[id].r = r;
+    }
+
+    void remove(id_t id) {
+        BK_ASSERT_MSG(is_valid_(id), "invalid id");
+
+        boxes_[id].alive = false;
+        free_.push_back(id);
+        ++removed_;
+    }
+
+    rect_t const& get(id_t id) const {
+        BK_ASSERT_MSG(is_valid_(id), "invalid id");
+        return boxes_[id].r;
+    }
+
+    void clear() {
+        boxes_.clear();
+        free_.clear();
+        endpoints_.clear();
+        pairs_.clear();
+        removed_  = 0;
+        inserted_ = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Bring the endpoint order up to date and collect every overlapping pair
+    //! (a, b) with a < b. The pairs are in no particular order.
+    //! @return the pairs; valid until the next call.
+    //--------------------------------------------------------------------------
+    pair_list_t const& find_pairs() {
+        refresh_endpoints_();
+        sweep_();
+
+        return pairs_;
+    }
+
+    //! The pairs found by the last call to find_pairs().
+    pair_list_t const& pairs() const {
+        return pairs_;
+    }
+private:
+    struct box {
+        explicit box(rect_t const& r)
+            : r(r), active(0), alive(true)
+        {
+        }
+
+        rect_t   r;
+        uint32_t active; //!< index into active_ during a sweep.
+        bool     alive;
+    };
+
+    struct endpoint {
+        endpoint(T value, id_t id, bool is_max)
+            : value(value), id(id), is_max(is_max)
+        {
+        }
+
+        //! Lower endpoints sort first so that touching intervals overlap.
+        bool operator<(endpoint const& rhs) const {
+            return value < rhs.value ||
+                (!(rhs.value < value) && !is_max && rhs.is_max);
+        }
+
+        T    value;
+        id_t id;
+        bool is_max;
+    };
+
+    bool is_valid_(id_t id) const {
+        return id < boxes_.size() && boxes_[id].alive;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Drop removed endpoints, reload the values and restore the order.
+    //--------------------------------------------------------------------------
+    void refresh_endpoints_() {
+        if (removed_) {
+            // an id may have been reused since it was removed, so keep only
+            // one pair of endpoints per live id: the most recently added.
+            std::vector<char> seen(boxes_.size(), 0);
+
+            for (auto it = endpoints_.rbegin(); it != endpoints_.rend(); ++it) {
+                auto& flags = seen[it->id];
+                auto const bit = it->is_max ? 2 : 1;
+
+                if (!boxes_[it->id].alive || (flags & bit)) {
+                    it->id = INVALID_ID;
+                } else {
+                    flags |= bit;
+                }
+            }
+
+            endpoints_.erase(std::remove_if(endpoints_.begin(), endpoints_.end(),
+                [](endpoint const& e) { return e.id == INVALID_ID; }
+            ), endpoints_.end());
+
+            removed_ = 0;
+        }
+
+        for (auto& e : endpoints_) {
+            auto const& r = boxes_[e.id].r;
+            e.value = e.is_max ? r.right : r.left;
+        }
+
+        // many new endpoints at the back; an insertion sort would be quadratic
+        if (inserted_ * 8 > endpoints_.size()) {
+            std::sort(endpoints_.begin(), endpoints_.end());
+        } else {
+            insertion_sort_();
+        }
+
+        inserted_ = 0;
+    }
+
+    void insertion_sort_() {
+        auto const first = endpoints_.begin();
+        auto const last  = endpoints_.end();
+
+        for (auto it = first; it != last; ++it) {
+            if (it == first || !(*it < *(it - 1))) {
+                continue;
+            }
+
+            auto const e = *it;
+            auto hole = it;
+
+            do {
+                *hole = *(hole - 1);
+                --hole;
+            } while (hole != first && e < *(hole - 1));
+
+            *hole = e;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Sweep the sorted endpoints keeping the set of open intervals; each
+    //! interval opened is tested against the open ones on y only.
+    //--------------------------------------------------------------------------
+    void sweep_() {
+        pairs_.clear();
+        active_.clear();
+
+        for (auto const& e : endpoints_) {
+            auto& b = boxes_[e.id];
+
+            if (e.is_max) {
+                // swap and pop
+                auto const last = active_.back();
+                active_[b.active] = last;
+                boxes_[last].active = b.active;
+                active_.pop_back();
+                continue;
+            }
+
+            for (auto const other : active_) {
+                auto const& r = boxes_[other].r;
+
+                if (!(r.bottom < b.r.top || r.top > b.r.bottom)) {
+                    pairs_.push_back(e.id < other ?
+                        pair_t(e.id, other) : pair_t(other, e.id)
+                    );
+                }
+            }
+
+            b.active = static_cast<uint32_t>(active_.size());
+            active_.push_back(e.id);
+        }
+    }
+
+    static id_t const INVALID_ID = ~id_t(0);
+
+    std::vector<box>      boxes_;
+    std::vector<id_t>     free_;
+    std::vector<endpoint> endpoints_;
+    std::vector<id_t>     active_;
+    pair_list_t           pairs_;
+    size_t                removed_;  //!< removals since the last find_pairs().
+    size_t                inserted_; //!< insertions since the last find_pairs().
+};
+
+} //namespace math
+} //namespace bklib
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  24.8 fixed point scalar for pixel exact geometry.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace math {
+
+//------------------------------------------------------------------------------
+//! Signed fixed point number with 24 integer and 8 fractional bits.
+//! Arithmetic is exact (save for multiplication and division, which truncate)
+//! and deterministic across platforms, and comparisons are plain integer
+//! comparisons. Conversion to float is exact for |v| < 2^16.
+//------------------------------------------------------------------------------
+class fixed24_8 {
+public:
+    static int32_t const FRACTION_BITS = 8;
+    static int32_t const ONE           = 1 << FRACTION_BITS;
+
+    //! Left uninitialized.
+    fixed24_8() {
+    }
+
+    fixed24_8(int32_t i)
+        : raw_(i * ONE)
+    {
+    }
+
+    //! Round to the nearest representable value.
+    explicit fixed24_8(float f)
+        : raw_(static_cast<int32_t>(std::floor(f * ONE + 0.5f)))
+    {
+    }
+
+    //! Round to the nearest representable value.
+    explicit fixed24_8(double d)
+        : raw_(static_cast<int32_t>(std::floor(d * ONE + 0.5)))
+    {
+    }
+
+    static fixed24_8 from_raw(int32_t raw) {
+        fixed24_8 result;
+        result.raw_ = raw;
+        return result;
+    }
+
+    int32_t raw() const {
+        return raw_;
+    }
+
+    //! Round towards negative infinity.
+    int32_t floor() const {
+        return raw_ >> FRACTION_BITS;
+    }
+
+    //! Round to nearest; halves round up.
+    int32_t round() const {
+        return (raw_ + ONE / 2) >> FRACTION_BITS;
+    }
+
+    explicit operator float() const {
+        BK_ASSERT_MSG(raw_ > -(1 << 24) && raw_ < (1 << 24), "inexact conversion");
+        return static_cast<float>(raw_) / ONE;
+    }
+
+    explicit operator double() const {
+        return static_cast<double>(raw_) / ONE;
+    }
+
+    fixed24_8& operator+=(fixed24_8 rhs) { raw_ += rhs.raw_; return *this; }
+    fixed24_8& operator-=(fixed24_8 rhs) { raw_ -= rhs.raw_; return *this; }
+
+    fixed24_8& operator*=(fixed24_8 rhs) {
+        raw_ = static_cast<int32_t>(
+            (static_cast<int64_t>(raw_) * rhs.raw_) >> FRACTION_BITS
+        );
+        return *this;
+    }
+
+    fixed24_8& operator/=(fixed24_8 rhs) {
+        raw_ = static_cast<int32_t>(
+            static_cast<int64_t>(raw_) * ONE / rhs.raw_
+        );
+        return *this;
+    }
+
+    fixed24_8 operator-() const {
+        return from_raw(-raw_);
+    }
+
+    friend fixed24_8 operator+(fixed24_8 a, fixed24_8 b) { return a += b; }
+    friend fixed24_8 operator-(fixed24_8 a, fixed24_8 b) { return a -= b; }
+    friend fixed24_8 operator*(fixed24_8 a, fixed24_8 b) { return a *= b; }
+    friend fixed24_8 operator/(fixed24_8 a, fixed24_8 b) { return a /= b; }
+
+    friend bool operator==(fixed24_8 a, fixed24_8 b) { return a.raw_ == b.raw_; }
+    friend bool operator!=(fixed24_8 a, fixed24_8 b) { return a.raw_ != b.raw_; }
+    friend bool operator< (fixed24_8 a, fixed24_8 b) { return a.raw_ <  b.raw_; }
+    friend bool operator> (fixed24_8 a, fixed24_8 b) { return a.raw_ >  b.raw_; }
+    friend bool operator<=(fixed24_8 a, fixed24_8 b) { return a.raw_ <= b.raw_; }
+    friend bool operator>=(fixed24_8 a, fixed24_8 b) { return a.raw_ >= b.raw_; }
+private:
+    int32_t raw_;
+};
+
+//------------------------------------------------------------------------------
+//! The same rect in raw (1/256 pixel) units.
+//------------------------------------------------------------------------------
+inline rect<int32_t> to_raw(rect<fixed24_8> const& r) {
+    return rect<int32_t>(r.left.raw(), r.top.raw(), r.right.raw(), r.bottom.raw());
+}
+
+//------------------------------------------------------------------------------
+// rect<fixed24_8> specializations; all forward to the branchless integer
+// versions on the raw values.
+//------------------------------------------------------------------------------
+template <>
+inline fixed24_8 rect_base::side_sign<fixed24_8>(side_x side) {
+    return fixed24_8(static_cast<int32_t>(side));
+}
+
+template <>
+inline fixed24_8 rect_base::side_sign<fixed24_8>(side_y side) {
+    return fixed24_8(static_cast<int32_t>(side));
+}
+
+template <> template <>
+inline fixed24_8 rect<fixed24_8>::resize_constrained<rect_base::side_x>(
+    side_x side, fixed24_8 delta, range<fixed24_8> const& constraint
+) {
+    auto lo = left.raw(), hi = right.raw();
+    auto const change = detail::resize_constrained(lo, hi,
+        side_sign<int32_t>(side), delta.raw(),
+        constraint.min.raw(), constraint.max.raw()
+    );
+
+    left  = fixed24_8::from_raw(lo);
+    right = fixed24_8::from_raw(hi);
+
+    check();
+    return fixed24_8::from_raw(change);
+}
+
+template <> template <>
+inline fixed24_8 rect<fixed24_8>::resize_constrained<rect_base::side_y>(
+    side_y side, fixed24_8 delta, range<fixed24_8> const& constraint
+) {
+    auto lo = top.raw(), hi = bottom.raw();
+    auto const change = detail::resize_constrained(lo, hi,
+        side_sign<int32_t>(side), delta.raw(),
+        constraint.min.raw(), constraint.max.raw()
+    );
+
+    top    = fixed24_8::from_raw(lo);
+    bottom = fixed24_8::from_raw(hi);
+
+    check();
+    return fixed24_8::from_raw(change);
+}
+
+inline bool intersects(fixed24_8 x, fixed24_8 y, rect<fixed24_8> const& rect) {
+    return intersects(x.raw(), y.raw(), to_raw(rect));
+}
+
+inline border_intersection
+intersects_border(fixed24_8 x, fixed24_8 y, rect<fixed24_8> const& rect, fixed24_8 border_size) {
+    return intersects_border(x.raw(), y.raw(), to_raw(rect), border_size.raw());
+}
+
+} //namespace math
+} //namespace bklib
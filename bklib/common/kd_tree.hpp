@@ -0,0 +1,287 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  k-d tree for nearest neighbour and radius queries over points.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace math {
+
+template <typename P> class kd_tree;
+
+//------------------------------------------------------------------------------
+//! k-d tree over point<T, N>.
+//!
+//! The tree is implicit: the points are stored in a single array ordered so
+//! that the median of every range [lo, hi) sits at its midpoint, with the
+//! smaller half before it and the larger after it. No child pointers are
+//! needed and each subtree is contiguous in memory. Ranges of at most
+//! LEAF_SIZE points are leaves and are scanned linearly.
+//!
+//! Construction is O(n log n) and splits the upper levels across threads.
+//! The tree is static; call build() again to replace the points (e.g. once per
+//! frame for moving entities).
+//! @t-param T
+//!     Scalar type.
+//! @t-param N
+//!     Dimensions.
+//------------------------------------------------------------------------------
+template <typename T, size_t N>
+class kd_tree<point<T, N>> {
+public:
+    typedef point<T, N> point_t;
+    typedef uint32_t    index_t;
+
+    static size_t const LEAF_SIZE          = 8;
+    static size_t const PARALLEL_THRESHOLD = 1 << 14;
+
+    //! A query result; @c index is the position of the point in the input.
+    struct result {
+        bool operator<(result const& rhs) const {
+            return distance2 < rhs.distance2;
+        }
+
+        index_t index;
+        T       distance2;
+    };
+
+    typedef std::vector<result> result_list_t;
+
+    kd_tree() {
+    }
+
+    template <typename It>
+    kd_tree(It first, It last) {
+        build(first, last);
+    }
+
+    //--------------------------------------------------------------------------
+    //! Replace the contents of the tree with the points in [first, last).
+    //--------------------------------------------------------------------------
+    template <typename It>
+    void build(It first, It last) {
+        nodes_.clear();
+
+        index_t i = 0;
+        for (; first != last; ++first) {
+            nodes_.push_back(node(*first, i++));
+        }
+
+        axis_.assign(nodes_.size(), 0);
+
+        unsigned depth = 0;
+        for (auto n = std::thread::hardware_concurrency(); n > 1; n >>= 1) {
+            ++depth;
+        }
+
+        build_(0, nodes_.size(), depth);
+    }
+
+    size_t size() const {
+        return nodes_.size();
+    }
+
+    bool empty() const {
+        return nodes_.empty();
+    }
+
+    //--------------------------------------------------------------------------
+    //! Find the @c k points closest to @c q.
+    //! @param out
+    //!     Receives min(k, size()) results ordered nearest first.
+    //--------------------------------------------------------------------------
+    void nearest(point_t const& q, size_t k, result_list_t& out) const {
+        out.clear();
+        if (k == 0 || empty()) {
+            return;
+        }
+
+        out.reserve(k);
+        nearest_(0, nodes_.size(), q, k, out);
+        std::sort_heap(out.begin(), out.end());
+    }
+
+    //--------------------------------------------------------------------------
+    //! The point closest to @c q; the tree must not be empty.
+    //--------------------------------------------------------------------------
+    result nearest(point_t const& q) const {
+        BK_ASSERT_MSG(!empty(), "empty tree");
+
+        result_list_t out;
+        nearest(q, 1, out);
+        return out.front();
+    }
+
+    //--------------------------------------------------------------------------
+    //! Find the points within @c radius of @c q (inclusive).
+    //! @param out
+    //!     Receives the results in no particular order.
+    //--------------------------------------------------------------------------
+    void within(point_t const& q, T radius, result_list_t& out) const {
+        out.clear();
+        within_(0, nodes_.size(), q, radius * radius, out);
+    }
+private:
+    struct node {
+        node(point_t const& p, index_t index)
+            : p(p), index(index)
+        {
+        }
+
+        point_t p;
+        index_t index;
+    };
+
+    static T distance2_(point_t const& a, point_t const& b) {
+        T result = 0;
+
+        for (size_t i = 0; i < N; ++i) {
+            auto const d = a.p_[i] - b.p_[i];
+            result += d * d;
+        }
+
+        return result;
+    }
+
+    //! Axis with the largest extent over [lo, hi).
+    unsigned split_axis_(size_t lo, size_t hi) const {
+        auto min = nodes_[lo].p;
+        auto max = nodes_[lo].p;
+
+        for (auto i = lo + 1; i < hi; ++i) {
+            auto const& p = nodes_[i].p;
+
+            for (size_t j = 0; j < N; ++j) {
+                if (p.p_[j] < min.p_[j]) min.p_[j] = p.p_[j];
+                if (max.p_[j] < p.p_[j]) max.p_[j] = p.p_[j];
+            }
+        }
+
+        unsigned axis = 0;
+        for (unsigned j = 1; j < N; ++j) {
+            if (max.p_[axis] - min.p_[axis] < max.p_[j] - min.p_[j]) {
+                axis = j;
+            }
+        }
+
+        return axis;
+    }
+
+    void build_(size_t lo, size_t hi, unsigned depth) {
+        if (hi - lo <= LEAF_SIZE) {
+            return;
+        }
+
+        auto const mid  = lo + (hi - lo) / 2;
+        auto const axis = split_axis_(lo, hi);
+
+        std::nth_element(
+            nodes_.begin() + lo, nodes_.begin() + mid, nodes_.begin() + hi,
+            [axis](node const& a, node const& b) {
+                return a.p.p_[axis] < b.p.p_[axis];
+            }
+        );
+
+        axis_[mid] = static_cast<uint8_t>(axis);
+
+        // the two halves are disjoint, so they can be built concurrently.
+        if (depth > 0 && hi - lo >= PARALLEL_THRESHOLD) {
+            auto left = std::async(std::launch::async, [=] {
+                build_(lo, mid, depth - 1);
+            });
+
+            build_(mid + 1, hi, depth - 1);
+            left.get();
+        } else {
+            build_(lo, mid, depth);
+            build_(mid + 1, hi, depth);
+        }
+    }
+
+    //! Offer the node at @c i to the max-heap @c heap of the k best so far.
+    void consider_(size_t i, point_t const& q, size_t k, result_list_t& heap) const {
+        auto const d2 = distance2_(nodes_[i].p, q);
+
+        if (heap.size() < k) {
+            result const r = {nodes_[i].index, d2};
+            heap.push_back(r);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (d2 < heap.front().distance2) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back().index     = nodes_[i].index;
+            heap.back().distance2 = d2;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+
+    void nearest_(size_t lo, size_t hi, point_t const& q, size_t k, result_list_t& heap) const {
+        if (hi - lo <= LEAF_SIZE) {
+            for (auto i = lo; i < hi; ++i) {
+                consider_(i, q, k, heap);
+            }
+
+            return;
+        }
+
+        auto const mid  = lo + (hi - lo) / 2;
+        auto const axis = axis_[mid];
+        auto const diff = q.p_[axis] - nodes_[mid].p.p_[axis];
+
+        consider_(mid, q, k, heap);
+
+        // nearer side first; the far side only if it can hold a better point.
+        if (diff < 0) {
+            nearest_(lo, mid, q, k, heap);
+            if (heap.size() < k || diff * diff < heap.front().distance2) {
+                nearest_(mid + 1, hi, q, k, heap);
+            }
+        } else {
+            nearest_(mid + 1, hi, q, k, heap);
+            if (heap.size() < k || diff * diff < heap.front().distance2) {
+                nearest_(lo, mid, q, k, heap);
+            }
+        }
+    }
+
+    void within_(size_t lo, size_t hi, point_t const& q, T r2, result_list_t& out) const {
+        if (hi - lo <= LEAF_SIZE) {
+            for (auto i = lo; i < hi; ++i) {
+                auto const d2 = distance2_(nodes_[i].p, q);
+                if (d2 <= r2) {
+                    result const r = {nodes_[i].index, d2};
+                    out.push_back(r);
+                }
+            }
+
+            return;
+        }
+
+        auto const mid  = lo + (hi - lo) / 2;
+        auto const axis = axis_[mid];
+        auto const diff = q.p_[axis] - nodes_[mid].p.p_[axis];
+        auto const d2   = distance2_(nodes_[mid].p, q);
+
+        if (d2 <= r2) {
+            result const r = {nodes_[mid].index, d2};
+            out.push_back(r);
+        }
+
+        if (diff <= 0 || diff * diff <= r2) within_(lo, mid, q, r2, out);
+        if (diff >= 0 || diff * diff <= r2) within_(mid + 1, hi, q, r2, out);
+    }
+
+    std::vector<node>    nodes_;
+    std::vector<uint8_t> axis_; //!< split axis of each internal node.
+};
+
+} //namespace math
+} //namespace bklib
@@ -7,11 +7,18 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
 #include <functional>
+#include <initializer_list>
 
+#include "config.hpp"
 #include "util/assert.hpp"
 
+#if defined(BK_CONFIG_SIMD_SSE2)
+#   include <emmintrin.h>
+#endif
+
 namespace bklib { namespace math {
 ////////////////////////////////////////////////////////////////////////////////
 // Non-member functions
@@ -55,6 +62,54 @@ auto distance(T const& a, U const& b) -> decltype(std::sqrt(distance2(a, b))) {
     return std::sqrt(distance2(a, b));
 }
 
+template <typename T, size_t N> struct point;
+
+namespace detail {
+    //--------------------------------------------------------------------------
+    //! Compile time list of indicies; used to expand per-component expressions
+    //! without loops.
+    //--------------------------------------------------------------------------
+    template <size_t... I>
+    struct index_list {};
+
+    template <size_t N, size_t... I>
+    struct make_index_list : make_index_list<N - 1, N - 1, I...> {};
+
+    template <size_t... I>
+    struct make_index_list<0, I...> {
+        typedef index_list<I...> type;
+    };
+
+    //--------------------------------------------------------------------------
+    //! Reductions over the first M components of a point.
+    //--------------------------------------------------------------------------
+    template <size_t M>
+    struct point_reduce {
+        template <typename T, size_t N>
+        static bool equal(point<T, N> const& a, point<T, N> const& b) {
+            return (a.p_[M-1] == b.p_[M-1]) && point_reduce<M-1>::equal(a, b);
+        }
+
+        template <typename T, size_t N>
+        static T dot(point<T, N> const& a, point<T, N> const& b) {
+            return point_reduce<M-1>::dot(a, b) + a.p_[M-1] * b.p_[M-1];
+        }
+    };
+
+    template <>
+    struct point_reduce<0> {
+        template <typename T, size_t N>
+        static bool equal(point<T, N> const&, point<T, N> const&) {
+            return true;
+        }
+
+        template <typename T, size_t N>
+        static T dot(point<T, N> const&, point<T, N> const&) {
+            return static_cast<T>(0);
+        }
+    };
+} //namespace detail
+
 //------------------------------------------------------------------------------
 //! Point.
 //! @t-param T
@@ -66,6 +121,9 @@ template <typename T, size_t N>
 struct point {
     static size_t const dimension = N;
 
+    typedef T scalar_t;
+    typedef typename detail::make_index_list<N>::type indicies_t;
+
     template <size_t M, typename... Args>
     void assign(T arg, Args... args) {
         static_assert(M < N, "wrong number of arguments");
@@ -79,23 +137,25 @@ struct point {
         p_[M] = arg;
     }
 
+    //! Components are left uninitialized.
+    point() {
+    }
+
     template <typename... Args>
     point(T arg, Args... args) {
         static_assert(sizeof...(Args) + 1 == N, "wrong number of arguments");
         assign<0>(arg, args...);
     }
-    
-    template <size_t M, typename U>
-    void assign(point<U, N> const& p) {
-        p_[M] = static_cast<T>(p.p_[M]);
-    }
 
     template <typename U>
     explicit point(point<U, N> const& p) {
-        assign<0>(p);
+        for (size_t i = 0; i < N; ++i) {
+            p_[i] = static_cast<T>(p.p_[i]);
+        }
     }
     
     point(std::initializer_list<T> list) {
+        BK_ASSERT_MSG(list.size() == N, "wrong number of arguments");
         std::copy_n(list.begin(), N, p_);
     }
 
@@ -111,18 +171,37 @@ struct point {
         return p_[M];
     }
 
-    template <size_t M>
-    static bool equal(point const& a, point const &b) {
-        return (a.get<M> == b.get<M>) && equal<M-1>(a, b);
+    T operator[](size_t i) const {
+        BK_ASSERT_MSG(i < N, "index out of range");
+        return p_[i];
     }
 
-    template <>
-    static bool equal<0>(point const&, point const&) {
-        return true;
+    T& operator[](size_t i) {
+        BK_ASSERT_MSG(i < N, "index out of range");
+        return p_[i];
+    }
+
+    point& operator+=(point const& rhs) {
+        for (size_t i = 0; i < N; ++i) p_[i] += rhs.p_[i];
+        return *this;
+    }
+
+    point& operator-=(point const& rhs) {
+        for (size_t i = 0; i < N; ++i) p_[i] -= rhs.p_[i];
+        return *this;
+    }
+
+    point& operator*=(T s) {
+        for (size_t i = 0; i < N; ++i) p_[i] *= s;
+        return *this;
     }
 
     bool operator==(point const& rhs) const {
-        return equal<N>(*this, rhs);
+        return detail::point_reduce<N>::equal(*this, rhs);
+    }
+
+    bool operator!=(point const& rhs) const {
+        return !(*this == rhs);
     }
 
     T p_[N];
@@ -135,13 +214,316 @@ template <typename T, size_t N>
 T height(point<T, N> const& x) { return static_cast<T>(0); }
 
 template <typename T, size_t N>
-T x(point<T, N> const& v) { return v.get<0>(); }
+T x(point<T, N> const& v) { return v.p_[0]; }
+
+template <typename T, size_t N>
+T y(point<T, N> const& v) { return v.p_[1]; }
+
+template <typename T, size_t N>
+T z(point<T, N> const& v) { return v.p_[2]; }
+
+//------------------------------------------------------------------------------
+// Per-component implementations; expanded over point<T, N>::indicies_t.
+//------------------------------------------------------------------------------
+namespace detail {
+    template <typename T, size_t N, size_t... I>
+    point<T, N> add(
+        point<T, N> const& a, point<T, N> const& b, index_list<I...>
+    ) {
+        return point<T, N>(static_cast<T>(a.p_[I] + b.p_[I])...);
+    }
+
+    template <typename T, size_t N, size_t... I>
+    point<T, N> sub(
+        point<T, N> const& a, point<T, N> const& b, index_list<I...>
+    ) {
+        return point<T, N>(static_cast<T>(a.p_[I] - b.p_[I])...);
+    }
+
+    template <typename T, size_t N, size_t... I>
+    point<T, N> neg(point<T, N> const& a, index_list<I...>) {
+        return point<T, N>(static_cast<T>(-a.p_[I])...);
+    }
+
+    template <typename T, size_t N, size_t... I>
+    point<T, N> mul(point<T, N> const& a, T s, index_list<I...>) {
+        return point<T, N>(static_cast<T>(a.p_[I] * s)...);
+    }
+
+    template <typename T, size_t N, size_t... I>
+    point<T, N> min(
+        point<T, N> const& a, point<T, N> const& b, index_list<I...>
+    ) {
+        return point<T, N>((b.p_[I] < a.p_[I] ? b.p_[I] : a.p_[I])...);
+    }
+
+    template <typename T, size_t N, size_t... I>
+    point<T, N> max(
+        point<T, N> const& a, point<T, N> const& b, index_list<I...>
+    ) {
+        return point<T, N>((a.p_[I] < b.p_[I] ? b.p_[I] : a.p_[I])...);
+    }
+
+    template <typename T, size_t N, size_t... I>
+    point<T, N> lerp(
+        point<T, N> const& a, point<T, N> const& b, T t, index_list<I...>
+    ) {
+        return point<T, N>(static_cast<T>(a.p_[I] + (b.p_[I] - a.p_[I]) * t)...);
+    }
+
+    template <typename T, size_t N, size_t... I>
+    point<T, N> clamp(
+        point<T, N> const& p,
+        point<T, N> const& lo,
+        point<T, N> const& hi,
+        index_list<I...>
+    ) {
+        return point<T, N>((
+            p.p_[I] < lo.p_[I] ? lo.p_[I] :
+            hi.p_[I] < p.p_[I] ? hi.p_[I] : p.p_[I]
+        )...);
+    }
+} //namespace detail
+
+//------------------------------------------------------------------------------
+// Point algebra.
+//------------------------------------------------------------------------------
+template <typename T, size_t N>
+point<T, N> operator+(point<T, N> const& a, point<T, N> const& b) {
+    return detail::add(a, b, typename point<T, N>::indicies_t());
+}
+
+template <typename T, size_t N>
+point<T, N> operator-(point<T, N> const& a, point<T, N> const& b) {
+    return detail::sub(a, b, typename point<T, N>::indicies_t());
+}
 
 template <typename T, size_t N>
-T y(point<T, N> const& v) { return v.get<1>(); }
+point<T, N> operator-(point<T, N> const& a) {
+    return detail::neg(a, typename point<T, N>::indicies_t());
+}
+
+template <typename T, size_t N>
+point<T, N> operator*(
+    point<T, N> const& a, typename point<T, N>::scalar_t s
+) {
+    return detail::mul(a, s, typename point<T, N>::indicies_t());
+}
+
+template <typename T, size_t N>
+point<T, N> operator*(
+    typename point<T, N>::scalar_t s, point<T, N> const& a
+) {
+    return detail::mul(a, s, typename point<T, N>::indicies_t());
+}
+
+//! Inner product.
+template <typename T, size_t N>
+T dot(point<T, N> const& a, point<T, N> const& b) {
+    return detail::point_reduce<N>::dot(a, b);
+}
+
+//! Squared euclidean length.
+template <typename T, size_t N>
+T length2(point<T, N> const& a) {
+    return dot(a, a);
+}
+
+template <typename T, size_t N>
+auto length(point<T, N> const& a) -> decltype(std::sqrt(length2(a))) {
+    return std::sqrt(length2(a));
+}
+
+//! Points of any dimension; the generic version above requires a z component.
+template <typename T, size_t N>
+T distance2(point<T, N> const& a, point<T, N> const& b) {
+    return length2(a - b);
+}
+
+//! Component-wise minimum.
+template <typename T, size_t N>
+point<T, N> min(point<T, N> const& a, point<T, N> const& b) {
+    return detail::min(a, b, typename point<T, N>::indicies_t());
+}
+
+//! Component-wise maximum.
+template <typename T, size_t N>
+point<T, N> max(point<T, N> const& a, point<T, N> const& b) {
+    return detail::max(a, b, typename point<T, N>::indicies_t());
+}
+
+//! Linear interpolation; a at t = 0 and b at t = 1.
+template <typename T, size_t N>
+point<T, N> lerp(
+    point<T, N> const& a,
+    point<T, N> const& b,
+    typename point<T, N>::scalar_t t
+) {
+    return detail::lerp(a, b, t, typename point<T, N>::indicies_t());
+}
+
+//! Component-wise clamp of @c p to [lo, hi].
+template <typename T, size_t N>
+point<T, N> clamp(
+    point<T, N> const& p,
+    point<T, N> const& lo,
+    point<T, N> const& hi
+) {
+    return detail::clamp(p, lo, hi, typename point<T, N>::indicies_t());
+}
+
+//------------------------------------------------------------------------------
+//! Batch translate the points in [first, last) by @c d.
+//------------------------------------------------------------------------------
+template <typename T, size_t N>
+void translate(point<T, N>* first, point<T, N>* last, point<T, N> const& d) {
+    for (; first != last; ++first) {
+        *first += d;
+    }
+}
 
+//------------------------------------------------------------------------------
+//! Batch scale the points in [first, last) by @c s.
+//------------------------------------------------------------------------------
 template <typename T, size_t N>
-T z(point<T, N> const& v) { return v.get<2>(); }
+void scale(
+    point<T, N>* first, point<T, N>* last, typename point<T, N>::scalar_t s
+) {
+    for (; first != last; ++first) {
+        *first *= s;
+    }
+}
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+//------------------------------------------------------------------------------
+// SSE versions for point<float, 4> and point<float, 2>.
+//
+// These are plain overloads, so they are preferred to the templates above and
+// leave the layout (and ABI) of point untouched; the components are moved in
+// and out of registers with unaligned loads and stores. A point<float, 4> maps
+// to one register; point<float, 2> is only worth vectorizing in batches, two
+// points to a register.
+//------------------------------------------------------------------------------
+namespace detail {
+    inline __m128 load(point<float, 4> const& p) {
+        return _mm_loadu_ps(p.p_);
+    }
+
+    inline point<float, 4> store(__m128 v) {
+        point<float, 4> result;
+        _mm_storeu_ps(result.p_, v);
+        return result;
+    }
+} //namespace detail
+
+inline point<float, 4> operator+(
+    point<float, 4> const& a, point<float, 4> const& b
+) {
+    return detail::store(_mm_add_ps(detail::load(a), detail::load(b)));
+}
+
+inline point<float, 4> operator-(
+    point<float, 4> const& a, point<float, 4> const& b
+) {
+    return detail::store(_mm_sub_ps(detail::load(a), detail::load(b)));
+}
+
+inline point<float, 4> operator*(point<float, 4> const& a, float s) {
+    return detail::store(_mm_mul_ps(detail::load(a), _mm_set1_ps(s)));
+}
+
+inline point<float, 4> operator*(float s, point<float, 4> const& a) {
+    return a * s;
+}
+
+inline float dot(point<float, 4> const& a, point<float, 4> const& b) {
+    auto const m = _mm_mul_ps(detail::load(a), detail::load(b));
+    // (x+z, y+w, ...) then ((x+z)+(y+w), ...)
+    auto const s = _mm_add_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+inline float length2(point<float, 4> const& a) {
+    return dot(a, a);
+}
+
+inline point<float, 4> min(point<float, 4> const& a, point<float, 4> const& b) {
+    return detail::store(_mm_min_ps(detail::load(a), detail::load(b)));
+}
+
+inline point<float, 4> max(point<float, 4> const& a, point<float, 4> const& b) {
+    return detail::store(_mm_max_ps(detail::load(a), detail::load(b)));
+}
+
+inline point<float, 4> lerp(
+    point<float, 4> const& a, point<float, 4> const& b, float t
+) {
+    auto const va = detail::load(a);
+    auto const vb = detail::load(b);
+
+    return detail::store(
+        _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), _mm_set1_ps(t)))
+    );
+}
+
+inline point<float, 4> clamp(
+    point<float, 4> const& p,
+    point<float, 4> const& lo,
+    point<float, 4> const& hi
+) {
+    return detail::store(_mm_min_ps(
+        _mm_max_ps(detail::load(p), detail::load(lo)), detail::load(hi)
+    ));
+}
+
+inline void translate(
+    point<float, 4>* first, point<float, 4>* last, point<float, 4> const& d
+) {
+    auto const vd = detail::load(d);
+
+    for (; first != last; ++first) {
+        _mm_storeu_ps(first->p_, _mm_add_ps(_mm_loadu_ps(first->p_), vd));
+    }
+}
+
+inline void scale(point<float, 4>* first, point<float, 4>* last, float s) {
+    auto const vs = _mm_set1_ps(s);
+
+    for (; first != last; ++first) {
+        _mm_storeu_ps(first->p_, _mm_mul_ps(_mm_loadu_ps(first->p_), vs));
+    }
+}
+
+inline void translate(
+    point<float, 2>* first, point<float, 2>* last, point<float, 2> const& d
+) {
+    static_assert(sizeof(point<float, 2>) == 2*sizeof(float), "bad size");
+
+    auto const vd = _mm_setr_ps(x(d), y(d), x(d), y(d));
+
+    for (; last - first >= 2; first += 2) {
+        auto const p = first->p_;
+        _mm_storeu_ps(p, _mm_add_ps(_mm_loadu_ps(p), vd));
+    }
+
+    if (first != last) {
+        *first += d;
+    }
+}
+
+inline void scale(point<float, 2>* first, point<float, 2>* last, float s) {
+    auto const vs = _mm_set1_ps(s);
+
+    for (; last - first >= 2; first += 2) {
+        auto const p = first->p_;
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), vs));
+    }
+
+    if (first != last) {
+        *first *= s;
+    }
+}
+#endif // BK_CONFIG_SIMD_SSE2
 
 //------------------------------------------------------------------------------
 //! Numerical range.
@@ -303,6 +685,95 @@ struct rect : public rect_base {
     T left, top, right, bottom;
 };
 
+//------------------------------------------------------------------------------
+// Branchless integer helpers. Pixel coordinates are far from the limits of
+// int32_t, so overflow is not a concern.
+//------------------------------------------------------------------------------
+namespace detail {
+    //! @c true if lo <= v <= hi; requires lo <= hi.
+    inline bool in_closed_range(int32_t v, int32_t lo, int32_t hi) {
+        return static_cast<uint32_t>(v)  - static_cast<uint32_t>(lo) <=
+               static_cast<uint32_t>(hi) - static_cast<uint32_t>(lo);
+    }
+
+    //! @c v clamped to [lo, hi]; requires lo <= hi.
+    inline int32_t clamp(int32_t v, int32_t lo, int32_t hi) {
+        auto const a = v - lo;
+        v -= a & (a >> 31);       // max(v, lo)
+        auto const b = hi - v;
+        return v + (b & (b >> 31)); // min(v, hi)
+    }
+
+    //--------------------------------------------------------------------------
+    //! Move the side of [lo, hi] given by @c sign (-1 -> lo, 1 -> hi) by
+    //! @c delta, keeping the length in [min, max].
+    //! @return the distance the side actually moved along @c sign.
+    //--------------------------------------------------------------------------
+    inline int32_t resize_constrained(
+        int32_t& lo, int32_t& hi,
+        int32_t sign, int32_t delta,
+        int32_t min, int32_t max
+    ) {
+        auto const old_dist = hi - lo;
+        auto const change   = clamp(old_dist + sign * delta, min, max) - old_dist;
+        auto const is_hi    = (sign + 1) >> 1; // 0 or 1
+
+        hi += change * is_hi;
+        lo -= change * (1 - is_hi);
+
+        return change;
+    }
+} //namespace detail
+
+//------------------------------------------------------------------------------
+//! Branchless resize_constrained for integer rects.
+//------------------------------------------------------------------------------
+template <> template <>
+inline int32_t rect<int32_t>::resize_constrained<rect_base::side_x>(
+    side_x side, int32_t delta, range<int32_t> const& constraint
+) {
+    auto const change = detail::resize_constrained(left, right,
+        side_sign<int32_t>(side), delta, constraint.min, constraint.max
+    );
+
+    check();
+    return change;
+}
+
+template <> template <>
+inline int32_t rect<int32_t>::resize_constrained<rect_base::side_y>(
+    side_y side, int32_t delta, range<int32_t> const& constraint
+) {
+    auto const change = detail::resize_constrained(top, bottom,
+        side_sign<int32_t>(side), delta, constraint.min, constraint.max
+    );
+
+    check();
+    return change;
+}
+
+//------------------------------------------------------------------------------
+//! Convert between rects of different scalar types; the conversion is
+//! expected to be exact (e.g. int32_t -> float for |v| <= 2^24).
+//------------------------------------------------------------------------------
+template <typename U, typename T>
+rect<U> rect_cast(rect<T> const& r) {
+    rect<U> const result(
+        static_cast<U>(r.left),  static_cast<U>(r.top),
+        static_cast<U>(r.right), static_cast<U>(r.bottom)
+    );
+
+    BK_ASSERT_MSG(
+        static_cast<T>(result.left)   == r.left  &&
+        static_cast<T>(result.top)    == r.top   &&
+        static_cast<T>(result.right)  == r.right &&
+        static_cast<T>(result.bottom) == r.bottom,
+        "inexact conversion"
+    );
+
+    return result;
+}
+
 template <typename T, rect_base::side_x Side = rect_base::side_x::left>
 T x(rect<T> const& r) { return r.get_side(Side); }
 
@@ -373,6 +844,18 @@ bool intersects(point<T, 2> const& p, rect<T> const& rect) {
     return intersects(x(p), y(p), rect);
 }
 
+//------------------------------------------------------------------------------
+//! intersection of the rectangles @c a and @c b; touching edges intersect.
+//! @return
+//!     @c true if there is an intersection.
+//!     @c false otherwise.
+//------------------------------------------------------------------------------
+template <typename T>
+bool intersects(rect<T> const& a, rect<T> const& b) {
+    return !( b.right  < a.left || b.left > a.right  ||
+              b.bottom < a.top  || b.top  > a.bottom );
+}
+
 //------------------------------------------------------------------------------
 //! Describes the intersection(s) (if any) with a point and the border of a
 //! rectangle.
@@ -439,6 +922,33 @@ intersects_border(point<T, 2> const& p, rect<T> const& rect, T border_size) {
     return intersects_border(x(p), y(p), rect, border_size);
 }
 
+//------------------------------------------------------------------------------
+//! Branchless version for integer rects.
+//------------------------------------------------------------------------------
+inline bool intersects(int32_t x, int32_t y, rect<int32_t> const& rect) {
+    return detail::in_closed_range(x, rect.left, rect.right) &
+           detail::in_closed_range(y, rect.top,  rect.bottom);
+}
+
+//------------------------------------------------------------------------------
+//! Branchless version for integer rects.
+//------------------------------------------------------------------------------
+inline border_intersection
+intersects_border(int32_t x, int32_t y, rect<int32_t> const& rect, int32_t border_size) {
+    int32_t const is_left   = detail::in_closed_range(x, rect.left, rect.left + border_size);
+    int32_t const is_top    = detail::in_closed_range(y, rect.top,  rect.top  + border_size);
+    int32_t const is_right  = detail::in_closed_range(x, rect.right  - border_size, rect.right);
+    int32_t const is_bottom = detail::in_closed_range(y, rect.bottom - border_size, rect.bottom);
+
+    // left / top take precedence: -1, 1 or 0.
+    border_intersection result;
+    result.x = static_cast<rect_base::side_x>((is_right & ~is_left) - is_left);
+    result.y = static_cast<rect_base::side_y>((is_bottom & ~is_top) - is_top);
+    result.is_inside = intersects(x, y, rect);
+
+    return result;
+}
+
 
 } //namespace math
 } //namespace bklib
@@ -0,0 +1,372 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Regions: sets of rectangles closed under union, intersection and
+//!         difference.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace math {
+
+//------------------------------------------------------------------------------
+//! An area described as a set of disjoint rectangles in y-x banded form:
+//! @li rectangles are sorted by top, then by left;
+//! @li a band is a run of rectangles sharing the same top and bottom;
+//! @li rectangles within a band never touch or overlap;
+//! @li vertically adjacent bands never have identical spans (they are merged).
+//! Rectangles are treated as half open, [left, right) x [top, bottom), and
+//! empty ones are discarded.
+//!
+//! Every operation produces the canonical (coalesced) form directly; the
+//! boolean operations sweep both operands band by band and run in time linear
+//! in the size of the operands and the result.
+//! @t-param T
+//!     Scalar type.
+//------------------------------------------------------------------------------
+template <typename T>
+class region {
+public:
+    typedef T                                    scalar_t;
+    typedef rect<T>                              rect_t;
+    typedef std::vector<rect_t>                  container_t;
+    typedef typename container_t::const_iterator const_iterator;
+
+    region() {
+    }
+
+    explicit region(rect_t const& r) {
+        if (!is_empty_(r)) {
+            rects_.push_back(r);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! The union of the rects in [first, last). Built by a balanced merge, so
+    //! n rects cost O(n log n) operations rather than O(n^2).
+    //--------------------------------------------------------------------------
+    template <typename It>
+    region(It first, It last) {
+        std::vector<rect_t> input(first, last);
+        *this = union_of_(input.data(), input.data() + input.size());
+    }
+
+    bool empty() const {
+        return rects_.empty();
+    }
+
+    //! Number of rects.
+    size_t size() const {
+        return rects_.size();
+    }
+
+    const_iterator begin() const { return rects_.begin(); }
+    const_iterator end()   const { return rects_.end(); }
+
+    void clear() {
+        rects_.clear();
+    }
+
+    //! The smallest rect containing the region; (0, 0, 0, 0) if it is empty.
+    rect_t bounding_rect() const {
+        if (empty()) {
+            return rect_t(0, 0, 0, 0);
+        }
+
+        auto left  = rects_.front().left;
+        auto right = rects_.front().right;
+
+        for (auto const& r : rects_) {
+            left  = (std::min)(left,  r.left);
+            right = (std::max)(right, r.right);
+        }
+
+        return rect_t(left, rects_.front().top, right, rects_.back().bottom);
+    }
+
+    T area() const {
+        T result = 0;
+
+        for (auto const& r : rects_) {
+            result += r.width() * r.height();
+        }
+
+        return result;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Test if the point (x, y) lies in the region; O(log n).
+    //--------------------------------------------------------------------------
+    bool contains(T x, T y) const {
+        // last rect with top <= y
+        auto it = std::upper_bound(rects_.begin(), rects_.end(), y,
+            [](T const value, rect_t const& r) { return value < r.top; }
+        );
+
+        if (it == rects_.begin()) {
+            return false;
+        }
+
+        auto const band_top = (--it)->top;
+        if (y >= it->bottom) {
+            return false;
+        }
+
+        // the band is [first, it]; find the last rect with left <= x
+        auto const first = std::lower_bound(rects_.begin(), it, band_top,
+            [](rect_t const& r, T const value) { return r.top < value; }
+        );
+
+        auto const span = std::upper_bound(first, it + 1, x,
+            [](T const value, rect_t const& r) { return value < r.left; }
+        );
+
+        return span != first && x < (span - 1)->right;
+    }
+
+    void translate(T dx, T dy) {
+        for (auto& r : rects_) {
+            r.translate(dx, dy);
+        }
+    }
+
+    region& operator|=(region const& rhs) {
+        if (rhs.empty()) return *this;
+        if (empty())     return *this = rhs;
+
+        return *this = combine_(*this, rhs, op_union);
+    }
+
+    region& operator&=(region const& rhs) {
+        return *this = combine_(*this, rhs, op_intersect);
+    }
+
+    region& operator-=(region const& rhs) {
+        if (empty() || rhs.empty()) return *this;
+
+        return *this = combine_(*this, rhs, op_subtract);
+    }
+
+    friend region operator|(region const& a, region const& b) {
+        return region(a) |= b;
+    }
+
+    friend region operator&(region const& a, region const& b) {
+        return combine_(a, b, op_intersect);
+    }
+
+    friend region operator-(region const& a, region const& b) {
+        return region(a) -= b;
+    }
+
+    bool operator==(region const& rhs) const {
+        return rects_.size() == rhs.rects_.size() &&
+            std::equal(rects_.begin(), rects_.end(), rhs.rects_.begin(),
+                [](rect_t const& a, rect_t const& b) {
+                    return a.left  == b.left  && a.top    == b.top &&
+                           a.right == b.right && a.bottom == b.bottom;
+                }
+            );
+    }
+
+    bool operator!=(region const& rhs) const {
+        return !(*this == rhs);
+    }
+private:
+    //! Truth tables indexed by (in_a | in_b << 1).
+    enum op_type {
+        op_union     = 0xE, // 1110
+        op_intersect = 0x8, // 1000
+        op_subtract  = 0x2, // 0010
+    };
+
+    typedef rect_t const* rect_ptr;
+
+    static bool is_empty_(rect_t const& r) {
+        return !(r.left < r.right && r.top < r.bottom);
+    }
+
+    static region union_of_(rect_t* first, rect_t* last) {
+        auto const n = last - first;
+
+        if (n == 0) return region();
+        if (n == 1) return region(*first);
+
+        auto const mid = first + n / 2;
+        return union_of_(first, mid) | union_of_(mid, last);
+    }
+
+    //! The end of the band starting at @c first.
+    static rect_ptr band_end_(rect_ptr first, rect_ptr last) {
+        auto const top = first->top;
+        while (++first != last && first->top == top) {
+        }
+
+        return first;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Combine the spans [a0, a1) and [b0, b1), which are sorted and disjoint,
+    //! emitting the spans for which @c op holds as rects covering [top, bottom).
+    //--------------------------------------------------------------------------
+    static void combine_spans_(
+        rect_ptr a0, rect_ptr const a1,
+        rect_ptr b0, rect_ptr const b1,
+        T const top, T const bottom,
+        op_type const op,
+        container_t& out
+    ) {
+        // edge i of a span list: even -> left of span i/2, odd -> right.
+        auto const na = 2 * (a1 - a0);
+        auto const nb = 2 * (b1 - b0);
+        auto const edge = [](rect_ptr r, ptrdiff_t i) {
+            return (i & 1) ? r[i / 2].right : r[i / 2].left;
+        };
+
+        ptrdiff_t i = 0, j = 0;
+        bool in_a = false, in_b = false, open = false;
+        T start = 0;
+
+        while (i < na || j < nb) {
+            auto const x =
+                (i == na) ? edge(b0, j) :
+                (j == nb) ? edge(a0, i) :
+                (std::min)(edge(a0, i), edge(b0, j));
+
+            while (i < na && edge(a0, i) == x) { in_a = (i & 1) == 0; ++i; }
+            while (j < nb && edge(b0, j) == x) { in_b = (j & 1) == 0; ++j; }
+
+            auto const keep = ((op >> (in_a | (in_b << 1))) & 1) != 0;
+
+            if (keep && !open) {
+                start = x;
+                open  = true;
+            } else if (!keep && open) {
+                out.push_back(rect_t(start, top, x, bottom));
+                open = false;
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Merge the band [cur, end) into the band [prev, cur) if they are
+    //! vertically adjacent and have identical spans.
+    //! @return the start of the last band in @c out.
+    //--------------------------------------------------------------------------
+    static size_t coalesce_(container_t& out, size_t prev, size_t cur) {
+        auto const end = out.size();
+
+        if (prev == cur || cur == end) {
+            return cur == end ? prev : cur;
+        }
+
+        if (cur - prev != end - cur || out[prev].bottom != out[cur].top) {
+            return cur;
+        }
+
+        for (size_t i = 0; i < cur - prev; ++i) {
+            if (out[prev + i].left  != out[cur + i].left ||
+                out[prev + i].right != out[cur + i].right
+            ) {
+                return cur;
+            }
+        }
+
+        auto const bottom = out[cur].bottom;
+        for (size_t i = prev; i < cur; ++i) {
+            out[i].bottom = bottom;
+        }
+
+        out.erase(out.begin() + cur, out.end());
+        return prev;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Sweep both regions top to bottom over the y intervals delimited by the
+    //! band edges of either, combining the spans active in each interval.
+    //--------------------------------------------------------------------------
+    static region combine_(region const& a, region const& b, op_type const op) {
+        region result;
+        if (a.empty() && b.empty()) {
+            return result;
+        }
+
+        auto& out = result.rects_;
+        out.reserve(a.size() + b.size());
+
+        auto a_first = a.rects_.data(), a_last = a_first + a.size();
+        auto b_first = b.rects_.data(), b_last = b_first + b.size();
+
+        auto a_end = (a_first != a_last) ? band_end_(a_first, a_last) : a_last;
+        auto b_end = (b_first != b_last) ? band_end_(b_first, b_last) : b_last;
+
+        bool const need_a = (op & 0x2) != 0; // a-only area is kept
+        bool const need_b = (op & 0x4) != 0; // b-only area is kept
+
+        size_t prev_band = 0;
+
+        T y = (a_first == a_last) ? b_first->top :
+              (b_first == b_last) ? a_first->top :
+              (std::min)(a_first->top, b_first->top);
+
+        while (a_first != a_last || b_first != b_last) {
+            bool const has_a = a_first != a_last;
+            bool const has_b = b_first != b_last;
+
+            // nothing more can be produced
+            if ((!has_a && !need_b) || (!has_b && !need_a)) {
+                break;
+            }
+
+            bool const in_a = has_a && a_first->top <= y;
+            bool const in_b = has_b && b_first->top <= y;
+
+            // the end of the current y interval
+            auto next = y;
+            bool set  = false;
+            auto const limit = [&](T v) {
+                next = set ? (std::min)(next, v) : v;
+                set  = true;
+            };
+
+            if (has_a) limit(in_a ? a_first->bottom : a_first->top);
+            if (has_b) limit(in_b ? b_first->bottom : b_first->top);
+
+            if (in_a || in_b) {
+                auto const cur_band = out.size();
+
+                combine_spans_(
+                    a_first, in_a ? a_end : a_first,
+                    b_first, in_b ? b_end : b_first,
+                    y, next, op, out
+                );
+
+                prev_band = coalesce_(out, prev_band, cur_band);
+            }
+
+            y = next;
+
+            if (has_a && a_first->bottom <= y) {
+                a_first = a_end;
+                a_end   = (a_first != a_last) ? band_end_(a_first, a_last) : a_last;
+            }
+
+            if (has_b && b_first->bottom <= y) {
+                b_first = b_end;
+                b_end   = (b_first != b_last) ? band_end_(b_first, b_last) : b_last;
+            }
+        }
+
+        return result;
+    }
+
+    container_t rects_;
+};
+
+} //namespace math
+} //namespace bklib
@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Skyline bin packing of rectangles.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace math {
+
+//------------------------------------------------------------------------------
+//! Packs rectangles into a fixed size bin using the skyline bottom-left
+//! heuristic.
+//!
+//! The packed area is described by its upper outline, the skyline: a list of
+//! horizontal segments covering the width of the bin. A new rectangle is
+//! placed on the skyline where its bottom edge ends up lowest, breaking ties
+//! on the narrowest segment. Space under the skyline is never reused, which
+//! keeps insertion O(n) in the number of segments; sorting input by height
+//! beforehand keeps that waste small.
+//------------------------------------------------------------------------------
+class skyline_packer {
+public:
+    typedef rect<int32_t> rect_t;
+
+    skyline_packer(int32_t width, int32_t height)
+        : width_(width)
+        , height_(height)
+        , used_area_(0)
+    {
+        BK_ASSERT_MSG(width > 0 && height > 0, "empty bin");
+        clear();
+    }
+
+    //--------------------------------------------------------------------------
+    //! Find room for a @c w by @c h rectangle.
+    //! @param out
+    //!     Receives the placement if there is room.
+    //! @return false if the rectangle doesn't fit.
+    //--------------------------------------------------------------------------
+    bool insert(int32_t w, int32_t h, rect_t& out) {
+        BK_ASSERT_MSG(w > 0 && h > 0, "empty rect");
+
+        auto best_bottom = (std::numeric_limits<int32_t>::max)();
+        auto best_width  = (std::numeric_limits<int32_t>::max)();
+        auto best_index  = skyline_.size();
+        auto best_y      = 0;
+
+        for (size_t i = 0; i < skyline_.size(); ++i) {
+            int32_t y;
+            if (!fit_(i, w, h, y)) {
+                continue;
+            }
+
+            auto const bottom = y + h;
+            auto const seg_w  = skyline_[i].width;
+
+            if (bottom < best_bottom || (bottom == best_bottom && seg_w < best_width)) {
+                best_bottom = bottom;
+                best_width  = seg_w;
+                best_index  = i;
+                best_y      = y;
+            }
+        }
+
+        if (best_index == skyline_.size()) {
+            return false;
+        }
+
+        auto const x = skyline_[best_index].x;
+        add_(best_index, x, best_y + h, w);
+
+        used_area_ += static_cast<int64_t>(w) * h;
+        out = rect_t(x, best_y, x + w, best_y + h);
+
+        return true;
+    }
+
+    //! Forget every placement.
+    void clear() {
+        skyline_.clear();
+        skyline_.push_back(segment(0, 0, width_));
+        used_area_ = 0;
+    }
+
+    int32_t width()  const { return width_; }
+    int32_t height() const { return height_; }
+
+    //! Sum of the areas of the rectangles placed.
+    int64_t used_area() const {
+        return used_area_;
+    }
+
+    //! Fraction of the bin below the skyline that is in use.
+    double occupancy() const {
+        int64_t covered = 0;
+        for (auto const& s : skyline_) {
+            covered += static_cast<int64_t>(s.width) * s.y;
+        }
+
+        return covered ? static_cast<double>(used_area_) / covered : 1.0;
+    }
+private:
+    struct segment {
+        segment(int32_t x, int32_t y, int32_t width)
+            : x(x), y(y), width(width)
+        {
+        }
+
+        int32_t x;
+        int32_t y;     //!< height of the skyline over [x, x + width).
+        int32_t width;
+    };
+
+    //--------------------------------------------------------------------------
+    //! Can a w by h rectangle sit on the skyline starting at segment @c i?
+    //! @param y
+    //!     Receives the top of the rectangle: the highest segment under it.
+    //--------------------------------------------------------------------------
+    bool fit_(size_t i, int32_t w, int32_t h, int32_t& y) const {
+        auto const x = skyline_[i].x;
+        if (x + w > width_) {
+            return false;
+        }
+
+        y = 0;
+        for (auto left = w; left > 0; ++i) {
+            y = (std::max)(y, skyline_[i].y);
+            if (y + h > height_) {
+                return false;
+            }
+
+            left -= skyline_[i].width;
+        }
+
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Raise the skyline over [x, x + w) to @c y; segment @c i starts at x.
+    //--------------------------------------------------------------------------
+    void add_(size_t i, int32_t x, int32_t y, int32_t w) {
+        skyline_.insert(skyline_.begin() + i, segment(x, y, w));
+
+        // trim or remove the segments the new one now covers.
+        auto const right = x + w;
+        auto const j     = i + 1;
+
+        while (j < skyline_.size() && skyline_[j].x < right) {
+            auto& s = skyline_[j];
+            auto const s_right = s.x + s.width;
+
+            if (s_right <= right) {
+                skyline_.erase(skyline_.begin() + j);
+            } else {
+                s.width = s_right - right;
+                s.x     = right;
+                break;
+            }
+        }
+
+        // merge neighbours of equal height.
+        for (size_t k = (i ? i - 1 : 0); k + 1 < skyline_.size() && k <= i + 1; ) {
+            if (skyline_[k].y == skyline_[k + 1].y) {
+                skyline_[k].width += skyline_[k + 1].width;
+                skyline_.erase(skyline_.begin() + k + 1);
+            } else {
+                ++k;
+            }
+        }
+    }
+
+    int32_t              width_;
+    int32_t              height_;
+    int64_t              used_area_;
+    std::vector<segment> skyline_;
+};
+
+} //namespace math
+} //namespace bklib
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Uniform (hashed) grid used to accelerate rectangle queries.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace math {
+
+//------------------------------------------------------------------------------
+//! Sparse uniform grid mapping rectangles to the cells they overlap.
+//! Each value is stored in every cell its rectangle touches; a point query
+//! only visits the values in a single cell, so its cost depends on the local
+//! density rather than on the total number of values.
+//! @t-param V
+//!     Value type; must be cheap to copy and equality comparable.
+//! @t-param T
+//!     Scalar type of the rectangles.
+//------------------------------------------------------------------------------
+template <typename V, typename T = float>
+class spatial_grid {
+public:
+    typedef V       value_t;
+    typedef rect<T> rect_t;
+
+    static unsigned const DEFAULT_CELL_SIZE = 64;
+
+    explicit spatial_grid(T cell_size = static_cast<T>(DEFAULT_CELL_SIZE))
+        : cell_size_(cell_size)
+    {
+        BK_ASSERT_MSG(cell_size > 0, "invalid cell size");
+    }
+
+    //--------------------------------------------------------------------------
+    //! Add @c value covering the area @c r.
+    //--------------------------------------------------------------------------
+    void insert(value_t value, rect_t const& r) {
+        auto const range = get_range_(r);
+
+        for (index_t y = range.y0; y <= range.y1; ++y) {
+            for (index_t x = range.x0; x <= range.x1; ++x) {
+                cells_[make_key_(x, y)].push_back(value);
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Remove @c value previously added with the area @c r.
+    //--------------------------------------------------------------------------
+    void remove(value_t value, rect_t const& r) {
+        auto const range = get_range_(r);
+
+        for (index_t y = range.y0; y <= range.y1; ++y) {
+            for (index_t x = range.x0; x <= range.x1; ++x) {
+                erase_(make_key_(x, y), value);
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Move @c value from the area @c old_r to the area @c new_r. Only the
+    //! cells that differ between the two areas are touched.
+    //--------------------------------------------------------------------------
+    void update(value_t value, rect_t const& old_r, rect_t const& new_r) {
+        auto const a = get_range_(old_r);
+        auto const b = get_range_(new_r);
+
+        if (a == b) {
+            return;
+        }
+
+        for (index_t y = a.y0; y <= a.y1; ++y) {
+            for (index_t x = a.x0; x <= a.x1; ++x) {
+                if (!b.contains(x, y)) erase_(make_key_(x, y), value);
+            }
+        }
+
+        for (index_t y = b.y0; y <= b.y1; ++y) {
+            for (index_t x = b.x0; x <= b.x1; ++x) {
+                if (!a.contains(x, y)) cells_[make_key_(x, y)].push_back(value);
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Call @c f(value) for every value whose area @e might contain the point
+    //! (x, y); callers are expected to do the exact test themselves.
+    //--------------------------------------------------------------------------
+    template <typename F>
+    void for_each_at(T x, T y, F&& f) const {
+        auto const it = cells_.find(make_key_(get_index_(x), get_index_(y)));
+        if (it == cells_.end()) {
+            return;
+        }
+
+        for (auto const& value : it->second) {
+            f(value);
+        }
+    }
+
+    void clear() {
+        cells_.clear();
+    }
+
+    T cell_size() const {
+        return cell_size_;
+    }
+private:
+    typedef int32_t  index_t;
+    typedef uint64_t key_t;
+
+    struct cell_range {
+        bool contains(index_t x, index_t y) const {
+            return x >= x0 && x <= x1 && y >= y0 && y <= y1;
+        }
+
+        bool operator==(cell_range const& rhs) const {
+            return x0 == rhs.x0 && y0 == rhs.y0 &&
+                   x1 == rhs.x1 && y1 == rhs.y1;
+        }
+
+        index_t x0, y0, x1, y1;
+    };
+
+    index_t get_index_(T v) const {
+        return static_cast<index_t>(std::floor(
+            static_cast<double>(v) / static_cast<double>(cell_size_)
+        ));
+    }
+
+    //! Rectangles are closed, so a right or bottom edge lying exactly on a
+    //! cell boundary also occupies the following cell.
+    cell_range get_range_(rect_t const& r) const {
+        cell_range const result = {
+            get_index_(r.left),  get_index_(r.top),
+            get_index_(r.right), get_index_(r.bottom)
+        };
+
+        return result;
+    }
+
+    static key_t make_key_(index_t x, index_t y) {
+        return (static_cast<key_t>(static_cast<uint32_t>(x)) << 32) |
+                static_cast<key_t>(static_cast<uint32_t>(y));
+    }
+
+    void erase_(key_t key, value_t const& value) {
+        auto const it = cells_.find(key);
+        if (it == cells_.end()) {
+            return;
+        }
+
+        auto& cell = it->second;
+        auto const pos = std::find(cell.begin(), cell.end(), value);
+
+        if (pos != cell.end()) {
+            *pos = cell.back();
+            cell.pop_back();
+        }
+
+        if (cell.empty()) {
+            cells_.erase(it);
+        }
+    }
+
+    T cell_size_;
+    std::unordered_map<key_t, std::vector<value_t>> cells_;
+};
+
+} //namespace math
+} //namespace bklib
@@ -69,3 +69,12 @@
 #else
 #   define BK_NOEXCEPT noexcept
 #endif
+
+//------------------------------------------------------------------------------
+// SIMD instruction set detection (compile time baseline only)
+//------------------------------------------------------------------------------
+#if defined(BK_CONFIG_ARCH_X64)
+#   define BK_CONFIG_SIMD_SSE2
+#elif defined(BK_CONFIG_ARCH_X86) && defined(_M_IX86_FP) && (_M_IX86_FP >= 2)
+#   define BK_CONFIG_SIMD_SSE2
+#endif
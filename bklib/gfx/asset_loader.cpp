@@ -0,0 +1,164 @@
+#include "pch.hpp"
+#include "gfx/asset_loader.hpp"
+
+#include "gfx/targa.hpp"
+
+namespace gfx = ::bklib::gfx;
+
+struct gfx::asset_loader::job {
+    job(utf8string const& path, unsigned id)
+        : path(path), id(id)
+    {
+    }
+
+    utf8string                path;
+    unsigned                  id;
+    std::promise<image_ptr>   promise;
+};
+
+gfx::asset_loader::asset_loader(unsigned threads, texture_cache const* cache)
+    : next_id_(0)
+    , cache_(cache)
+    , stopping_(false)
+{
+    if (threads == 0) {
+        auto const n = std::thread::hardware_concurrency();
+        threads = n > 1 ? n - 1 : 1;
+    }
+
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.push_back(std::thread([this] { work_(); }));
+    }
+}
+
+gfx::asset_loader::~asset_loader() {
+    stopping_ = true;
+
+    // one empty job wakes and stops each worker.
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        jobs_.emplace(std::unique_ptr<job>());
+    }
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+gfx::asset_loader::image_future
+gfx::asset_loader::load_image(utf8string const& path, on_loaded_t on_loaded) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(path);
+
+    if (it == entries_.end()) {
+        auto j = std::make_unique<job>(path, next_id_++);
+
+        auto& e = entries_[path];
+        e.future   = j->promise.get_future().share();
+        e.id       = j->id;
+        e.is_ready = false;
+
+        if (on_loaded) {
+            e.waiting.push_back(std::move(on_loaded));
+        }
+
+        jobs_.emplace(std::move(j));
+        return e.future;
+    }
+
+    auto& e = it->second;
+
+    if (on_loaded) {
+        if (e.is_ready) {
+            completed_.push_back(completion_t(std::move(on_loaded), e.future));
+        } else {
+            e.waiting.push_back(std::move(on_loaded));
+        }
+    }
+
+    return e.future;
+}
+
+size_t gfx::asset_loader::dispatch_completions() {
+    std::vector<completion_t> batch;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.swap(completed_);
+    }
+
+    // outside the lock; handlers may well request more loads.
+    for (auto& c : batch) {
+        c.first(c.second);
+    }
+
+    return batch.size();
+}
+
+void gfx::asset_loader::forget(utf8string const& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(path);
+}
+
+void gfx::asset_loader::work_() {
+    for (;;) {
+        auto j = jobs_.pop();
+        if (!j) {
+            return;
+        } else if (stopping_) {
+            continue; // the promise breaks as j goes out of scope.
+        }
+
+        try {
+            auto result = std::make_shared<image>();
+
+            if (cache_) {
+                result->cached = cache_->load(j->path);
+                result->width      = result->cached->width();
+                result->height     = result->cached->height();
+                result->pixels     = result->cached->pixels();
+                result->mip_levels = result->cached->mip_levels();
+                result->mips       = result->cached->mips();
+            } else {
+                tga::image file(j->path);
+
+                result->width      = file.width();
+                result->height     = file.height();
+                result->mip_levels = 0;
+                result->mips       = nullptr;
+
+                // in size_t; width * height * 4 overflows unsigned for the
+                // largest images a Targa file can hold.
+                auto const row_size = static_cast<size_t>(result->width) * 4;
+                result->buffer.resize(row_size * result->height);
+                result->pixels = result->buffer.data();
+
+                file.decode(result->buffer.data(), static_cast<ptrdiff_t>(row_size), pixel_format::bgra8);
+            }
+
+            j->promise.set_value(std::move(result));
+        } catch (...) {
+            j->promise.set_exception(std::current_exception());
+        }
+
+        finish_(j->path, j->id);
+    }
+}
+
+void gfx::asset_loader::finish_(utf8string const& path, unsigned const id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(path);
+    if (it == entries_.end() || it->second.id != id) {
+        return; // forgotten while loading
+    }
+
+    auto& e = it->second;
+    e.is_ready = true;
+
+    for (auto& handler : e.waiting) {
+        completed_.push_back(completion_t(std::move(handler), e.future));
+    }
+
+    e.waiting.clear();
+}
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Background loading of assets.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+#include "types.hpp"
+#include "util/blocking_queue.hpp"
+#include "gfx/texture_cache.hpp"
+
+namespace bklib { namespace gfx {
+
+//==============================================================================
+//! Loads and decodes images on a pool of worker threads.
+//!
+//! Each path is loaded at most once: later requests for a path that is
+//! pending or loaded share the first request's result. Completion handlers
+//! are not run on the workers; they are queued and run in a batch by
+//! dispatch_completions(), e.g. once per frame on the thread that owns the
+//! renderer.
+//==============================================================================
+class asset_loader {
+public:
+    //! A decoded image: bgra8, top row first, rows packed.
+    struct image {
+        unsigned                   width;
+        unsigned                   height;
+        void const*                pixels;
+        unsigned                   mip_levels; //!< from the cache, if it builds them.
+        void const*                mips;
+        std::vector<char>          buffer;     //!< holds pixels if not cached.
+        texture_cache::texture_ptr cached;     //!< holds pixels if cached.
+    };
+
+    typedef std::shared_ptr<image const>              image_ptr;
+    typedef std::shared_future<image_ptr>             image_future;
+    typedef std::function<void (image_future const&)> on_loaded_t;
+
+    //--------------------------------------------------------------------------
+    //! @param threads
+    //!     Number of workers; 0 for one less than the number of hardware
+    //!     threads, and at least one.
+    //! @param cache
+    //!     If not null, images are loaded through it and must outlive the
+    //!     loader.
+    //--------------------------------------------------------------------------
+    explicit asset_loader(unsigned threads = 0, texture_cache const* cache = nullptr);
+
+    //! Loads that haven't started are abandoned; their futures are broken.
+    ~asset_loader();
+
+    //--------------------------------------------------------------------------
+    //! Start loading the image at @c path, unless it is loading or loaded.
+    //! @param on_loaded
+    //!     Run by dispatch_completions() once the load has finished; the
+    //!     future is ready, and get() rethrows if the load failed.
+    //--------------------------------------------------------------------------
+    image_future load_image(utf8string const& path, on_loaded_t on_loaded = on_loaded_t());
+
+    //--------------------------------------------------------------------------
+    //! Run the handlers of every load finished since the last call on the
+    //! calling thread.
+    //! @return the number of handlers run.
+    //--------------------------------------------------------------------------
+    size_t dispatch_completions();
+
+    //--------------------------------------------------------------------------
+    //! Drop the loader's reference to @c path so the next request loads it
+    //! again; handlers still waiting on it are never run.
+    //--------------------------------------------------------------------------
+    void forget(utf8string const& path);
+private:
+    asset_loader(asset_loader const&); //=delete
+    asset_loader& operator=(asset_loader const&); //=delete
+
+    struct job;
+
+    struct entry {
+        image_future             future;
+        std::vector<on_loaded_t> waiting;
+        unsigned                 id;       //!< tells a reloaded path apart.
+        bool                     is_ready;
+    };
+
+    typedef std::pair<on_loaded_t, image_future> completion_t;
+
+    void work_();
+    void finish_(utf8string const& path, unsigned id);
+
+    std::mutex                              mutex_;
+    std::unordered_map<utf8string, entry>   entries_;
+    std::vector<completion_t>               completed_;
+    unsigned                                next_id_;
+
+    texture_cache const*                    cache_;
+
+    std::atomic<bool>                       stopping_;
+    blocking_queue<std::unique_ptr<job>>    jobs_;
+    std::vector<std::thread>                workers_;
+};
+
+} //namespace gfx
+} //namespace bklib
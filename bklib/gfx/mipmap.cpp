@@ -0,0 +1,378 @@
+#include "pch.hpp"
+#include "gfx/mipmap.hpp"
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+#   include <emmintrin.h>
+#endif
+
+namespace gfx = ::bklib::gfx;
+
+namespace {
+
+typedef uint8_t byte;
+
+//! Rows of the image filtered at a time; they and the rows they make below
+//! stay in cache until used.
+unsigned const CHUNK_ROWS = 16;
+
+//! Images smaller than this many bytes per core are built on one thread.
+size_t const MIN_BAND_SIZE = 1 << 20;
+
+//------------------------------------------------------------------------------
+//! Filters @c out_width pixels from the pair of rows @c row0 and @c row1, of
+//! @c in_width pixels each, into @c out.
+//------------------------------------------------------------------------------
+typedef void (*row_filter_t)(
+    byte const* row0, byte const* row1, byte* out, unsigned out_width, unsigned in_width
+);
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+#define BK_LOAD_128(p)     _mm_loadu_si128(reinterpret_cast<__m128i const*>(p))
+#define BK_STORE_128(p, v) _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v)
+
+//------------------------------------------------------------------------------
+//! 2x2 box filter of 8 pixels from each row to 4, in 16 bit sums.
+//! @return the number of pixels written; the rest are left to box_row.
+//------------------------------------------------------------------------------
+unsigned box_row_sse2(byte const* row0, byte const* row1, byte* out, unsigned n) {
+    auto const zero = _mm_setzero_si128();
+    auto const two  = _mm_set1_epi16(2);
+
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto const a0 = BK_LOAD_128(row0 + i*8);
+        auto const a1 = BK_LOAD_128(row0 + i*8 + 16);
+        auto const b0 = BK_LOAD_128(row1 + i*8);
+        auto const b1 = BK_LOAD_128(row1 + i*8 + 16);
+
+        // vertical sums; two pixels per register.
+        auto const s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        auto const s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        auto const s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        auto const s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        // horizontal sums of the neighbours in each register.
+        auto const h0 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+        auto const h1 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+
+        BK_STORE_128(out + i*4, _mm_packus_epi16(
+            _mm_srli_epi16(_mm_add_epi16(h0, two), 2),
+            _mm_srli_epi16(_mm_add_epi16(h1, two), 2)
+        ));
+    }
+
+    return i;
+}
+
+#undef BK_STORE_128
+#undef BK_LOAD_128
+#endif // BK_CONFIG_SIMD_SSE2
+
+//! The columns of a row above pixel @c x of the row below.
+inline void source_columns(unsigned x, unsigned in_width, unsigned& c0, unsigned& c1) {
+    c0 = (in_width == 1) ? 0 : x * 2 * 4;
+    c1 = (in_width == 1) ? 0 : c0 + 4;
+}
+
+void box_row(
+    byte const* row0, byte const* row1, byte* out, unsigned out_width, unsigned in_width
+) {
+    unsigned x = 0;
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+    if (in_width > 1) {
+        x = box_row_sse2(row0, row1, out, out_width);
+    }
+#endif
+
+    for (; x < out_width; ++x) {
+        unsigned c0, c1;
+        source_columns(x, in_width, c0, c1);
+
+        for (unsigned c = 0; c < 4; ++c) {
+            out[x*4 + c] = static_cast<byte>(
+                (row0[c0 + c] + row0[c1 + c] + row1[c0 + c] + row1[c1 + c] + 2) >> 2
+            );
+        }
+    }
+}
+
+//==============================================================================
+//! sRGB <-> linear light lookups; linear values are 16 bit.
+//==============================================================================
+struct srgb_tables {
+    static unsigned const LINEAR_BITS = 14; //!< precision of to_srgb's index.
+
+    srgb_tables() {
+        for (unsigned i = 0; i < 256; ++i) {
+            auto const c = i / 255.0;
+            auto const l = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+
+            to_linear[i] = static_cast<uint16_t>(l * 65535.0 + 0.5);
+        }
+
+        // each entry holds the encoding of the middle of its interval.
+        for (unsigned i = 0; i < (1u << LINEAR_BITS); ++i) {
+            auto const l = (i + 0.5) / (1u << LINEAR_BITS);
+            auto const c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+
+            to_srgb[i] = static_cast<byte>((std::min)(c * 255.0 + 0.5, 255.0));
+        }
+    }
+
+    uint16_t to_linear[256];
+    byte     to_srgb[1u << LINEAR_BITS];
+};
+
+srgb_tables const SRGB;
+
+void srgb_box_row(
+    byte const* row0, byte const* row1, byte* out, unsigned out_width, unsigned in_width
+) {
+    // 4 16 bit values sum to 18 bits; keep the top LINEAR_BITS.
+    auto const shift = 18 - srgb_tables::LINEAR_BITS;
+    auto const lin   = SRGB.to_linear;
+
+    for (unsigned x = 0; x < out_width; ++x) {
+        unsigned c0, c1;
+        source_columns(x, in_width, c0, c1);
+
+        for (unsigned c = 0; c < 3; ++c) {
+            auto const sum = lin[row0[c0 + c]] + lin[row0[c1 + c]]
+                           + lin[row1[c0 + c]] + lin[row1[c1 + c]];
+
+            out[x*4 + c] = SRGB.to_srgb[sum >> shift];
+        }
+
+        out[x*4 + 3] = static_cast<byte>(
+            (row0[c0 + 3] + row0[c1 + 3] + row1[c0 + 3] + row1[c1 + 3] + 2) >> 2
+        );
+    }
+}
+
+struct level_t {
+    byte*     pixels; //!< level 0 is only ever read.
+    ptrdiff_t stride;
+    unsigned  width;
+    unsigned  height;
+};
+
+//------------------------------------------------------------------------------
+//! Filter every row that the rows done so far allow, from level @c first
+//! down to level @c last.
+//! @param ready
+//!     Rows of each level done so far, counting from the top; updated.
+//------------------------------------------------------------------------------
+void advance(
+    level_t const* levels, unsigned* ready,
+    unsigned first, unsigned last,
+    row_filter_t filter
+) {
+    for (auto l = first; l < last; ++l) {
+        auto const& in  = levels[l];
+        auto const& out = levels[l + 1];
+
+        auto const target = in.height == 1 ? ready[l] : (std::min)(ready[l] / 2, out.height);
+        if (target <= ready[l + 1]) {
+            return;
+        }
+
+        for (auto y = ready[l + 1]; y < target; ++y) {
+            auto const row0 = in.pixels + static_cast<ptrdiff_t>(in.height == 1 ? 0 : y * 2) * in.stride;
+            auto const row1 = in.height == 1 ? row0 : row0 + in.stride;
+
+            filter(row0, row1, out.pixels + static_cast<ptrdiff_t>(y) * out.stride, out.width, in.width);
+        }
+
+        ready[l + 1] = target;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! The texels of a level made from [first, last) of a level @c in_size wide
+//! (or high) above it; odd ones out are dropped, and a single texel feeds a
+//! single texel.
+//------------------------------------------------------------------------------
+void footprint(unsigned in_size, int32_t& first, int32_t& last) {
+    auto const out_size = static_cast<int32_t>(gfx::mip_extent(in_size, 1));
+
+    if (in_size == 1) {
+        first = 0;
+        last  = 1;
+    } else {
+        first = first / 2;
+        last  = (std::min)((last + 1) / 2, out_size);
+    }
+}
+
+//------------------------------------------------------------------------------
+//! Build levels 1 to @c depth below rows [first, last) of the image, a few
+//! rows at a time.
+//------------------------------------------------------------------------------
+void build_band(
+    level_t const* levels, unsigned depth,
+    unsigned first, unsigned last,
+    row_filter_t filter
+) {
+    std::vector<unsigned> ready(depth + 1);
+    for (unsigned l = 0; l <= depth; ++l) {
+        ready[l] = first >> l;
+    }
+
+    for (auto y = first; y < last; ) {
+        y = (std::min)(y + CHUNK_ROWS, last);
+        ready[0] = y;
+        advance(levels, ready.data(), 0, depth, filter);
+    }
+}
+
+} //namespace
+
+unsigned gfx::mip_levels(unsigned const width, unsigned const height) {
+    unsigned n = 0;
+    for (auto size = (std::max)(width, height); size > 1; size >>= 1) {
+        ++n;
+    }
+
+    return n;
+}
+
+size_t gfx::mip_offset(unsigned const width, unsigned const height, unsigned const level) {
+    size_t offset = 0;
+    for (unsigned l = 1; l < level; ++l) {
+        offset += static_cast<size_t>(mip_extent(width, l)) * mip_extent(height, l) * 4;
+    }
+
+    return offset;
+}
+
+void gfx::build_mips(
+    void const* const pixels,
+    unsigned    const width,
+    unsigned    const height,
+    ptrdiff_t   const stride,
+    void*       const out,
+    mip_filter  const filter
+) {
+    auto const n = mip_levels(width, height);
+    if (n == 0 || width == 0 || height == 0) {
+        return;
+    }
+
+    std::vector<level_t> levels(n + 1);
+
+    level_t const base = {
+        const_cast<byte*>(static_cast<byte const*>(pixels)), stride, width, height
+    };
+    levels[0] = base;
+
+    auto next = static_cast<byte*>(out);
+    for (unsigned l = 1; l <= n; ++l) {
+        auto const w = mip_extent(width, l);
+        auto const h = mip_extent(height, l);
+
+        level_t const level = {next, static_cast<ptrdiff_t>(w) * 4, w, h};
+        levels[l] = level;
+
+        next += static_cast<size_t>(w) * h * 4;
+    }
+
+    auto const row_filter = filter == mip_filter::srgb_box ? srgb_box_row : box_row;
+
+    // bands start on a multiple of 2^depth rows, so the first depth levels of
+    // each depend on its own rows only.
+    size_t bands = (std::min)(
+        static_cast<size_t>(height / 2),
+        static_cast<size_t>(width) * height * 4 / MIN_BAND_SIZE
+    );
+    bands = (std::min)(bands, static_cast<size_t>(std::thread::hardware_concurrency()));
+    bands = (std::max)(bands, size_t(1));
+
+    unsigned depth = n;
+    if (bands > 1) {
+        depth = 0;
+        while (depth < n && (2u << depth) <= height / bands) {
+            ++depth;
+        }
+    }
+
+    if (depth == 0) {
+        bands = 1;
+        depth = n;
+    }
+
+    auto const band_first = [&](size_t b) -> unsigned {
+        return b == bands ? height : static_cast<unsigned>(b * height / bands) >> depth << depth;
+    };
+
+    auto const do_band = [&](size_t b) {
+        build_band(levels.data(), depth, band_first(b), band_first(b + 1), row_filter);
+    };
+
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(bands - 1);
+
+    for (size_t b = 1; b < bands; ++b) {
+        tasks.push_back(std::async(std::launch::async, do_band, b));
+    }
+
+    do_band(0);
+
+    for (auto& task : tasks) {
+        task.get();
+    }
+
+    // the small levels left over, from the last complete one.
+    if (depth < n) {
+        std::vector<unsigned> ready(n + 1, 0);
+        ready[depth] = levels[depth].height;
+        advance(levels.data(), ready.data(), depth, n, row_filter);
+    }
+}
+
+gfx::texel_rect gfx::update_mip_level(
+    void const* const in,
+    unsigned    const in_width,
+    unsigned    const in_height,
+    ptrdiff_t   const in_stride,
+    texel_rect  const& region,
+    void*       const out,
+    ptrdiff_t   const out_stride,
+    mip_filter  const filter
+) {
+    BK_ASSERT_MSG(region.left >= 0 && region.top >= 0, "region out of bounds");
+    BK_ASSERT_MSG(region.right  <= static_cast<int32_t>(in_width),  "region out of bounds");
+    BK_ASSERT_MSG(region.bottom <= static_cast<int32_t>(in_height), "region out of bounds");
+
+    auto result = region;
+    if (result.width() <= 0 || result.height() <= 0) {
+        return texel_rect(0, 0, 0, 0);
+    }
+
+    footprint(in_width,  result.left, result.right);
+    footprint(in_height, result.top,  result.bottom);
+
+    if (result.width() <= 0 || result.height() <= 0) {
+        return texel_rect(0, 0, 0, 0);
+    }
+
+    auto const row_filter = filter == mip_filter::srgb_box ? srgb_box_row : box_row;
+
+    // the same rows and columns build_mips would filter, just fewer of them.
+    auto const first_column = in_width == 1 ? 0 : result.left * 2 * 4;
+
+    for (auto y = result.top; y < result.bottom; ++y) {
+        auto const row0 = static_cast<byte const*>(in)
+            + static_cast<ptrdiff_t>(in_height == 1 ? 0 : y * 2) * in_stride
+            + first_column;
+        auto const row1 = in_height == 1 ? row0 : row0 + in_stride;
+
+        row_filter(
+            row0, row1,
+            static_cast<byte*>(out) + static_cast<ptrdiff_t>(y) * out_stride + result.left * 4,
+            static_cast<unsigned>(result.width()), in_width
+        );
+    }
+
+    return result;
+}
@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Mipmap chain generation for bgra8 images.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "common/math.hpp"
+
+namespace bklib { namespace gfx {
+
+//! Texels of one level; half open, [left, right) x [top, bottom).
+typedef math::rect<int32_t> texel_rect;
+
+//==============================================================================
+//! How a level is made from the one above it.
+//==============================================================================
+enum class mip_filter : uint8_t {
+    box,      //!< average each 2x2 block of stored values.
+    srgb_box, //!< average each 2x2 block in linear light; alpha as stored.
+};
+
+//------------------------------------------------------------------------------
+//! The width (or height) of level @c level of a chain: max(1, size >> level).
+//! Level 0 is the image itself.
+//------------------------------------------------------------------------------
+inline unsigned mip_extent(unsigned size, unsigned level) {
+    return (size >> level) ? (size >> level) : 1;
+}
+
+//! Number of levels below a @c width by @c height image, down to 1x1.
+unsigned mip_levels(unsigned width, unsigned height);
+
+//------------------------------------------------------------------------------
+//! Offset in bytes of @c level (1 to mip_levels()) in a chain from
+//! build_mips(); mip_offset(w, h, mip_levels(w, h) + 1) is its size.
+//------------------------------------------------------------------------------
+size_t mip_offset(unsigned width, unsigned height, unsigned level);
+
+//------------------------------------------------------------------------------
+//! The level to sample when drawing with @c scale source texels per
+//! destination pixel along the more shrunk axis: the smallest level with no
+//! more than two texels per pixel. @c levels is the number below the image.
+//------------------------------------------------------------------------------
+inline unsigned mip_level_for(float scale, unsigned levels) {
+    unsigned level = 0;
+    while (level < levels && scale >= static_cast<float>(2u << level)) {
+        ++level;
+    }
+
+    return level;
+}
+
+//------------------------------------------------------------------------------
+//! Build every level below a bgra8 image. Odd rows and columns are dropped,
+//! as with the usual level sizes.
+//!
+//! All the levels are built in one pass down the image: each row is
+//! filtered into the level below as soon as the row it pairs with is done,
+//! while both are still in cache. Large images are split into bands of rows
+//! built in parallel.
+//! @param pixels
+//!     The image, top row first.
+//! @param stride
+//!     Offset in bytes from one row of @c pixels to the next.
+//! @param out
+//!     Receives the levels, largest first, rows packed;
+//!     mip_offset(width, height, mip_levels(width, height) + 1) bytes.
+//------------------------------------------------------------------------------
+void build_mips(
+    void const* pixels, unsigned width, unsigned height, ptrdiff_t stride,
+    void* out,
+    mip_filter filter = mip_filter::box
+);
+
+//------------------------------------------------------------------------------
+//! Rebuild the texels of the level below a bgra8 level that depend on
+//! @c region of it, after that region changed; the rest are left alone.
+//! Applied a level at a time, starting from the image with the rect it
+//! returns, this brings a whole chain from build_mips up to date for the cost
+//! of the change.
+//! @param in, in_width, in_height, in_stride
+//!     The level that changed, top row first.
+//! @param out, out_stride
+//!     The level below it; mip_extent(in_width, 1) by mip_extent(in_height, 1).
+//! @param filter
+//!     The filter the chain was built with.
+//! @return the texels of @c out rebuilt; empty if none depend on @c region.
+//------------------------------------------------------------------------------
+texel_rect update_mip_level(
+    void const* in, unsigned in_width, unsigned in_height, ptrdiff_t in_stride,
+    texel_rect const& region,
+    void* out, ptrdiff_t out_stride,
+    mip_filter filter = mip_filter::box
+);
+
+} //namespace gfx
+} //namespace bklib
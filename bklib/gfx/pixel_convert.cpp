@@ -0,0 +1,570 @@
+#include "pch.hpp"
+#include "gfx/pixel_convert.hpp"
+
+#include "util/cpu.hpp"
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+#   include <emmintrin.h>
+#   include <tmmintrin.h>
+#   include <immintrin.h>
+#endif
+
+namespace gfx = ::bklib::gfx;
+
+namespace {
+
+typedef uint8_t byte;
+
+//------------------------------------------------------------------------------
+//! Converts @c n pixels from @c in to @c out.
+//! @return the number of pixels converted from the front; the SIMD kernels
+//!         stop short of the end rather than touch memory past it.
+//------------------------------------------------------------------------------
+typedef size_t (*kernel_t)(byte const* in, byte* out, size_t n);
+
+//! As kernel_t, looking 8 bit indices up in a 256 entry @c palette.
+typedef size_t (*palette_kernel_t)(
+    byte const* in, byte* out, size_t n, uint32_t const* palette
+);
+
+//==============================================================================
+// Scalar kernels; these also finish whatever the SIMD kernels leave over.
+//==============================================================================
+
+//! 5 bit channel to 8 bits, replicating the high bits into the low ones.
+inline byte expand_5(unsigned x) {
+    return static_cast<byte>((x << 3) | (x >> 2));
+}
+
+//! 24 -> 32 bit; @c swap exchanges the first and third channel.
+template <bool swap>
+size_t expand_24_32(byte const* in, byte* out, size_t n) {
+    for (size_t i = 0; i < n; ++i, in += 3, out += 4) {
+        out[0] = in[swap ? 2 : 0];
+        out[1] = in[1];
+        out[2] = in[swap ? 0 : 2];
+        out[3] = 0xFF;
+    }
+
+    return n;
+}
+
+//! 32 -> 24 bit; @c swap exchanges the first and third channel.
+template <bool swap>
+size_t compress_32_24(byte const* in, byte* out, size_t n) {
+    for (size_t i = 0; i < n; ++i, in += 4, out += 3) {
+        out[0] = in[swap ? 2 : 0];
+        out[1] = in[1];
+        out[2] = in[swap ? 0 : 2];
+    }
+
+    return n;
+}
+
+//! bgra <-> rgba.
+size_t swap_rb_32(byte const* in, byte* out, size_t n) {
+    for (size_t i = 0; i < n; ++i, in += 4, out += 4) {
+        auto const b = in[0];
+        out[0] = in[2];
+        out[1] = in[1];
+        out[2] = b;
+        out[3] = in[3];
+    }
+
+    return n;
+}
+
+//! 5-5-5-1 -> 32 bit; @c swap writes red first.
+template <bool swap>
+size_t expand_16_32(byte const* in, byte* out, size_t n) {
+    for (size_t i = 0; i < n; ++i, in += 2, out += 4) {
+        unsigned const v = in[0] | (in[1] << 8);
+
+        auto const b = expand_5((v >>  0) & 0x1F);
+        auto const g = expand_5((v >>  5) & 0x1F);
+        auto const r = expand_5((v >> 10) & 0x1F);
+
+        out[0] = swap ? r : b;
+        out[1] = g;
+        out[2] = swap ? b : r;
+        out[3] = (v & 0x8000) ? 0xFF : 0x00;
+    }
+
+    return n;
+}
+
+//! 8 bit gray -> 32 bit; the same for either channel order.
+size_t expand_8_32(byte const* in, byte* out, size_t n) {
+    for (size_t i = 0; i < n; ++i, ++in, out += 4) {
+        out[0] = out[1] = out[2] = *in;
+        out[3] = 0xFF;
+    }
+
+    return n;
+}
+
+//! 8 bit index -> 32 bit palette entry; unrolled so the loads can overlap.
+size_t lookup_8_32(byte const* in, byte* out, size_t n, uint32_t const* palette) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t const v[] = {
+            palette[in[i + 0]],
+            palette[in[i + 1]],
+            palette[in[i + 2]],
+            palette[in[i + 3]],
+        };
+
+        std::memcpy(out + i*4, v, sizeof(v));
+    }
+
+    for (; i < n; ++i) {
+        std::memcpy(out + i*4, palette + in[i], 4);
+    }
+
+    return n;
+}
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+//==============================================================================
+// SIMD kernels. Loads and stores are unaligned and never cross the ends of
+// the ranges; the loop conditions keep every full width access in bounds.
+//==============================================================================
+#define BK_LOAD_128(p)     _mm_loadu_si128(reinterpret_cast<__m128i const*>(p))
+#define BK_STORE_128(p, v) _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v)
+#define BK_LOAD_256(p)     _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p))
+#define BK_STORE_256(p, v) _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v)
+
+//! pshufb control for 4 pixels of 24 bit -> 32 bit; the alpha lanes are zeroed.
+#define BK_EXPAND_24_32_MASK(swap) \
+    (swap) ? 2 : 0, 1, (swap) ? 0 : 2, -1, \
+    (swap) ? 5 : 3, 4, (swap) ? 3 : 5, -1, \
+    (swap) ? 8 : 6, 7, (swap) ? 6 : 8, -1, \
+    (swap) ? 11 : 9, 10, (swap) ? 9 : 11, -1
+
+//! pshufb control for 4 pixels of 32 bit -> 24 bit, packed at the bottom.
+#define BK_COMPRESS_32_24_MASK(swap) \
+    (swap) ?  2 :  0,  1, (swap) ?  0 :  2, \
+    (swap) ?  6 :  4,  5, (swap) ?  4 :  6, \
+    (swap) ? 10 :  8,  9, (swap) ?  8 : 10, \
+    (swap) ? 14 : 12, 13, (swap) ? 12 : 14, \
+    -1, -1, -1, -1
+
+#define BK_SWAP_RB_MASK \
+    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+
+template <bool swap>
+size_t expand_24_32_ssse3(byte const* in, byte* out, size_t n) {
+    auto const mask  = _mm_setr_epi8(BK_EXPAND_24_32_MASK(swap));
+    auto const alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+    // 4 pixels per step; the 16 byte load reads 4 bytes of the next pixels.
+    size_t i = 0;
+    for (; i + 6 <= n; i += 4) {
+        auto const v = BK_LOAD_128(in + i*3);
+        BK_STORE_128(out + i*4, _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+    }
+
+    return i;
+}
+
+template <bool swap>
+size_t expand_24_32_avx2(byte const* in, byte* out, size_t n) {
+    auto const mask  = _mm256_setr_epi8(
+        BK_EXPAND_24_32_MASK(swap), BK_EXPAND_24_32_MASK(swap)
+    );
+    auto const alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+    // pshufb can't cross 128 bit lanes, so load 4 pixels into each lane.
+    size_t i = 0;
+    for (; i + 10 <= n; i += 8) {
+        auto const lo = BK_LOAD_128(in + i*3);
+        auto const hi = BK_LOAD_128(in + i*3 + 12);
+        auto const v  = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        BK_STORE_256(out + i*4, _mm256_or_si256(_mm256_shuffle_epi8(v, mask), alpha));
+    }
+
+    return i;
+}
+
+template <bool swap>
+size_t compress_32_24_ssse3(byte const* in, byte* out, size_t n) {
+    auto const mask = _mm_setr_epi8(BK_COMPRESS_32_24_MASK(swap));
+
+    // 12 bytes of output per step; the last 4 bytes of each 16 byte store are
+    // overwritten by the next step or the scalar tail.
+    size_t i = 0;
+    for (; i + 6 <= n; i += 4) {
+        BK_STORE_128(out + i*3, _mm_shuffle_epi8(BK_LOAD_128(in + i*4), mask));
+    }
+
+    return i;
+}
+
+template <bool swap>
+size_t compress_32_24_avx2(byte const* in, byte* out, size_t n) {
+    auto const mask = _mm256_setr_epi8(
+        BK_COMPRESS_32_24_MASK(swap), BK_COMPRESS_32_24_MASK(swap)
+    );
+    // close the 4 byte gap between the lanes' 12 bytes of output.
+    auto const pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+    size_t i = 0;
+    for (; i + 11 <= n; i += 8) {
+        auto const v = _mm256_shuffle_epi8(BK_LOAD_256(in + i*4), mask);
+        BK_STORE_256(out + i*3, _mm256_permutevar8x32_epi32(v, pack));
+    }
+
+    return i;
+}
+
+size_t swap_rb_32_ssse3(byte const* in, byte* out, size_t n) {
+    auto const mask = _mm_setr_epi8(BK_SWAP_RB_MASK);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        BK_STORE_128(out + i*4, _mm_shuffle_epi8(BK_LOAD_128(in + i*4), mask));
+    }
+
+    return i;
+}
+
+size_t swap_rb_32_avx2(byte const* in, byte* out, size_t n) {
+    auto const mask = _mm256_setr_epi8(BK_SWAP_RB_MASK, BK_SWAP_RB_MASK);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        BK_STORE_256(out + i*4, _mm256_shuffle_epi8(BK_LOAD_256(in + i*4), mask));
+    }
+
+    return i;
+}
+
+template <bool swap>
+size_t expand_16_32_sse2(byte const* in, byte* out, size_t n) {
+    auto const mask_5     = _mm_set1_epi16(0x1F);
+    auto const mask_alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto const v = BK_LOAD_128(in + i*2);
+
+        auto b = _mm_and_si128(v, mask_5);
+        auto g = _mm_and_si128(_mm_srli_epi16(v, 5),  mask_5);
+        auto r = _mm_and_si128(_mm_srli_epi16(v, 10), mask_5);
+
+        b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+        g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+        r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+
+        // all ones for a set alpha bit
+        auto const a = _mm_srai_epi16(v, 15);
+
+        auto const lo = _mm_or_si128(swap ? r : b, _mm_slli_epi16(g, 8));
+        auto const hi = _mm_or_si128(swap ? b : r, _mm_and_si128(a, mask_alpha));
+
+        BK_STORE_128(out + i*4,      _mm_unpacklo_epi16(lo, hi));
+        BK_STORE_128(out + i*4 + 16, _mm_unpackhi_epi16(lo, hi));
+    }
+
+    return i;
+}
+
+template <bool swap>
+size_t expand_16_32_avx2(byte const* in, byte* out, size_t n) {
+    auto const mask_5     = _mm256_set1_epi16(0x1F);
+    auto const mask_alpha = _mm256_set1_epi16(static_cast<short>(0xFF00));
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto const v = BK_LOAD_256(in + i*2);
+
+        auto b = _mm256_and_si256(v, mask_5);
+        auto g = _mm256_and_si256(_mm256_srli_epi16(v, 5),  mask_5);
+        auto r = _mm256_and_si256(_mm256_srli_epi16(v, 10), mask_5);
+
+        b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+        g = _mm256_or_si256(_mm256_slli_epi16(g, 3), _mm256_srli_epi16(g, 2));
+        r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+
+        auto const a = _mm256_srai_epi16(v, 15);
+
+        auto const lo = _mm256_or_si256(swap ? r : b, _mm256_slli_epi16(g, 8));
+        auto const hi = _mm256_or_si256(swap ? b : r, _mm256_and_si256(a, mask_alpha));
+
+        // the unpacks work within lanes: [0-3 | 8-11] and [4-7 | 12-15].
+        auto const p0 = _mm256_unpacklo_epi16(lo, hi);
+        auto const p1 = _mm256_unpackhi_epi16(lo, hi);
+
+        BK_STORE_256(out + i*4,      _mm256_permute2x128_si256(p0, p1, 0x20));
+        BK_STORE_256(out + i*4 + 32, _mm256_permute2x128_si256(p0, p1, 0x31));
+    }
+
+    return i;
+}
+
+size_t expand_8_32_sse2(byte const* in, byte* out, size_t n) {
+    auto const ones = _mm_set1_epi8(-1);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto const v = BK_LOAD_128(in + i);
+
+        auto const ll_lo = _mm_unpacklo_epi8(v, v);
+        auto const la_lo = _mm_unpacklo_epi8(v, ones);
+        auto const ll_hi = _mm_unpackhi_epi8(v, v);
+        auto const la_hi = _mm_unpackhi_epi8(v, ones);
+
+        BK_STORE_128(out + i*4,      _mm_unpacklo_epi16(ll_lo, la_lo));
+        BK_STORE_128(out + i*4 + 16, _mm_unpackhi_epi16(ll_lo, la_lo));
+        BK_STORE_128(out + i*4 + 32, _mm_unpacklo_epi16(ll_hi, la_hi));
+        BK_STORE_128(out + i*4 + 48, _mm_unpackhi_epi16(ll_hi, la_hi));
+    }
+
+    return i;
+}
+
+size_t expand_8_32_avx2(byte const* in, byte* out, size_t n) {
+    auto const ones = _mm256_set1_epi8(-1);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        auto const v = BK_LOAD_256(in + i);
+
+        // 8 source bytes to the bottom of each lane: [0-7 | 8-15], then
+        // [16-23 | 24-31].
+        __m256i const halves[] = {
+            _mm256_permute4x64_epi64(v, 0x50),
+            _mm256_permute4x64_epi64(v, 0xFA),
+        };
+
+        for (int j = 0; j < 2; ++j) {
+            auto const ll = _mm256_unpacklo_epi8(halves[j], halves[j]);
+            auto const la = _mm256_unpacklo_epi8(halves[j], ones);
+            auto const p0 = _mm256_unpacklo_epi16(ll, la);
+            auto const p1 = _mm256_unpackhi_epi16(ll, la);
+
+            BK_STORE_256(out + i*4 + j*64,      _mm256_permute2x128_si256(p0, p1, 0x20));
+            BK_STORE_256(out + i*4 + j*64 + 32, _mm256_permute2x128_si256(p0, p1, 0x31));
+        }
+    }
+
+    return i;
+}
+
+//! 8 indices widened to 32 bits and looked up with one gather.
+size_t lookup_8_32_avx2(byte const* in, byte* out, size_t n, uint32_t const* palette) {
+    auto const table = reinterpret_cast<int const*>(palette);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto const i0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(in + i)));
+        auto const i1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(in + i + 8)));
+
+        BK_STORE_256(out + i*4,      _mm256_i32gather_epi32(table, i0, 4));
+        BK_STORE_256(out + i*4 + 32, _mm256_i32gather_epi32(table, i1, 4));
+    }
+
+    return i;
+}
+
+#undef BK_SWAP_RB_MASK
+#undef BK_COMPRESS_32_24_MASK
+#undef BK_EXPAND_24_32_MASK
+#undef BK_STORE_256
+#undef BK_LOAD_256
+#undef BK_STORE_128
+#undef BK_LOAD_128
+#endif // BK_CONFIG_SIMD_SSE2
+
+//==============================================================================
+//! The fastest kernel for each conversion, picked once at start up.
+//==============================================================================
+struct kernel_table {
+    kernel_table()
+        : bgr_bgra(nullptr), bgr_rgba(nullptr)
+        , bgra_bgr(nullptr), rgba_bgr(nullptr)
+        , swap_rb(nullptr)
+        , bgr5a1_bgra(nullptr), bgr5a1_rgba(nullptr)
+        , gray(nullptr)
+        , palette(nullptr)
+    {
+#if defined(BK_CONFIG_SIMD_SSE2)
+        auto const cpu = bklib::detect_cpu_features();
+
+        bgr5a1_bgra = expand_16_32_sse2<false>;
+        bgr5a1_rgba = expand_16_32_sse2<true>;
+        gray        = expand_8_32_sse2;
+
+        if (cpu.ssse3) {
+            bgr_bgra = expand_24_32_ssse3<false>;
+            bgr_rgba = expand_24_32_ssse3<true>;
+            bgra_bgr = compress_32_24_ssse3<false>;
+            rgba_bgr = compress_32_24_ssse3<true>;
+            swap_rb  = swap_rb_32_ssse3;
+        }
+
+        if (cpu.avx2) {
+            bgr_bgra    = expand_24_32_avx2<false>;
+            bgr_rgba    = expand_24_32_avx2<true>;
+            bgra_bgr    = compress_32_24_avx2<false>;
+            rgba_bgr    = compress_32_24_avx2<true>;
+            swap_rb     = swap_rb_32_avx2;
+            bgr5a1_bgra = expand_16_32_avx2<false>;
+            bgr5a1_rgba = expand_16_32_avx2<true>;
+            gray        = expand_8_32_avx2;
+            palette     = lookup_8_32_avx2;
+        }
+#endif
+    }
+
+    kernel_t bgr_bgra;
+    kernel_t bgr_rgba;
+    kernel_t bgra_bgr;
+    kernel_t rgba_bgr;
+    kernel_t swap_rb;
+    kernel_t bgr5a1_bgra;
+    kernel_t bgr5a1_rgba;
+    kernel_t gray;
+
+    palette_kernel_t palette;
+};
+
+kernel_table const KERNELS;
+
+//------------------------------------------------------------------------------
+//! Run @c simd (if any) over the ranges and @c scalar over what it leaves.
+//------------------------------------------------------------------------------
+template <typename src, typename dest>
+void run(
+    kernel_t simd, kernel_t scalar,
+    void const* in_begin,  void const* in_end,
+    void*       out_begin, void*       out_end
+) {
+    auto const in  = static_cast<byte const*>(in_begin);
+    auto const out = static_cast<byte*>(out_begin);
+
+    auto const in_size  = static_cast<byte const*>(in_end) - in;
+    auto const out_size = static_cast<byte*>(out_end) - out;
+
+    BK_ASSERT_MSG(in_size  >= 0, "bad pointers");
+    BK_ASSERT_MSG(out_size >= 0, "bad pointers");
+    BK_ASSERT_MSG(in_size  % src::bytes  == 0, "wrong size");
+    BK_ASSERT_MSG(out_size % dest::bytes == 0, "wrong size");
+    BK_ASSERT_MSG(in_size / src::bytes == out_size / dest::bytes, "wrong size");
+
+    auto const n    = static_cast<size_t>(in_size) / src::bytes;
+    auto const done = simd ? simd(in, out, n) : 0;
+
+    scalar(in + done*src::bytes, out + done*dest::bytes, n - done);
+}
+
+} //namespace
+
+#define BK_DEFINE_CONVERT(src, dest, simd, scalar)               \
+template <>                                                      \
+void gfx::convert<gfx::src, gfx::dest>(                          \
+    void const* in_begin,  void const* in_end,                   \
+    void*       out_begin, void*       out_end                   \
+) {                                                              \
+    run<gfx::src, gfx::dest>(KERNELS.simd, scalar,               \
+        in_begin, in_end, out_begin, out_end                     \
+    );                                                           \
+}
+
+BK_DEFINE_CONVERT(bgr8,   bgra8, bgr_bgra,    expand_24_32<false>)
+BK_DEFINE_CONVERT(bgr8,   rgba8, bgr_rgba,    expand_24_32<true>)
+BK_DEFINE_CONVERT(bgra8,  bgr8,  bgra_bgr,    compress_32_24<false>)
+BK_DEFINE_CONVERT(bgra8,  rgba8, swap_rb,     swap_rb_32)
+BK_DEFINE_CONVERT(rgba8,  bgr8,  rgba_bgr,    compress_32_24<true>)
+BK_DEFINE_CONVERT(rgba8,  bgra8, swap_rb,     swap_rb_32)
+BK_DEFINE_CONVERT(bgr5a1, bgra8, bgr5a1_bgra, expand_16_32<false>)
+BK_DEFINE_CONVERT(bgr5a1, rgba8, bgr5a1_rgba, expand_16_32<true>)
+BK_DEFINE_CONVERT(gray8,  bgra8, gray,        expand_8_32)
+BK_DEFINE_CONVERT(gray8,  rgba8, gray,        expand_8_32)
+
+#undef BK_DEFINE_CONVERT
+
+namespace {
+
+void copy_pixels(
+    void const* in_begin,  void const* in_end,
+    void*       out_begin, void*       out_end
+) {
+    auto const size = static_cast<byte const*>(in_end) - static_cast<byte const*>(in_begin);
+
+    BK_ASSERT_MSG(size >= 0, "bad pointers");
+    BK_ASSERT_MSG(size == static_cast<byte*>(out_end) - static_cast<byte*>(out_begin), "wrong size");
+
+    std::memcpy(out_begin, in_begin, static_cast<size_t>(size));
+}
+
+} //namespace
+
+size_t gfx::bytes_per_pixel(pixel_format const format) {
+    switch (format) {
+    case pixel_format::gray8  : return gray8::bytes;
+    case pixel_format::bgr5a1 : return bgr5a1::bytes;
+    case pixel_format::bgr8   : return bgr8::bytes;
+    case pixel_format::bgra8  : return bgra8::bytes;
+    case pixel_format::rgba8  : return rgba8::bytes;
+    case pixel_format::index8 : return 1;
+    }
+
+    BK_ASSERT_MSG(false, "unknown format");
+    return 0;
+}
+
+gfx::convert_fn gfx::find_converter(pixel_format const src, pixel_format const dest) {
+    if (src == dest) {
+        return copy_pixels;
+    }
+
+    switch (src) {
+    case pixel_format::gray8 :
+        if (dest == pixel_format::bgra8) return convert<gray8, bgra8>;
+        if (dest == pixel_format::rgba8) return convert<gray8, rgba8>;
+        break;
+    case pixel_format::bgr5a1 :
+        if (dest == pixel_format::bgra8) return convert<bgr5a1, bgra8>;
+        if (dest == pixel_format::rgba8) return convert<bgr5a1, rgba8>;
+        break;
+    case pixel_format::bgr8 :
+        if (dest == pixel_format::bgra8) return convert<bgr8, bgra8>;
+        if (dest == pixel_format::rgba8) return convert<bgr8, rgba8>;
+        break;
+    case pixel_format::bgra8 :
+        if (dest == pixel_format::bgr8)  return convert<bgra8, bgr8>;
+        if (dest == pixel_format::rgba8) return convert<bgra8, rgba8>;
+        break;
+    case pixel_format::rgba8 :
+        if (dest == pixel_format::bgr8)  return convert<rgba8, bgr8>;
+        if (dest == pixel_format::bgra8) return convert<rgba8, bgra8>;
+        break;
+    case pixel_format::index8 :
+        break;
+    }
+
+    return nullptr;
+}
+
+void gfx::expand_palette(
+    void const* in_begin,  void const* in_end,
+    void*       out_begin, void*       out_end,
+    uint32_t const* palette
+) {
+    auto const in  = static_cast<byte const*>(in_begin);
+    auto const out = static_cast<byte*>(out_begin);
+
+    auto const in_size  = static_cast<byte const*>(in_end) - in;
+    auto const out_size = static_cast<byte*>(out_end) - out;
+
+    BK_ASSERT_MSG(palette, "null palette");
+    BK_ASSERT_MSG(in_size >= 0 && out_size >= 0, "bad pointers");
+    BK_ASSERT_MSG(in_size * 4 == out_size, "wrong size");
+
+    auto const n    = static_cast<size_t>(in_size);
+    auto const done = KERNELS.palette ? KERNELS.palette(in, out, n, palette) : 0;
+
+    lookup_8_32(in + done, out + done*4, n - done, palette);
+}
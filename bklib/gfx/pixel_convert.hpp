@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Pixel formats and conversions between them.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+namespace bklib { namespace gfx {
+
+//==============================================================================
+//! One channel of a pixel format: @c N bits tagged with what they hold.
+//==============================================================================
+template <size_t N, typename tag_t, typename storage_t = uint8_t>
+struct color_component {
+    static size_t const bits = N;
+    typedef tag_t     type;
+    typedef storage_t storage;
+};
+
+namespace color {
+    struct tag_none;
+    struct tag_r;
+    struct tag_g;
+    struct tag_b;
+    struct tag_a;
+    struct tag_l; //!< luminance
+
+    template <typename T>
+    struct none : public color_component<0, tag_none, typename T::storage> {
+    };
+
+    typedef color_component<8, tag_r> r8;
+    typedef color_component<8, tag_g> g8;
+    typedef color_component<8, tag_b> b8;
+    typedef color_component<8, tag_a> a8;
+    typedef color_component<8, tag_l> l8;
+
+    typedef color_component<5, tag_r, uint16_t> r5;
+    typedef color_component<5, tag_g, uint16_t> g5;
+    typedef color_component<5, tag_b, uint16_t> b5;
+    typedef color_component<1, tag_a, uint16_t> a1;
+} //namespace color
+
+//==============================================================================
+//! A pixel format; components are listed from the lowest address (or, for
+//! packed formats, the least significant bits) up.
+//==============================================================================
+template <
+    typename C1,
+    typename C2 = color::none<C1>,
+    typename C3 = color::none<C2>,
+    typename C4 = color::none<C3>
+>
+struct color_format {
+    static_assert(
+        std::is_same<typename C1::storage, typename C2::storage>::value &&
+        std::is_same<typename C2::storage, typename C3::storage>::value &&
+        std::is_same<typename C3::storage, typename C4::storage>::value
+        , "mismatched storage types"
+    );
+
+    static size_t const bits  = C1::bits + C2::bits + C3::bits + C4::bits;
+    static size_t const bytes = bits / 8;
+};
+
+typedef color_format<color::l8>                                  gray8;
+typedef color_format<color::b8, color::g8, color::r8>            bgr8;
+typedef color_format<color::b8, color::g8, color::r8, color::a8> bgra8;
+typedef color_format<color::r8, color::g8, color::b8, color::a8> rgba8;
+typedef color_format<color::b5, color::g5, color::r5, color::a1> bgr5a1;
+
+// the layouts Targa files store
+typedef gray8  tga_8;
+typedef bgr5a1 tga_16;
+typedef bgr8   tga_24;
+typedef bgra8  tga_32;
+
+//------------------------------------------------------------------------------
+//! Convert the pixels in [in_begin, in_end) from @c src to @c dest, writing
+//! them to [out_begin, out_end); both ranges must hold the same number of
+//! pixels. Neither range needs any alignment, and nothing outside of them is
+//! read or written. Formats without alpha convert to opaque pixels.
+//!
+//! Implemented for:
+//!     bgr8   -> bgra8, rgba8
+//!     bgra8  -> bgr8,  rgba8
+//!     rgba8  -> bgr8,  bgra8
+//!     bgr5a1 -> bgra8, rgba8
+//!     gray8  -> bgra8, rgba8
+//!
+//! The widest of AVX2, SSSE3 and SSE2 that the processor supports is used,
+//! with scalar code for the last few pixels.
+//------------------------------------------------------------------------------
+template <typename src, typename dest>
+void convert(
+    void const* in_begin,  void const* in_end,
+    void*       out_begin, void*       out_end
+);
+
+template <> void convert<bgr8,   bgra8>(void const*, void const*, void*, void*);
+template <> void convert<bgr8,   rgba8>(void const*, void const*, void*, void*);
+template <> void convert<bgra8,  bgr8 >(void const*, void const*, void*, void*);
+template <> void convert<bgra8,  rgba8>(void const*, void const*, void*, void*);
+template <> void convert<rgba8,  bgr8 >(void const*, void const*, void*, void*);
+template <> void convert<rgba8,  bgra8>(void const*, void const*, void*, void*);
+template <> void convert<bgr5a1, bgra8>(void const*, void const*, void*, void*);
+template <> void convert<bgr5a1, rgba8>(void const*, void const*, void*, void*);
+template <> void convert<gray8,  bgra8>(void const*, void const*, void*, void*);
+template <> void convert<gray8,  rgba8>(void const*, void const*, void*, void*);
+
+//==============================================================================
+//! Pixel formats named at run time, e.g. from a file header.
+//==============================================================================
+enum class pixel_format : uint8_t {
+    gray8,
+    bgr5a1,
+    bgr8,
+    bgra8,
+    rgba8,
+    index8, //!< indices into a separate palette; see expand_palette.
+};
+
+//! Size of one pixel of @c format.
+size_t bytes_per_pixel(pixel_format format);
+
+//! A conversion with the signature of convert<src, dest>.
+typedef void (*convert_fn)(
+    void const* in_begin,  void const* in_end,
+    void*       out_begin, void*       out_end
+);
+
+//------------------------------------------------------------------------------
+//! The conversion from @c src to @c dest; a copy if they are the same, and
+//! nullptr if there is none.
+//------------------------------------------------------------------------------
+convert_fn find_converter(pixel_format src, pixel_format dest);
+
+//------------------------------------------------------------------------------
+//! Replace each 8 bit index in [in_begin, in_end) by its entry in @c palette,
+//! writing the 32 bit pixels to [out_begin, out_end).
+//!
+//! @c palette holds 256 entries already in the format wanted, so any 32 bit
+//! layout works; unused entries should be zero filled. Uses AVX2 gathers when
+//! the processor supports them.
+//------------------------------------------------------------------------------
+void expand_palette(
+    void const* in_begin,  void const* in_end,
+    void*       out_begin, void*       out_end,
+    uint32_t const* palette
+);
+
+} //namespace gfx
+} //namespace bklib
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  The interface renderer backends implement; private to renderer2d.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "gfx/renderer/renderer2d/renderer2d.hpp"
+
+namespace bklib { namespace gfx2d {
+
+//------------------------------------------------------------------------------
+//! What renderer forwards to; the transform stack is kept by renderer, so a
+//! backend only sees the combined matrix through set_transform().
+//------------------------------------------------------------------------------
+struct renderer::impl_t {
+    virtual ~impl_t() {}
+
+    virtual void update() = 0;
+    virtual void resize(unsigned w, unsigned h) = 0;
+
+    virtual solid_color_brush& get_solid_brush() = 0;
+    virtual std::unique_ptr<solid_color_brush> create_soild_brush(color color) = 0;
+
+    virtual void begin() = 0;
+    virtual void end() = 0;
+
+    virtual void clear(color color) = 0;
+
+    virtual void push_clip_rect(rect const& r) = 0;
+    virtual void pop_clip_rect() = 0;
+
+    virtual void fill_rect(rect const& r, brush const& b) = 0;
+    virtual void draw_rect(rect const& r, brush const& b, float width) = 0;
+    virtual void draw_text(rect const& r, utf8string const& text) = 0;
+
+    virtual void set_transform(matrix const& m) = 0;
+
+    virtual texture_handle create_texture(
+        unsigned        w,
+        unsigned        h,
+        void const*     data,
+        unsigned        mip_levels,
+        void const*     mips,
+        gfx::mip_filter filter
+    ) = 0;
+    virtual void destroy_texture(texture_handle tex) = 0;
+    //! (0, 0, width, height) of the image; throws cache_exception if @c tex
+    //! is stale.
+    virtual texel_rect texture_bounds(texture_handle tex) = 0;
+    virtual void update_texture_region(texture_handle tex, texel_rect const& region, void const* data) = 0;
+
+    virtual void draw_texture(texture_handle tex, rect src, rect dest) = 0;
+    virtual void draw_sprites(texture_handle tex, sprite const* sprites, size_t count) = 0;
+};
+
+//! The software backend, drawing into @c target; see software.hpp.
+std::unique_ptr<renderer::impl_t> make_software_backend(framebuffer& target);
+
+} //namespace gfx2d
+} //namespace bklib
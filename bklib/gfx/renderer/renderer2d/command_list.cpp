@@ -0,0 +1,332 @@
+#include "pch.hpp"
+#include "command_list.hpp"
+
+namespace g2d = ::bklib::gfx2d;
+
+namespace {
+
+//! How many batches back a draw may move to join a batch with its key.
+size_t const MAX_LOOKBACK = 16;
+
+//! A texture draw's color; textures are not drawn with the solid brush.
+uint32_t const NO_COLOR = 0xFFFFFFFF;
+
+//------------------------------------------------------------------------------
+//! Consecutive (after reordering) draws of the same texture and color, and the
+//! bounds of everything they touch. The kind of draw is not part of the key:
+//! fills, outlines and text of one color all draw with the solid brush, so
+//! they share a batch.
+//------------------------------------------------------------------------------
+struct batch {
+    batch(uint64_t texture, uint32_t color, g2d::rect const& bounds)
+        : texture(texture)
+        , color(color)
+        , bounds(bounds)
+    {
+    }
+
+    uint64_t              texture; //!< 0 for none.
+    uint32_t              color;
+    g2d::rect             bounds;
+    std::vector<uint32_t> items;
+};
+
+g2d::rect make_rect(float const (&r)[4]) {
+    return g2d::rect(r[0], r[1], r[2], r[3]);
+}
+
+g2d::rect unite(g2d::rect const& a, g2d::rect const& b) {
+    return g2d::rect(
+        (std::min)(a.left,  b.left),  (std::min)(a.top,    b.top),
+        (std::max)(a.right, b.right), (std::max)(a.bottom, b.bottom)
+    );
+}
+
+} //namespace
+
+g2d::command_list::command_list()
+    : sorted_(true)
+{
+}
+
+void g2d::command_list::reset() {
+    commands_.clear();
+    colors_.clear();
+    text_.clear();
+    order_.clear();
+    sorted_ = true;
+}
+
+g2d::command_list::command
+g2d::command_list::make_command_(command_type type) {
+    command result;
+    std::memset(&result, 0, sizeof(result));
+
+    result.type  = type;
+    result.color = NO_COLOR;
+
+    return result;
+}
+
+g2d::command_list::command
+g2d::command_list::make_command_(command_type type, rect const& r) {
+    auto result = make_command_(type);
+
+    result.rect[0] = r.left;
+    result.rect[1] = r.top;
+    result.rect[2] = r.right;
+    result.rect[3] = r.bottom;
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+//! Colors are shared so that draws of the same color have the same index; a
+//! list uses only a handful of them.
+//------------------------------------------------------------------------------
+uint32_t g2d::command_list::color_index_(color const& c) {
+    auto const it = std::find_if(std::begin(colors_), std::end(colors_),
+        [&](color const& other) {
+            return other.r == c.r && other.g == c.g && other.b == c.b && other.a == c.a;
+        }
+    );
+
+    if (it != std::end(colors_)) {
+        return static_cast<uint32_t>(it - std::begin(colors_));
+    }
+
+    colors_.push_back(c);
+    return static_cast<uint32_t>(colors_.size() - 1);
+}
+
+void g2d::command_list::fill_rect(rect const& r, color const& c) {
+    auto cmd = make_command_(command_type::fill_rect, r);
+    cmd.color = color_index_(c);
+
+    commands_.push_back(cmd);
+    sorted_ = false;
+}
+
+void g2d::command_list::draw_rect(rect const& r, color const& c, float width) {
+    auto cmd = make_command_(command_type::draw_rect, r);
+    cmd.color = color_index_(c);
+    cmd.width = width;
+
+    commands_.push_back(cmd);
+    sorted_ = false;
+}
+
+void g2d::command_list::draw_text(rect const& r, color const& c, utf8string const& text) {
+    auto cmd = make_command_(command_type::draw_text, r);
+    cmd.color = color_index_(c);
+    cmd.text  = static_cast<uint32_t>(text_.size());
+
+    text_.push_back(text);
+    commands_.push_back(cmd);
+    sorted_ = false;
+}
+
+void g2d::command_list::draw_texture(texture_handle tex, rect const& src, rect const& dest) {
+    auto cmd = make_command_(command_type::draw_texture, dest);
+    cmd.texture.src[0] = src.left;
+    cmd.texture.src[1] = src.top;
+    cmd.texture.src[2] = src.right;
+    cmd.texture.src[3] = src.bottom;
+    cmd.texture.index  = tex.index;
+    cmd.texture.count  = tex.count;
+
+    commands_.push_back(cmd);
+    sorted_ = false;
+}
+
+void g2d::command_list::push_clip_rect(rect const& r) {
+    commands_.push_back(make_command_(command_type::push_clip_rect, r));
+    sorted_ = false;
+}
+
+void g2d::command_list::pop_clip_rect() {
+    commands_.push_back(make_command_(command_type::pop_clip_rect));
+    sorted_ = false;
+}
+
+void g2d::command_list::push_transform(matrix const& m) {
+    auto cmd = make_command_(command_type::push_transform);
+    cmd.m[0] = m.m11; cmd.m[1] = m.m12;
+    cmd.m[2] = m.m21; cmd.m[3] = m.m22;
+    cmd.m[4] = m.dx;  cmd.m[5] = m.dy;
+
+    commands_.push_back(cmd);
+    sorted_ = false;
+}
+
+void g2d::command_list::pop_transform() {
+    commands_.push_back(make_command_(command_type::pop_transform));
+    sorted_ = false;
+}
+
+void g2d::command_list::append(command_list const& other) {
+    commands_.reserve(commands_.size() + other.commands_.size());
+
+    auto const text_base = static_cast<uint32_t>(text_.size());
+    text_.insert(std::end(text_), std::begin(other.text_), std::end(other.text_));
+
+    std::vector<uint32_t> colors;
+    colors.reserve(other.colors_.size());
+    for (auto const& c : other.colors_) {
+        colors.push_back(color_index_(c));
+    }
+
+    for (auto cmd : other.commands_) {
+        if (cmd.color != NO_COLOR) {
+            cmd.color = colors[cmd.color];
+        }
+
+        if (cmd.type == command_type::draw_text) {
+            cmd.text += text_base;
+        }
+
+        commands_.push_back(cmd);
+    }
+
+    sorted_ = false;
+}
+
+//------------------------------------------------------------------------------
+//! Clip and transform changes split the list into runs of draws that share a
+//! coordinate space; draws never move out of their run. Within a run, each
+//! draw joins the latest batch of its texture and color, unless a batch after
+//! that one overlaps it, and the batches are issued in order. Moving a draw
+//! ahead of only the draws it does not overlap leaves the image unchanged.
+//!
+//! Text can spill out of its rect, so it is treated as covering everything.
+//------------------------------------------------------------------------------
+void g2d::command_list::sort_() const {
+    order_.clear();
+    order_.reserve(commands_.size());
+
+    std::vector<batch> batches;
+
+    auto const flush = [&] {
+        for (auto const& b : batches) {
+            order_.insert(std::end(order_), std::begin(b.items), std::end(b.items));
+        }
+
+        batches.clear();
+    };
+
+    auto const max        = (std::numeric_limits<float>::max)();
+    auto const everything = rect(-max, -max, max, max);
+
+    for (uint32_t i = 0; i < commands_.size(); ++i) {
+        auto const& cmd = commands_[i];
+
+        auto     bounds  = make_rect(cmd.rect);
+        uint64_t texture = 0;
+
+        switch (cmd.type) {
+        case command_type::fill_rect :
+            break;
+        case command_type::draw_rect : {
+            auto const half = cmd.width * 0.5f;
+            bounds = rect(
+                bounds.left  - half, bounds.top    - half,
+                bounds.right + half, bounds.bottom + half
+            );
+        } break;
+        case command_type::draw_text :
+            bounds = everything;
+            break;
+        case command_type::draw_texture :
+            // handles from the cache never have a count of 0.
+            texture = static_cast<uint64_t>(cmd.texture.count) << 32 | cmd.texture.index;
+            break;
+        default :
+            flush();
+            order_.push_back(i);
+            continue;
+        }
+
+        auto const first = batches.size() > MAX_LOOKBACK
+          ? batches.size() - MAX_LOOKBACK
+          : 0;
+
+        auto target = batches.size();
+
+        for (auto j = batches.size(); j-- > first; ) {
+            auto const& b = batches[j];
+
+            if (b.texture == texture && b.color == cmd.color) {
+                target = j;
+                break;
+            } else if (math::intersects(b.bounds, bounds)) {
+                break;
+            }
+        }
+
+        if (target == batches.size()) {
+            batches.push_back(batch(texture, cmd.color, bounds));
+        } else {
+            batches[target].bounds = unite(batches[target].bounds, bounds);
+        }
+
+        batches[target].items.push_back(i);
+    }
+
+    flush();
+    sorted_ = true;
+}
+
+void g2d::command_list::replay(renderer& r) const {
+    if (!sorted_) {
+        sort_();
+    }
+
+    auto&    brush   = r.get_solid_brush();
+    uint32_t current = NO_COLOR;
+
+    auto const use_color = [&](uint32_t c) {
+        if (c != current) {
+            brush.set_color(colors_[c]);
+            current = c;
+        }
+    };
+
+    for (auto const i : order_) {
+        auto const& cmd = commands_[i];
+
+        switch (cmd.type) {
+        case command_type::fill_rect :
+            use_color(cmd.color);
+            r.fill_rect(make_rect(cmd.rect), brush);
+            break;
+        case command_type::draw_rect :
+            use_color(cmd.color);
+            r.draw_rect(make_rect(cmd.rect), brush, cmd.width);
+            break;
+        case command_type::draw_text :
+            use_color(cmd.color);
+            r.draw_text(make_rect(cmd.rect), text_[cmd.text]);
+            break;
+        case command_type::draw_texture :
+            r.draw_texture(
+                texture_handle(cmd.texture.index, static_cast<uint16_t>(cmd.texture.count)),
+                make_rect(cmd.texture.src), make_rect(cmd.rect)
+            );
+            break;
+        case command_type::push_clip_rect :
+            r.push_clip_rect(make_rect(cmd.rect));
+            break;
+        case command_type::pop_clip_rect :
+            r.pop_clip_rect();
+            break;
+        case command_type::push_transform :
+            r.push_transform(matrix(
+                cmd.m[0], cmd.m[1], cmd.m[2], cmd.m[3], cmd.m[4], cmd.m[5]
+            ));
+            break;
+        case command_type::pop_transform :
+            r.pop_transform();
+            break;
+        }
+    }
+}
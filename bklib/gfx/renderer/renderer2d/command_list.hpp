@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Recorded 2D draw calls that can be replayed into a renderer.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "gfx/renderer/renderer2d/renderer2d.hpp"
+
+namespace bklib { namespace gfx2d {
+
+//------------------------------------------------------------------------------
+//! A list of draw calls recorded once and replayed any number of times, e.g.
+//! by a widget that has not changed since the last frame.
+//!
+//! Solid colors are recorded by value rather than as brushes, so replay()
+//! draws everything with the renderer's solid brush. On replay, draws between
+//! two clip or transform changes are grouped by texture and color, so that
+//! the backend sees fewer state changes. A draw only moves ahead of the draws
+//! it does not overlap, so the result is the same as drawing in order.
+//------------------------------------------------------------------------------
+class command_list {
+public:
+    command_list();
+
+    //! Forget all of the commands.
+    void reset();
+
+    bool   empty() const { return commands_.empty(); }
+    size_t size()  const { return commands_.size(); }
+
+    void fill_rect(rect const& r, color const& c);
+    void draw_rect(rect const& r, color const& c, float width = 1.0f);
+    void draw_text(rect const& r, color const& c, utf8string const& text);
+    void draw_texture(texture_handle tex, rect const& src, rect const& dest);
+
+    void push_clip_rect(rect const& r);
+    void pop_clip_rect();
+
+    void push_transform(matrix const& m);
+    void pop_transform();
+
+    //! Append the commands of @c other, e.g. a widget's cached list.
+    void append(command_list const& other);
+
+    //--------------------------------------------------------------------------
+    //! Issue the commands to @c r, between its draw_begin() and draw_end().
+    //! Pushes and pops must be balanced. The order is worked out on the first
+    //! replay after a change and kept for later ones.
+    //--------------------------------------------------------------------------
+    void replay(renderer& r) const;
+private:
+    enum class command_type : uint8_t {
+        fill_rect,
+        draw_rect,
+        draw_text,
+        draw_texture,
+        push_clip_rect,
+        pop_clip_rect,
+        push_transform,
+        pop_transform,
+    };
+
+    //! @c color indexes colors_; @c rect is the destination for draws.
+    struct command {
+        command_type type;
+        uint32_t     color;
+        float        rect[4];
+
+        union {
+            float    m[6];   //!< push_transform
+            float    width;  //!< draw_rect
+            uint32_t text;   //!< draw_text; indexes text_.
+            struct {
+                float    src[4];
+                uint32_t index; //!< of the texture_handle.
+                uint32_t count; //!< of the texture_handle.
+            } texture;       //!< draw_texture
+        };
+    };
+
+    static command make_command_(command_type type);
+    static command make_command_(command_type type, rect const& r);
+
+    uint32_t color_index_(color const& c);
+
+    void sort_() const;
+
+    std::vector<command>    commands_;
+    std::vector<color>      colors_;
+    std::vector<utf8string> text_;
+
+    mutable std::vector<uint32_t> order_; //!< indices into commands_.
+    mutable bool                  sorted_;
+};
+
+} //namespace gfx2d
+} //namespace bklib
@@ -1,12 +1,26 @@
 #include "pch.hpp"
 #include "renderer2d.hpp"
+#include "backend.hpp"
 
 #include "platform/win/d2d.ipp"
 
 namespace gfx = ::bklib::gfx2d;
 
 gfx::renderer::renderer(bklib::window& win)
-    : impl_(new impl_t(win))
+    : impl_(new d2d_backend(win))
+    , transform_stack_(1, matrix::identity())
+    , transform_dirty_(true)
+    , partial_(false)
+    , damage_(0.0f, 0.0f, 0.0f, 0.0f)
+{
+}
+
+gfx::renderer::renderer(framebuffer& target)
+    : impl_(make_software_backend(target))
+    , transform_stack_(1, matrix::identity())
+    , transform_dirty_(true)
+    , partial_(false)
+    , damage_(0.0f, 0.0f, 0.0f, 0.0f)
 {
 }
 
@@ -19,13 +33,53 @@ void gfx::renderer::update() {
 
 void gfx::renderer::draw_begin() {
     impl_->begin();
+
+    BK_ASSERT_MSG(transform_stack_.size() == 1, "unbalanced push_transform");
+    transform_stack_.resize(1);
+    transform_stack_.back() = matrix::identity();
+    transform_dirty_ = true;
+
+    partial_ = false;
+}
+
+void gfx::renderer::draw_begin(region const& damage) {
+    draw_begin();
+
+    partial_ = true;
+    damage_  = damage.bounding_rect();
+
+    update_transform_();
+    impl_->push_clip_rect(damage_);
 }
 
 void gfx::renderer::draw_end() {
+    if (partial_) {
+        impl_->pop_clip_rect();
+        partial_ = false;
+    }
+
     impl_->end();
 }
 
-void gfx::renderer::clear(gfx::color color) {
+bool gfx::renderer::is_damaged_(rect const& r) const {
+    if (!partial_) {
+        return true;
+    }
+
+    auto const d = transform_stack_.back().apply(r);
+
+    return d.left < damage_.right  && damage_.left < d.right &&
+           d.top  < damage_.bottom && damage_.top  < d.bottom;
+}
+
+void gfx::renderer::update_transform_() {
+    if (transform_dirty_) {
+        impl_->set_transform(transform_stack_.back());
+        transform_dirty_ = false;
+    }
+}
+
+void gfx::renderer::clear(color color) {
     impl_->clear(color);
 }
 
@@ -35,10 +89,25 @@ gfx::renderer::create_solid_brush(color color) {
 }
 
 void gfx::renderer::fill_rect(rect const& r, brush const& b) {
+    if (!is_damaged_(r)) {
+        return;
+    }
+
+    update_transform_();
     impl_->fill_rect(r, b);
 }
 
+//------------------------------------------------------------------------------
+//! The stroke is centered on the edges of @c r, so it reaches half of
+//! @c width outside.
+//------------------------------------------------------------------------------
 void gfx::renderer::draw_rect(rect const& r, brush const& b, float width) {
+    auto const h = width * 0.5f;
+    if (!is_damaged_(rect(r.left - h, r.top - h, r.right + h, r.bottom + h))) {
+        return;
+    }
+
+    update_transform_();
     impl_->draw_rect(r, b, width);
 }
 
@@ -51,23 +120,117 @@ void gfx::renderer::resize(unsigned w, unsigned h) {
     impl_->resize(w, h);
 }
 
-void gfx::renderer::create_texture(unsigned w, unsigned h, void const* data) {
-    impl_->create_texture(w, h, data);
+gfx::texture_handle gfx::renderer::create_texture(
+    unsigned               w,
+    unsigned               h,
+    void const*            data,
+    unsigned               mip_levels,
+    void const*            mips,
+    bklib::gfx::mip_filter filter
+) {
+    return impl_->create_texture(w, h, data, mip_levels, mips, filter);
+}
+
+void gfx::renderer::destroy_texture(texture_handle tex) {
+    impl_->destroy_texture(tex);
 }
 
+void gfx::renderer::update_texture_region(
+    texture_handle    tex,
+    texel_rect const& region,
+    void const*       data
+) {
+    auto const bounds = impl_->texture_bounds(tex);
+
+    if (region.is_degenerate() ||
+        region.left < bounds.left   || region.top    < bounds.top ||
+        region.right > bounds.right || region.bottom > bounds.bottom
+    ) {
+        BOOST_THROW_EXCEPTION(renderer_exception()
+            << bklib::error_message("region out of bounds.")
+        );
+    }
+
+    if (region.width() == 0 || region.height() == 0) {
+        return;
+    }
+
+    impl_->update_texture_region(tex, region, data);
+}
+
+//------------------------------------------------------------------------------
+//! Text can spill out of @c r, so it is never skipped; it is still clipped.
+//------------------------------------------------------------------------------
 void gfx::renderer::draw_text(rect const& r, bklib::utf8string const& text) {
+    update_transform_();
     impl_->draw_text(r, text);
 }
 
-void gfx::renderer::draw_texture(rect src, rect dest) {
-    impl_->draw_texture(src, dest);
+//------------------------------------------------------------------------------
+//! @c tex is looked up before the draw is culled, so a stale handle throws
+//! whether or not the draw touches the damage.
+//------------------------------------------------------------------------------
+void gfx::renderer::draw_texture(texture_handle tex, rect src, rect dest) {
+    impl_->texture_bounds(tex);
+
+    if (!is_damaged_(dest)) {
+        return;
+    }
+
+    update_transform_();
+    impl_->draw_texture(tex, src, dest);
+}
+
+//! As for draw_texture, @c tex is looked up before any sprite is culled.
+void gfx::renderer::draw_sprites(texture_handle tex, sprite const* sprites, size_t count) {
+    impl_->texture_bounds(tex);
+
+    if (partial_) {
+        visible_sprites_.clear();
+
+        std::copy_if(sprites, sprites + count, std::back_inserter(visible_sprites_),
+            [&](sprite const& s) { return is_damaged_(s.dest); }
+        );
+
+        sprites = visible_sprites_.data();
+        count   = visible_sprites_.size();
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    update_transform_();
+    impl_->draw_sprites(tex, sprites, count);
+}
+
+void gfx::renderer::push_transform(matrix const& m) {
+    auto const top = m * transform_stack_.back();
+    transform_stack_.push_back(top);
+    transform_dirty_ = true;
+}
+
+void gfx::renderer::pop_transform() {
+    BK_ASSERT_MSG(transform_stack_.size() > 1, "unbalanced pop_transform");
+    transform_stack_.pop_back();
+    transform_dirty_ = true;
 }
 
 void gfx::renderer::translate(float x, float y) {
-    impl_->translate(x, y);
+    auto& top = transform_stack_.back();
+    top = matrix::translation(x, y) * top;
+    transform_dirty_ = true;
+}
+
+gfx::matrix const& gfx::renderer::get_transform() const {
+    return transform_stack_.back();
 }
 
+//------------------------------------------------------------------------------
+//! The clip rect is in the coordinate space current at the time of the push.
+//------------------------------------------------------------------------------
 void gfx::renderer::push_clip_rect(rect const& r) {
+    update_transform_();
     impl_->push_clip_rect(r);
 }
 
@@ -75,6 +238,3 @@ void gfx::renderer::pop_clip_rect() {
     impl_->pop_clip_rect();
 }
 
-//void gfx::renderer::set_transformation(matrix const& m) {
-//    impl_->set_transformation(m);
-//}
@@ -1,29 +1,69 @@
 #pragma once
 
+#include "exception.hpp"
 #include "util/util.hpp"
+#include "util/cache.hpp"
 #include "gfx/gfx.hpp"
+#include "gfx/mipmap.hpp"
 #include "window/window.hpp"
 #include "common/math.hpp"
+#include "common/affine.hpp"
+#include "common/region.hpp"
 
 namespace bklib {
 namespace gfx2d {
 
-typedef math::rect<float> rect;
-typedef gfx::color_f  color;
+struct renderer_exception : virtual exception_base { };
+
+typedef math::rect<float>    rect;
+typedef math::affine2<float> matrix;
+typedef math::region<float>  region;
+typedef gfx::color_f         color;
+
+//! Texels; half open, [left, right) x [top, bottom).
+typedef math::rect<int32_t>  texel_rect;
+
+//! Names a texture created by renderer::create_texture. A default
+//! constructed handle names nothing.
+typedef detail::cache_base_t::handle_t texture_handle;
 
 class brush;
 class solid_color_brush;
+class framebuffer;
 
 struct translation {
     float x, y, z;
 };
 
+//------------------------------------------------------------------------------
+//! One textured quad for renderer::draw_sprites.
+//------------------------------------------------------------------------------
+struct sprite {
+    sprite(rect const& src, rect const& dest, color const& tint = color(1.0f, 1.0f, 1.0f))
+        : src(src), dest(dest), tint(tint)
+    {
+    }
+
+    rect  src;
+    rect  dest;
+    color tint; //!< multiplies the texels; alpha is the opacity.
+};
+
 //------------------------------------------------------------------------------
 // Renderer for 2D graphics and text
 //------------------------------------------------------------------------------
 class renderer  {
 public:
+    //! Draw to @c win with Direct2D.
     renderer(window& win);
+
+    //--------------------------------------------------------------------------
+    //! Draw into @c target on the CPU, for rendering without a window. Text
+    //! is not drawn, and transforms should be axis aligned. @c target must
+    //! outlive the renderer; resize() resizes it.
+    //--------------------------------------------------------------------------
+    explicit renderer(framebuffer& target);
+
     ~renderer();
 
     void translate(float x, float y, float z);
@@ -32,10 +72,60 @@ public:
 
     void resize(unsigned w, unsigned h);
 
-    void create_texture(unsigned w, unsigned h, void const* data = nullptr);
-    void draw_texture(rect src, rect dest);
+    //--------------------------------------------------------------------------
+    //! Create a @c w by @c h bgra8 texture; any number may be live at once.
+    //! @param data
+    //!     The image, or nullptr to leave the texels undefined until they are
+    //!     set by update_texture_region.
+    //! @param mips
+    //!     @c mip_levels levels below the image, as from gfx::build_mips;
+    //!     draw_texture samples the smallest level that covers the
+    //!     destination rather than the whole image.
+    //! @param filter
+    //!     The filter @c mips were built with; update_texture_region rebuilds
+    //!     them with it.
+    //--------------------------------------------------------------------------
+    texture_handle create_texture(
+        unsigned        w,
+        unsigned        h,
+        void const*     data       = nullptr,
+        unsigned        mip_levels = 0,
+        void const*     mips       = nullptr,
+        gfx::mip_filter filter     = gfx::mip_filter::box
+    );
+
+    //! Free @c tex; using the handle, or a copy of it, afterwards throws
+    //! cache_exception.
+    void destroy_texture(texture_handle tex);
+
+    //--------------------------------------------------------------------------
+    //! Replace the texels of @c region, e.g. a newly packed cell of an atlas,
+    //! from the tightly packed rows of @c data. The texels of each mip level
+    //! that depend on @c region are rebuilt from the image.
+    //! @throw renderer_exception if @c region isn't within the texture.
+    //--------------------------------------------------------------------------
+    void update_texture_region(texture_handle tex, texel_rect const& region, void const* data);
+
+    void draw_texture(texture_handle tex, rect src, rect dest);
+
+    //--------------------------------------------------------------------------
+    //! Draw @c count sprites from @c tex, in order, as one submission to the
+    //! backend; e.g. a whole layer of a tile map. Direct2D applies only the
+    //! alpha of the tint.
+    //--------------------------------------------------------------------------
+    void draw_sprites(texture_handle tex, sprite const* sprites, size_t count);
 
     void draw_begin();
+
+    //--------------------------------------------------------------------------
+    //! Begin a frame that redraws only @c damage, in target coordinates; the
+    //! rest of the target keeps what the last frame drew there. Everything is
+    //! clipped to the damage, and draws that fall wholly outside it are
+    //! skipped. The damage is taken as its bounding rect, as Direct2D clips
+    //! to one axis aligned rect cheaply but needs a layer for any other shape.
+    //--------------------------------------------------------------------------
+    void draw_begin(region const& damage);
+
     void draw_end();
 
     void clear(color color);
@@ -49,14 +139,39 @@ public:
 
     solid_color_brush& get_solid_brush();
 
+    //--------------------------------------------------------------------------
+    //! The transform stack is kept on the CPU; the backend is only given the
+    //! combined matrix, and only before a draw that follows a change.
+    //--------------------------------------------------------------------------
+    //! Push the current transform and prepend @c m to it.
+    void push_transform(matrix const& m);
+    //! Restore the transform saved by the matching push_transform.
+    void pop_transform();
+    //! Prepend a translation to the current transform.
     void translate(float x, float y);
 
+    matrix const& get_transform() const;
+
     void push_clip_rect(rect const& r);
     void pop_clip_rect();
 public:
     struct impl_t;
 private:
+    //! Send the current transform to the backend if it has changed.
+    void update_transform_();
+
+    //! @c false if @c r, in the current coordinate space, is wholly outside
+    //! the damage of a partial frame.
+    bool is_damaged_(rect const& r) const;
+
     std::unique_ptr<impl_t> const impl_;
+
+    std::vector<matrix> transform_stack_; //!< top is the current transform.
+    bool                transform_dirty_;
+
+    bool                partial_;         //!< only damage_ is being redrawn.
+    rect                damage_;
+    std::vector<sprite> visible_sprites_; //!< those of a batch in damage_.
 };
 
 //------------------------------------------------------------------------------
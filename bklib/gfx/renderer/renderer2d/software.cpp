@@ -0,0 +1,548 @@
+#include "pch.hpp"
+#include "gfx/renderer/renderer2d/software.hpp"
+#include "gfx/renderer/renderer2d/backend.hpp"
+
+#include "gfx/mipmap.hpp"
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+#   include <emmintrin.h>
+#endif
+
+namespace g2d = ::bklib::gfx2d;
+
+namespace {
+
+//! Device pixels; half open, [left, right) x [top, bottom).
+typedef ::bklib::math::rect<int32_t> pixel_rect;
+
+uint32_t const ALPHA_MASK = 0xFF000000;
+
+//! Opaque white; texels drawn with it are copied unchanged.
+uint32_t const NO_TINT = 0xFFFFFFFF;
+
+//------------------------------------------------------------------------------
+//! 0xAARRGGBB, rounded to the nearest and clamped.
+//------------------------------------------------------------------------------
+uint32_t pack(g2d::color const& c) {
+    auto const channel = [](float v) {
+        auto const x = v * 255.0f + 0.5f;
+        return static_cast<uint32_t>(x < 0.0f ? 0.0f : (x > 255.0f ? 255.0f : x));
+    };
+
+    return (channel(c.a) << 24) | (channel(c.r) << 16) | (channel(c.g) << 8) | channel(c.b);
+}
+
+//! x / 255 for x in [0, 255 * 255], rounded to the nearest.
+inline uint32_t div_255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+//==============================================================================
+// Span operations; everything drawn comes down to these, one row at a time.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+//! out[0, n) = value.
+//------------------------------------------------------------------------------
+void fill_span(uint32_t* out, size_t n, uint32_t value) {
+    size_t i = 0;
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+    auto const v = _mm_set1_epi32(static_cast<int>(value));
+
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),     v);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), v);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        out[i] = value;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! Draw @c value, which is not premultiplied, over out[0, n).
+//------------------------------------------------------------------------------
+void blend_span(uint32_t* out, size_t n, uint32_t value) {
+    auto const a   = value >> 24;
+    auto const inv = 255 - a;
+
+    // the source term of each channel; alpha itself counts as a channel of 255.
+    uint32_t const src[4] = {
+        (value        & 0xFF) * a,
+        (value >> 8   & 0xFF) * a,
+        (value >> 16  & 0xFF) * a,
+        255 * a,
+    };
+
+    size_t i = 0;
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+    // two pixels per register as 16 bit channels; d * inv + s <= 255 * 255.
+    auto const s = _mm_set_epi16(
+        static_cast<short>(src[3]), static_cast<short>(src[2]),
+        static_cast<short>(src[1]), static_cast<short>(src[0]),
+        static_cast<short>(src[3]), static_cast<short>(src[2]),
+        static_cast<short>(src[1]), static_cast<short>(src[0])
+    );
+    auto const k     = _mm_set1_epi16(static_cast<short>(inv));
+    auto const round = _mm_set1_epi16(128);
+    auto const zero  = _mm_setzero_si128();
+
+    auto const blend = [&](__m128i d) {
+        auto x = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(d, k), s), round);
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    };
+
+    for (; i + 4 <= n; i += 4) {
+        auto const p  = reinterpret_cast<__m128i*>(out + i);
+        auto const d  = _mm_loadu_si128(p);
+        auto const lo = blend(_mm_unpacklo_epi8(d, zero));
+        auto const hi = blend(_mm_unpackhi_epi8(d, zero));
+
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        auto const d = out[i];
+
+        out[i] = div_255((d       & 0xFF) * inv + src[0])
+               | div_255((d >> 8  & 0xFF) * inv + src[1]) << 8
+               | div_255((d >> 16 & 0xFF) * inv + src[2]) << 16
+               | div_255((d >> 24       ) * inv + src[3]) << 24;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! out[0, n) = in[0, n), made opaque; textures are drawn ignoring alpha.
+//------------------------------------------------------------------------------
+void copy_span(uint32_t* out, uint32_t const* in, size_t n) {
+    size_t i = 0;
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+    auto const mask = _mm_set1_epi32(static_cast<int>(ALPHA_MASK));
+
+    for (; i + 4 <= n; i += 4) {
+        auto const p = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(p, mask));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        out[i] = in[i] | ALPHA_MASK;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! out[i] = in[columns[i]] for i in [0, n), made opaque.
+//------------------------------------------------------------------------------
+void gather_span(uint32_t* out, uint32_t const* in, int32_t const* columns, size_t n) {
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        out[i + 0] = in[columns[i + 0]] | ALPHA_MASK;
+        out[i + 1] = in[columns[i + 1]] | ALPHA_MASK;
+        out[i + 2] = in[columns[i + 2]] | ALPHA_MASK;
+        out[i + 3] = in[columns[i + 3]] | ALPHA_MASK;
+    }
+
+    for (; i < n; ++i) {
+        out[i] = in[columns[i]] | ALPHA_MASK;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! As gather_span, but each texel is multiplied by @c tint and drawn over
+//! out[i] with the tint's alpha.
+//------------------------------------------------------------------------------
+void tint_span(uint32_t* out, uint32_t const* in, int32_t const* columns, size_t n, uint32_t tint) {
+    auto const a   = tint >> 24;
+    auto const inv = 255 - a;
+
+    auto const tr = tint >> 16 & 0xFF;
+    auto const tg = tint >> 8  & 0xFF;
+    auto const tb = tint       & 0xFF;
+
+    for (size_t i = 0; i < n; ++i) {
+        auto const t = in[columns[i]];
+        auto const d = out[i];
+
+        auto const r = div_255((t >> 16 & 0xFF) * tr);
+        auto const g = div_255((t >> 8  & 0xFF) * tg);
+        auto const b = div_255((t       & 0xFF) * tb);
+
+        out[i] = div_255(b * a + (d       & 0xFF) * inv)
+               | div_255(g * a + (d >> 8  & 0xFF) * inv) << 8
+               | div_255(r * a + (d >> 16 & 0xFF) * inv) << 16
+               | div_255(255 * a + (d >> 24     ) * inv) << 24;
+    }
+}
+
+bool is_empty(pixel_rect const& r) {
+    return r.left == r.right || r.top == r.bottom;
+}
+
+//==============================================================================
+//! Solid brushes are the only kind; they just hold their color.
+//==============================================================================
+struct software_brush : public g2d::solid_color_brush {
+    explicit software_brush(g2d::color const& color)
+        : color(color)
+    {
+    }
+
+    g2d::color get_color() const override {
+        return color;
+    }
+
+    void set_color(g2d::color const& c) override {
+        color = c;
+    }
+
+    g2d::color color;
+};
+
+//==============================================================================
+//! Draws into a framebuffer on the calling thread. Pixels are covered when
+//! their centers are, as with aliased Direct2D. Transforms are expected to be
+//! axis aligned; anything else draws the bounding box of the result.
+//==============================================================================
+class software_backend : public g2d::renderer::impl_t {
+public:
+    explicit software_backend(g2d::framebuffer& target)
+        : target_(target)
+        , transform_(g2d::matrix::identity())
+        , solid_brush_(g2d::color(0.75f, 0.75f, 0.75f)) // silver
+    {
+        reset_clip_();
+    }
+
+    //! Nothing to present; the owner reads the framebuffer.
+    void update() override {
+    }
+
+    void resize(unsigned w, unsigned h) override {
+        target_.resize(w, h);
+        reset_clip_();
+    }
+
+    g2d::solid_color_brush& get_solid_brush() override {
+        return solid_brush_;
+    }
+
+    std::unique_ptr<g2d::solid_color_brush> create_soild_brush(g2d::color color) override {
+        return std::make_unique<software_brush>(color);
+    }
+
+    void begin() override {
+        transform_ = g2d::matrix::identity();
+        reset_clip_();
+    }
+
+    void end() override {
+        BK_ASSERT_MSG(clip_stack_.size() == 1, "unbalanced push_clip_rect");
+    }
+
+    //! Ignores the transform and any alpha, but not the clip.
+    void clear(g2d::color color) override {
+        fill_(clip_stack_.back(), pack(color) | ALPHA_MASK);
+    }
+
+    void push_clip_rect(g2d::rect const& r) override {
+        clip_stack_.push_back(to_pixels_(r));
+    }
+
+    void pop_clip_rect() override {
+        BK_ASSERT_MSG(clip_stack_.size() > 1, "unbalanced pop_clip_rect");
+        clip_stack_.pop_back();
+    }
+
+    void fill_rect(g2d::rect const& r, g2d::brush const& b) override {
+        fill_(to_pixels_(r), color_of_(b));
+    }
+
+    //! A stroke of @c width centered on the edges, in four pieces that don't
+    //! overlap, so translucent colors blend once.
+    void draw_rect(g2d::rect const& r, g2d::brush const& b, float width) override {
+        auto const color = color_of_(b);
+        auto const h     = width * 0.5f;
+
+        if (r.right - r.left <= width || r.bottom - r.top <= width) {
+            fill_(to_pixels_(g2d::rect(r.left - h, r.top - h, r.right + h, r.bottom + h)), color);
+            return;
+        }
+
+        fill_(to_pixels_(g2d::rect(r.left - h,  r.top - h,    r.right + h, r.top + h)),    color);
+        fill_(to_pixels_(g2d::rect(r.left - h,  r.bottom - h, r.right + h, r.bottom + h)), color);
+        fill_(to_pixels_(g2d::rect(r.left - h,  r.top + h,    r.left + h,  r.bottom - h)), color);
+        fill_(to_pixels_(g2d::rect(r.right - h, r.top + h,    r.right + h, r.bottom - h)), color);
+    }
+
+    //! There is no font rasterizer; text is not drawn.
+    void draw_text(g2d::rect const&, bklib::utf8string const&) override {
+    }
+
+    void set_transform(g2d::matrix const& m) override {
+        transform_ = m;
+    }
+
+    void draw_texture(g2d::texture_handle tex, g2d::rect src, g2d::rect dest) override {
+        blit_(textures_.get(tex), src, dest, NO_TINT);
+    }
+
+    //! One pass over the batch; the per sprite work is that of draw_texture.
+    void draw_sprites(g2d::texture_handle tex, g2d::sprite const* sprites, size_t count) override {
+        auto const& t = textures_.get(tex);
+
+        for (size_t i = 0; i < count; ++i) {
+            auto const& s = sprites[i];
+            blit_(t, s.src, s.dest, pack(s.tint));
+        }
+    }
+
+    g2d::texture_handle create_texture(
+        unsigned                 w,
+        unsigned                 h,
+        void const*              data,
+        unsigned                 mip_levels,
+        void const*              mips,
+        ::bklib::gfx::mip_filter filter
+    ) override {
+        auto result = std::make_unique<texture>();
+        result->filter = filter;
+
+        auto const add_level = [&](unsigned w, unsigned h, void const* pixels) {
+            texture_level level;
+            level.width  = w;
+            level.height = h;
+            level.pixels.resize(static_cast<size_t>(w) * h);
+
+            if (pixels) {
+                std::memcpy(level.pixels.data(), pixels, level.pixels.size() * sizeof(uint32_t));
+            }
+
+            result->levels.push_back(std::move(level));
+        };
+
+        add_level(w, h, data);
+
+        auto const chain = static_cast<uint8_t const*>(mips);
+        for (unsigned l = 1; chain && l <= mip_levels; ++l) {
+            add_level(
+                ::bklib::gfx::mip_extent(w, l),
+                ::bklib::gfx::mip_extent(h, l),
+                chain + ::bklib::gfx::mip_offset(w, h, l)
+            );
+        }
+
+        return textures_.add(std::move(result));
+    }
+
+    void destroy_texture(g2d::texture_handle tex) override {
+        textures_.remove(tex);
+    }
+
+    g2d::texel_rect texture_bounds(g2d::texture_handle tex) override {
+        auto const& image = textures_.get(tex).levels.front();
+        return g2d::texel_rect(0, 0, image.width, image.height);
+    }
+
+    void update_texture_region(
+        g2d::texture_handle    tex,
+        g2d::texel_rect const& region,
+        void const*            data
+    ) override {
+        auto& t     = textures_.get(tex);
+        auto& image = t.levels.front();
+
+        BK_ASSERT_MSG(region.left >= 0 && region.top >= 0, "region out of bounds");
+        BK_ASSERT_MSG(region.right  <= static_cast<int32_t>(image.width),  "region out of bounds");
+        BK_ASSERT_MSG(region.bottom <= static_cast<int32_t>(image.height), "region out of bounds");
+
+        auto const n  = static_cast<size_t>(region.width());
+        auto const in = static_cast<uint32_t const*>(data);
+
+        for (auto y = region.top; y < region.bottom; ++y) {
+            std::memcpy(
+                image.pixels.data() + static_cast<size_t>(y) * image.width + region.left,
+                in + static_cast<size_t>(y - region.top) * n,
+                n * sizeof(uint32_t)
+            );
+        }
+
+        // each level only where the one above it changed.
+        auto changed = region;
+        for (size_t l = 1; l < t.levels.size() && changed.width() > 0; ++l) {
+            auto const& above = t.levels[l - 1];
+            auto&       level = t.levels[l];
+
+            changed = ::bklib::gfx::update_mip_level(
+                above.pixels.data(), above.width, above.height, above.width * 4,
+                changed,
+                level.pixels.data(), level.width * 4,
+                t.filter
+            );
+        }
+    }
+private:
+    software_backend(software_backend const&); //=delete
+    software_backend& operator=(software_backend const&); //=delete
+
+    struct texture_level {
+        unsigned              width;
+        unsigned              height;
+        std::vector<uint32_t> pixels;
+    };
+
+    struct texture {
+        std::vector<texture_level> levels; //!< the image, then its mips.
+        ::bklib::gfx::mip_filter   filter; //!< that the mips were built with.
+    };
+
+    //--------------------------------------------------------------------------
+    //! Nearest neighbour sampling from the level chosen as for Direct2D.
+    //! Rows that map to the source one to one are copied whole; texels are
+    //! only tinted and blended when @c tint is not NO_TINT.
+    //--------------------------------------------------------------------------
+    void blit_(texture const& t, g2d::rect const& src, g2d::rect const& dest, uint32_t tint) {
+        auto const device = transform_.apply(dest);
+        auto const out    = to_pixels_(dest);
+
+        if (is_empty(out) || device.width() <= 0.0f || device.height() <= 0.0f) {
+            return;
+        }
+
+        auto const scale = (std::max)(
+            std::abs(src.right  - src.left) / device.width(),
+            std::abs(src.bottom - src.top)  / device.height()
+        );
+
+        auto const level = ::bklib::gfx::mip_level_for(
+            scale, static_cast<unsigned>(t.levels.size() - 1)
+        );
+
+        auto const& tex = t.levels[level];
+        auto const  k   = 1.0f / static_cast<float>(1u << level);
+
+        // texels per device pixel, and the texel under the device origin.
+        auto const du = (src.right  - src.left) * k / device.width();
+        auto const dv = (src.bottom - src.top)  * k / device.height();
+        auto const u0 = src.left * k - device.left * du;
+        auto const v0 = src.top  * k - device.top  * dv;
+
+        auto const sample = [](float t, int32_t size) {
+            auto const i = static_cast<int32_t>(std::floor(t));
+            return i < 0 ? 0 : (i >= size ? size - 1 : i);
+        };
+
+        auto const w = static_cast<int32_t>(tex.width);
+        auto const h = static_cast<int32_t>(tex.height);
+
+        auto const n = static_cast<size_t>(out.width());
+        columns_.resize(n);
+
+        for (size_t i = 0; i < n; ++i) {
+            auto const x = static_cast<float>(out.left + static_cast<int32_t>(i)) + 0.5f;
+            columns_[i] = sample(u0 + x * du, w);
+        }
+
+        if (tint != NO_TINT) {
+            for (auto y = out.top; y < out.bottom; ++y) {
+                auto const v = sample(v0 + (static_cast<float>(y) + 0.5f) * dv, h);
+                tint_span(
+                    target_.row(static_cast<unsigned>(y)) + out.left,
+                    tex.pixels.data() + static_cast<size_t>(v) * tex.width,
+                    columns_.data(), n, tint
+                );
+            }
+
+            return;
+        }
+
+        auto const is_contiguous = std::adjacent_find(columns_.begin(), columns_.end(),
+            [](int32_t a, int32_t b) { return b != a + 1; }
+        ) == columns_.end();
+
+        for (auto y = out.top; y < out.bottom; ++y) {
+            auto const v   = sample(v0 + (static_cast<float>(y) + 0.5f) * dv, h);
+            auto const in  = tex.pixels.data() + static_cast<size_t>(v) * tex.width;
+            auto const row = target_.row(static_cast<unsigned>(y)) + out.left;
+
+            if (is_contiguous) {
+                copy_span(row, in + columns_.front(), n);
+            } else {
+                gather_span(row, in, columns_.data(), n);
+            }
+        }
+    }
+
+    void reset_clip_() {
+        clip_stack_.assign(1, pixel_rect(
+            0, 0,
+            static_cast<int32_t>(target_.width()),
+            static_cast<int32_t>(target_.height())
+        ));
+    }
+
+    //--------------------------------------------------------------------------
+    //! The pixels whose centers fall in @c r once transformed, clipped.
+    //--------------------------------------------------------------------------
+    pixel_rect to_pixels_(g2d::rect const& r) const {
+        auto const& clip = clip_stack_.back();
+        auto const  d    = transform_.apply(r);
+
+        // clamp before converting, so huge coordinates can't overflow.
+        auto const snap = [](float v, int32_t lo, int32_t hi) {
+            auto const x = std::ceil(v - 0.5f);
+            return x <= lo ? lo : (x >= hi ? hi : static_cast<int32_t>(x));
+        };
+
+        auto const left = snap(d.left, clip.left, clip.right);
+        auto const top  = snap(d.top,  clip.top,  clip.bottom);
+
+        return pixel_rect(
+            left, top,
+            (std::max)(left, snap(d.right,  clip.left, clip.right)),
+            (std::max)(top,  snap(d.bottom, clip.top,  clip.bottom))
+        );
+    }
+
+    static uint32_t color_of_(g2d::brush const& b) {
+        return pack(static_cast<g2d::solid_color_brush const&>(b).get_color());
+    }
+
+    void fill_(pixel_rect const& r, uint32_t color) {
+        auto const alpha = color >> 24;
+        if (is_empty(r) || alpha == 0) {
+            return;
+        }
+
+        auto const n = static_cast<size_t>(r.width());
+
+        for (auto y = r.top; y < r.bottom; ++y) {
+            auto const row = target_.row(static_cast<unsigned>(y)) + r.left;
+
+            if (alpha == 0xFF) {
+                fill_span(row, n, color);
+            } else {
+                blend_span(row, n, color);
+            }
+        }
+    }
+
+    g2d::framebuffer&          target_;
+    g2d::matrix                transform_;
+    std::vector<pixel_rect>    clip_stack_;  //!< top is the current clip.
+    bklib::cache_t<texture>    textures_;
+    std::vector<int32_t>       columns_;     //!< source column per pixel.
+    software_brush             solid_brush_;
+};
+
+} //namespace
+
+std::unique_ptr<g2d::renderer::impl_t> g2d::make_software_backend(framebuffer& target) {
+    return std::make_unique<software_backend>(target);
+}
@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  In-memory render target for the software renderer backend.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "util/assert.hpp"
+
+namespace bklib { namespace gfx2d {
+
+//------------------------------------------------------------------------------
+//! A bgra8 image that a renderer constructed from it draws into on the CPU,
+//! e.g. to render thumbnails without a window. Pixels are 32 bit values,
+//! 0xAARRGGBB, so that they are bgra8 in memory.
+//------------------------------------------------------------------------------
+class framebuffer {
+public:
+    framebuffer(unsigned width, unsigned height)
+        : width_(width)
+        , height_(height)
+        , pixels_(static_cast<size_t>(width) * height)
+    {
+    }
+
+    //! Change the size; the contents are lost.
+    void resize(unsigned width, unsigned height) {
+        width_  = width;
+        height_ = height;
+
+        pixels_.assign(static_cast<size_t>(width) * height, 0);
+    }
+
+    unsigned width()  const { return width_; }
+    unsigned height() const { return height_; }
+
+    //! Offset in bytes from one row to the next.
+    ptrdiff_t stride() const {
+        return static_cast<ptrdiff_t>(width_) * sizeof(uint32_t);
+    }
+
+    uint32_t* row(unsigned y) {
+        BK_ASSERT_MSG(y < height_, "out of range");
+        return pixels_.data() + static_cast<size_t>(y) * width_;
+    }
+
+    uint32_t const* row(unsigned y) const {
+        BK_ASSERT_MSG(y < height_, "out of range");
+        return pixels_.data() + static_cast<size_t>(y) * width_;
+    }
+
+    uint32_t pixel(unsigned x, unsigned y) const {
+        BK_ASSERT_MSG(x < width_, "out of range");
+        return row(y)[x];
+    }
+
+    void const* data() const {
+        return pixels_.data();
+    }
+private:
+    unsigned              width_;
+    unsigned              height_;
+    std::vector<uint32_t> pixels_;
+};
+
+} //namespace gfx2d
+} //namespace bklib
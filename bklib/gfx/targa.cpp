@@ -5,42 +5,97 @@
 
 namespace tga = ::bklib::tga;
 
-tga::image::image(bklib::utf8string filename)
-try {
-    // open as read only binary and seek to end
-    std::ifstream in(filename, std::ios::binary | std::ios::in | std::ios::ate);
-    in.exceptions(std::ios_base::badbit | std::ios_base::failbit);
-        
-    //seek back from the end and read the footer
-    tga::footer footer;
-    in.seekg(0 - sizeof(footer), std::ios::cur);
-    in.read(reinterpret_cast<char*>(&footer), sizeof(footer));
-
-    if (footer.is_valid()) {
-        load_ver_2(in);
+tga::image::image(bklib::utf8string filename, load_mode mode)
+try
+    : pixels_data_(nullptr)
+    , data_size_(0)
+    , first_row_(0)
+    , stride_(0)
+    , rle_first_(nullptr)
+    , rle_last_(nullptr)
+{
+    if (mode == load_mode::map) {
+        file_ = std::make_unique<mapped_file>(filename);
+        load_(file_->begin(), file_->end());
     } else {
-        load_ver_1(in);
+        // open as read only binary and read the whole file in one go
+        std::ifstream in(filename, std::ios::binary | std::ios::in | std::ios::ate);
+        in.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+
+        buffer_.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0, std::ios::beg);
+        in.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size());
+
+        load_(buffer_.data(), buffer_.data() + buffer_.size());
     }
 } catch (bklib::exception_base& e) {
     e << boost::errinfo_file_name(filename);
     throw;
 }
 
-void tga::image::load_ver_2(std::ifstream& in) {
-    load_ver_1(in);   
+void tga::image::load_(byte const* first, byte const* last) {
+    auto const size = static_cast<size_t>(last - first);
+
+    if (size < sizeof(header)) {
+        BOOST_THROW_EXCEPTION(targa_exception()
+            << bklib::error_message("file too small.")
+        );
+    }
+
+    tga::footer footer;
+    if (size >= sizeof(header) + sizeof(footer)) {
+        std::memcpy(&footer, last - sizeof(footer), sizeof(footer));
+    } else {
+        std::memset(&footer, 0, sizeof(footer));
+    }
+
+    if (footer.is_valid()) {
+        load_ver_2(first, last);
+    } else {
+        load_ver_1(first, last);
+    }
+}
+
+void tga::image::load_ver_2(byte const* first, byte const* last) {
+    load_ver_1(first, last);
 }
 
-void tga::image::load_ver_1(std::ifstream& in) {
-    in.seekg(0, std::ios::beg);
-    in.read(reinterpret_cast<char*>(&header_), sizeof(header_));
+void tga::image::load_ver_1(byte const* first, byte const* last) {
+    std::memcpy(&header_, first, sizeof(header_));
+
+    auto const type = header_.image_type;
 
-    if (header_.color_map_type != tga::color_map_type::absent) {
+    if (type != tga::image_type::color_mapped     &&
+        type != tga::image_type::true_color       &&
+        type != tga::image_type::black_white      &&
+        type != tga::image_type::rle_color_mapped &&
+        type != tga::image_type::rle_true_color   &&
+        type != tga::image_type::rle_black_white
+    ) {
+        BOOST_THROW_EXCEPTION(targa_exception()
+            << bklib::error_message("unsupported image type.")
+        );
+    }
+
+    bool const is_rle = type == tga::image_type::rle_color_mapped ||
+                        type == tga::image_type::rle_true_color   ||
+                        type == tga::image_type::rle_black_white;
+
+    bool const is_black_white = type == tga::image_type::black_white ||
+                                type == tga::image_type::rle_black_white;
+
+    bool const is_color_mapped = type == tga::image_type::color_mapped ||
+                                 type == tga::image_type::rle_color_mapped;
+
+    bool const has_color_map = header_.color_map_type == tga::color_map_type::present;
+
+    if (is_color_mapped && !has_color_map) {
         BOOST_THROW_EXCEPTION(targa_exception()
-            << bklib::error_message("color mapped images not supported.")
+            << bklib::error_message("missing color map.")
         );
-    } else if (header_.image_type != tga::image_type::true_color) {
+    } else if (!has_color_map && header_.color_map_type != tga::color_map_type::absent) {
         BOOST_THROW_EXCEPTION(targa_exception()
-            << bklib::error_message("non true color images not supported.")
+            << bklib::error_message("unsupported color map type.")
         );
     }
 
@@ -54,60 +109,553 @@ void tga::image::load_ver_1(std::ifstream& in) {
     auto const depth = header_.image_spec.depth;
     auto const alpha = descriptor.alpha;
 
-    switch (depth) {
-        case 16 : if (alpha == 1) break;
-        case 24 : if (alpha == 0) break;
-        case 32 : if (alpha == 8) break;
+    if (is_black_white) {
+        if (depth != 8 || alpha != 0) {
+            BOOST_THROW_EXCEPTION(targa_exception()
+                << bklib::error_message("unsupported black and white depth.")
+            );
+        }
+    } else if (is_color_mapped) {
+        // the alpha bits describe the color map entries, not the indices.
+        if (depth != 8) {
+            BOOST_THROW_EXCEPTION(targa_exception()
+                << bklib::error_message("unsupported color map index size.")
+            );
+        }
+    } else {
+        switch (depth) {
+            case 16 : if (alpha == 1) break;
+            case 24 : if (alpha == 0) break;
+            case 32 : if (alpha == 8) break;
+            default :
+                BOOST_THROW_EXCEPTION(targa_exception()
+                    << bklib::error_message("invalid alpha value.")
+                );
+            ;
+        }
+    }
+
+    auto const& map_spec   = header_.color_map_spec;
+    auto const  map_length = endian(map_spec.length, endian_type::little);
+    auto const  map_size   = has_color_map ? map_length * ((map_spec.entry_size + 7u) / 8u) : 0u;
+
+    if (has_color_map) {
+        switch (map_spec.entry_size) {
+        case 15 : case 16 : case 24 : case 32 : break;
         default :
             BOOST_THROW_EXCEPTION(targa_exception()
-                << bklib::error_message("invalid alpha value.")
+                << bklib::error_message("unsupported color map entry size.")
+            );
+        }
+    }
+
+    size_t const w = endian(header_.image_spec.width,  endian_type::little);
+    size_t const h = endian(header_.image_spec.height, endian_type::little);
+
+    auto const scanline_size = w * (depth / 8);
+    data_size_ = scanline_size * h;
+
+    // skip past the header, id and color map
+    auto const map_offset = sizeof(header_) + header_.id_length;
+    auto const offset     = map_offset + map_size;
+    auto const size   = static_cast<size_t>(last - first);
+
+    if (size < offset || (!is_rle && size - offset < data_size_)) {
+        BOOST_THROW_EXCEPTION(targa_exception()
+            << bklib::error_message("truncated image data.")
+        );
+    }
+
+    // true color images may carry a color map too; it is of no use to us.
+    if (is_color_mapped) {
+        load_palette_(first + map_offset);
+    }
+
+    if (is_rle) {
+        // decoded on demand; see pixels_() and decode().
+        rle_first_ = first + offset;
+        rle_last_  = last;
+    } else {
+        pixels_data_ = first + offset;
+    }
+
+    // present the rows top down without moving them
+    if (descriptor.top != 0) {
+        first_row_ = 0;
+        stride_    = static_cast<ptrdiff_t>(scanline_size);
+    } else {
+        first_row_ = h ? static_cast<ptrdiff_t>(data_size_ - scanline_size) : 0;
+        stride_    = -static_cast<ptrdiff_t>(scanline_size);
+    }
+}
+
+void tga::image::load_palette_(byte const* map) {
+    auto const& spec   = header_.color_map_spec;
+    auto const  first  = endian(spec.first_entry_index, endian_type::little);
+    auto const  length = endian(spec.length,            endian_type::little);
+
+    // 15 bit entries are 16 bit ones whose top bit means nothing; so are 16
+    // bit entries when the descriptor claims no alpha bits.
+    auto const entry_format =
+        spec.entry_size == 24 ? gfx::pixel_format::bgr8  :
+        spec.entry_size == 32 ? gfx::pixel_format::bgra8 :
+                                gfx::pixel_format::bgr5a1;
+
+    std::vector<uint32_t> entries(length);
+    gfx::find_converter(entry_format, gfx::pixel_format::bgra8)(
+        map, map + length * gfx::bytes_per_pixel(entry_format),
+        entries.data(), entries.data() + entries.size()
+    );
+
+    if (spec.entry_size == 15 ||
+        (spec.entry_size == 16 && header_.image_spec.descriptor.alpha == 0)
+    ) {
+        for (auto& e : entries) {
+            e |= 0xFF000000;
+        }
+    }
+
+    // index i refers to entry i - first; indices outside the map stay zero.
+    palette_.assign(256, 0);
+    for (size_t i = 0; i < entries.size() && first + i < palette_.size(); ++i) {
+        palette_[first + i] = entries[i];
+    }
+}
+
+tga::byte const* tga::image::pixels_() const {
+    if (!is_rle()) {
+        return pixels_data_;
+    }
+
+    // decode in file order: the top row goes where the file keeps it.
+    std::call_once(decoded_once_, [&] {
+        decoded_.resize(data_size_);
+        decode(decoded_.data() + first_row_, stride_, format());
+    });
+
+    return decoded_.data();
+}
+
+bklib::gfx::pixel_format tga::image::format() const {
+    if (is_color_mapped()) {
+        return gfx::pixel_format::index8;
+    }
+
+    switch (header_.image_spec.depth) {
+    case 8  : return gfx::pixel_format::gray8;
+    case 16 : return gfx::pixel_format::bgr5a1;
+    case 24 : return gfx::pixel_format::bgr8;
+    }
+
+    return gfx::pixel_format::bgra8;
+}
+
+namespace {
+
+//! Images smaller than this are decoded on the calling thread.
+size_t const MIN_BAND_SIZE = 1 << 18;
+
+//------------------------------------------------------------------------------
+//! Converts rows of pixels as stored to the format wanted.
+//------------------------------------------------------------------------------
+struct row_converter {
+    //--------------------------------------------------------------------------
+    //! @param palette
+    //!     Receives the table indices are expanded through, if any.
+    //! @throw targa_exception if there is no conversion.
+    //--------------------------------------------------------------------------
+    row_converter(
+        tga::image const&        image,
+        bklib::gfx::pixel_format out_format,
+        std::vector<uint32_t>&   palette
+    )
+        : convert(nullptr)
+        , palette(nullptr)
+        , in_bpp(image.bytes_per_pixel())
+        , out_bpp(bklib::gfx::bytes_per_pixel(out_format))
+        , is_copy(image.format() == out_format)
+    {
+        namespace gfx = ::bklib::gfx;
+
+        // indices expand through the palette, in whichever channel order is
+        // wanted.
+        auto const& source = image.palette();
+        if (image.is_color_mapped() && out_format == gfx::pixel_format::bgra8) {
+            palette = source;
+        } else if (image.is_color_mapped() && out_format == gfx::pixel_format::rgba8) {
+            palette.resize(source.size());
+            gfx::convert<gfx::bgra8, gfx::rgba8>(
+                source.data(),  source.data()  + source.size(),
+                palette.data(), palette.data() + palette.size()
+            );
+        }
+
+        if (!palette.empty()) {
+            this->palette = palette.data();
+        } else if (!(convert = gfx::find_converter(image.format(), out_format))) {
+            BOOST_THROW_EXCEPTION(tga::targa_exception()
+                << bklib::error_message("unsupported conversion.")
+            );
+        }
+    }
+
+    void operator()(tga::byte const* src, tga::byte* dst, size_t count) const {
+        auto const src_end = src + count * in_bpp;
+        auto const dst_end = dst + count * out_bpp;
+
+        if (palette) {
+            bklib::gfx::expand_palette(src, src_end, dst, dst_end, palette);
+        } else {
+            convert(src, src_end, dst, dst_end);
+        }
+    }
+
+    bklib::gfx::convert_fn convert;
+    uint32_t const*        palette; //!< expand indices through this instead.
+    size_t                 in_bpp;
+    size_t                 out_bpp;
+    bool                   is_copy;
+};
+
+//------------------------------------------------------------------------------
+//! What a band of rows needs to decode itself into the output.
+//------------------------------------------------------------------------------
+struct band_decoder {
+    //--------------------------------------------------------------------------
+    //! Decode the file rows [first, last).
+    //! @param decoder
+    //!     Positioned at row @c first for run length encoded images; otherwise
+    //!     nullptr.
+    //--------------------------------------------------------------------------
+    void operator()(unsigned first, unsigned last, tga::rle_decoder* decoder) const {
+        std::vector<tga::byte> scratch(decoder && !convert->is_copy ? in_row_size : 0);
+
+        for (auto i = first; i < last; ++i) {
+            auto const y   = is_top_down ? i : height - 1 - i;
+            auto const dst = out + static_cast<ptrdiff_t>(y) * out_stride;
+
+            if (!decoder) {
+                (*convert)(pixels + i * in_row_size, dst, width);
+            } else if (convert->is_copy) {
+                decoder->decode(dst, width);
+            } else {
+                // a scratch row stays in cache between decode and convert.
+                decoder->decode(scratch.data(), width);
+                (*convert)(scratch.data(), dst, width);
+            }
+        }
+    }
+
+    tga::byte const*     pixels; //!< in file order; null for rle images.
+    tga::byte*           out;
+    ptrdiff_t            out_stride;
+    row_converter const* convert;
+    bool                 is_top_down;
+    unsigned             width;
+    unsigned             height;
+    size_t               in_row_size;
+};
+
+} //namespace
+
+void tga::image::decode(
+    void* const             out,
+    ptrdiff_t const         out_stride,
+    gfx::pixel_format const out_format
+) const {
+    std::vector<uint32_t> palette;
+    row_converter const convert(*this, out_format, palette);
+
+    auto const w = width();
+    auto const h = height();
+
+    band_decoder const band = {
+        pixels_data_,
+        static_cast<byte*>(out),
+        out_stride,
+        &convert,
+        is_top_down(),
+        w,
+        h,
+        w * bytes_per_pixel(),
+    };
+
+    // rows are independent, so split the image into one band per core.
+    size_t bands = (std::min)(
+        static_cast<size_t>(h), data_size_ / MIN_BAND_SIZE
+    );
+    bands = (std::min)(bands, static_cast<size_t>(std::thread::hardware_concurrency()));
+    bands = (std::max)(bands, size_t(1));
+
+    auto const band_first = [&](size_t b) {
+        return static_cast<unsigned>(b * h / bands);
+    };
+
+    // rle packets can span rows; a pass over the packet headers finds the
+    // decoder state at the start of each band.
+    std::vector<rle_decoder> starts;
+
+    if (is_rle()) {
+        rle_decoder decoder(rle_first_, rle_last_, bytes_per_pixel());
+        starts.reserve(bands);
+
+        for (size_t b = 0; b < bands; ++b) {
+            starts.push_back(decoder);
+            decoder.skip(static_cast<size_t>(band_first(b + 1) - band_first(b)) * w);
+        }
+
+        // a packet that doesn't end with the image
+        if (decoder.in_packet()) {
+            BOOST_THROW_EXCEPTION(targa_exception()
+                << bklib::error_message("corrupt rle data.")
             );
-        ;
+        }
+    }
+
+    auto const decode_band = [&](size_t b) {
+        band(band_first(b), band_first(b + 1), starts.empty() ? nullptr : &starts[b]);
+    };
+
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(bands - 1);
+
+    for (size_t b = 1; b < bands; ++b) {
+        tasks.push_back(std::async(std::launch::async, decode_band, b));
     }
 
-    if (header_.color_map_spec.first_entry_index != 0 ||
-        header_.color_map_spec.entry_size        != 0 ||
-        header_.color_map_spec.length            != 0
+    decode_band(0);
+
+    for (auto& task : tasks) {
+        task.get();
+    }
+}
+
+void tga::image::decode_region(
+    rect_t const&           region,
+    void* const             out,
+    ptrdiff_t const         out_stride,
+    gfx::pixel_format const out_format
+) const {
+    auto const w = width();
+    auto const h = height();
+
+    if (region.is_degenerate() || region.left < 0 || region.top < 0 ||
+        static_cast<unsigned>(region.right)  > w ||
+        static_cast<unsigned>(region.bottom) > h
     ) {
         BOOST_THROW_EXCEPTION(targa_exception()
-            << bklib::error_message("color mapped images not supported.")
+            << bklib::error_message("region out of bounds.")
         );
     }
 
-    // skip past the id
-    in.seekg(header_.id_length, std::ios::cur);
+    std::vector<uint32_t> palette;
+    row_converter const convert(*this, out_format, palette);
 
-    auto const w = header_.image_spec.width;
-    auto const h = header_.image_spec.height;
+    auto const left  = static_cast<unsigned>(region.left);
+    auto const top   = static_cast<unsigned>(region.top);
+    auto const count = static_cast<unsigned>(region.width());
+    auto const rows  = static_cast<unsigned>(region.height());
+    auto const dst   = static_cast<byte*>(out);
 
-    auto const ww = endian(w, endian_type::little);
-    std::cout << ww;
+    if (!count || !rows) {
+        return;
+    }
 
-    data_size_ = w * h * (depth / 8);
-    auto const scanline_size = w * (depth / 8);
+    if (!is_rle()) {
+        for (unsigned y = 0; y < rows; ++y) {
+            convert(row(top + y) + left * bytes_per_pixel(), dst + static_cast<ptrdiff_t>(y) * out_stride, count);
+        }
+
+        return;
+    }
 
-    data_.reset(new char[data_size_]);
-    in.read(data_.get(), data_size_);
+    // walk the file rows covered in file order, starting from the nearest
+    // indexed row above them.
+    auto const first = is_top_down() ? top : h - (top + rows);
+    auto const last  = first + rows;
 
-    // flip the image vertically
-    std::unique_ptr<char[]> temp(new char[scanline_size]);
-    for (size_t i = 0; i < h / 2; ++i) {
-        auto const a = data_.get() + i*scanline_size;
-        auto const b = data_.get() + data_size_ - (i+1)*scanline_size;
+    auto decoder = seek_row_(first);
 
-        std::memcpy(temp.get(), a, scanline_size);
-        std::memcpy(a, b, scanline_size);
-        std::memcpy(b, temp.get(), scanline_size);
+    std::vector<byte> scratch(convert.is_copy ? 0 : count * bytes_per_pixel());
+
+    for (auto i = first; i < last; ++i) {
+        auto const y   = is_top_down() ? i - top : h - 1 - i - top;
+        auto const row = dst + static_cast<ptrdiff_t>(y) * out_stride;
+
+        decoder.skip(left);
+
+        if (convert.is_copy) {
+            decoder.decode(row, count);
+        } else {
+            decoder.decode(scratch.data(), count);
+            convert(scratch.data(), row, count);
+        }
+
+        decoder.skip(w - left - count);
+    }
+}
+
+tga::rle_decoder tga::image::seek_row_(unsigned const y) const {
+    std::call_once(row_index_once_, [&] {
+        auto const w = width();
+        auto const h = height();
+
+        // left empty if the data turns out to be truncated, so the next call
+        // tries again and throws again.
+        std::vector<rle_decoder> index;
+        index.reserve((h + ROW_INDEX_STEP - 1) / ROW_INDEX_STEP);
+
+        rle_decoder decoder(rle_first_, rle_last_, bytes_per_pixel());
+        for (unsigned row = 0; row < h; row += ROW_INDEX_STEP) {
+            if (row) {
+                decoder.skip(static_cast<size_t>(ROW_INDEX_STEP) * w);
+            }
+
+            index.push_back(decoder);
+        }
+
+        row_index_.swap(index);
+    });
+
+    auto decoder = row_index_[y / ROW_INDEX_STEP];
+    decoder.skip(static_cast<size_t>(y % ROW_INDEX_STEP) * width());
+
+    return decoder;
+}
+
+namespace {
+
+//------------------------------------------------------------------------------
+//! Fill @c count pixels at @c out with copies of the pixel at @c pixel.
+//------------------------------------------------------------------------------
+void fill_run(
+    tga::byte*       out,
+    tga::byte const* pixel,
+    size_t           count,
+    unsigned         bytes_per_pixel
+) {
+    switch (bytes_per_pixel) {
+    case 1 :
+        std::memset(out, *pixel, count);
+        break;
+    case 2 : {
+        uint16_t value;
+        std::memcpy(&value, pixel, sizeof(value));
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(out + i*sizeof(value), &value, sizeof(value));
+        }
+    } break;
+    case 4 : {
+        uint32_t value;
+        std::memcpy(&value, pixel, sizeof(value));
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(out + i*sizeof(value), &value, sizeof(value));
+        }
+    } break;
+    default : {
+        // no native 3 byte store; double the filled prefix until done.
+        auto const total = count * bytes_per_pixel;
+        auto       done  = static_cast<size_t>(bytes_per_pixel);
+
+        std::memcpy(out, pixel, bytes_per_pixel);
+        while (done < total) {
+            auto const n = (std::min)(done, total - done);
+            std::memcpy(out + done, out, n);
+            done += n;
+        }
+    } break;
     }
 }
 
+} //namespace
+
+tga::rle_decoder::rle_decoder(
+    byte const* first, byte const* last, unsigned bytes_per_pixel
+)
+    : first_(first)
+    , last_(last)
+    , bytes_per_pixel_(bytes_per_pixel)
+    , remaining_(0)
+    , is_run_(false)
+{
+    BK_ASSERT_MSG(bytes_per_pixel >= 1 && bytes_per_pixel <= 4, "bad pixel size");
+}
+
+void tga::rle_decoder::advance_(byte* out, size_t count) {
+    auto const bpp = bytes_per_pixel_;
+
+    while (count) {
+        if (remaining_ == 0) {
+            if (first_ == last_) {
+                BOOST_THROW_EXCEPTION(targa_exception()
+                    << bklib::error_message("truncated image data.")
+                );
+            }
+
+            // the high bit marks a run; the low 7 bits are the pixel count - 1.
+            auto const packet = *first_++;
+            remaining_ = (packet & 0x7F) + 1;
+            is_run_    = (packet & 0x80) != 0;
+
+            auto const input = is_run_ ? bpp : remaining_ * bpp;
+            if (static_cast<size_t>(last_ - first_) < input) {
+                BOOST_THROW_EXCEPTION(targa_exception()
+                    << bklib::error_message("truncated image data.")
+                );
+            }
+        }
+
+        auto const n     = (std::min)(remaining_, count);
+        auto const bytes = n * bpp;
+
+        if (is_run_) {
+            if (out) fill_run(out, first_, n, bpp);
+        } else {
+            if (out) std::memcpy(out, first_, bytes);
+            first_ += bytes;
+        }
+
+        remaining_ -= n;
+        count      -= n;
+
+        if (out) {
+            out += bytes;
+        }
+
+        // the repeated pixel is consumed at the end of the run.
+        if (is_run_ && remaining_ == 0) {
+            first_ += bpp;
+        }
+    }
+}
+
+tga::byte const* tga::decode_rle(
+    byte const* first, byte const* last,
+    byte* out, size_t out_size,
+    unsigned bytes_per_pixel
+) {
+    BK_ASSERT_MSG(out_size % bytes_per_pixel == 0, "wrong size");
+
+    rle_decoder decoder(first, last, bytes_per_pixel);
+    decoder.decode(out, out_size / bytes_per_pixel);
+
+    // a packet that doesn't end with the image
+    if (decoder.in_packet()) {
+        BOOST_THROW_EXCEPTION(targa_exception()
+            << bklib::error_message("corrupt rle data.")
+        );
+    }
+
+    return decoder.position();
+}
+
 bool tga::footer::is_valid() const {
     static char const FOOTER_SIGNATURE[] = "TRUEVISION-XFILE";
 
     if (std::strncmp(
         FOOTER_SIGNATURE,
         signature,
-        BK_ARRAY_ELEMENT_COUNT(signature)) == 0
+        BK_ARRAY_ELEMENT_COUNT(signature)) != 0
     ) {
         return false;
     } else if (dot_terminator  != '.') {
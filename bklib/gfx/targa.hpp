@@ -1,9 +1,15 @@
+#pragma once
+
 #include "pch.hpp"
 
 #include <type_traits>
 #include <memory>
+#include <mutex>
 
 #include "exception.hpp"
+#include "util/mapped_file.hpp"
+#include "common/math.hpp"
+#include "gfx/pixel_convert.hpp"
 
 namespace bklib {
 //==============================================================================
@@ -53,6 +59,7 @@ namespace tga {
 struct targa_exception : virtual exception_base { };
 
 typedef uint8_t byte;
+typedef math::rect<int32_t> rect_t;
 
 //==============================================================================
 //! Color map type.
@@ -128,19 +135,101 @@ struct footer {
 #pragma pack(pop, tga) //Enforce tight packing
 //******************************************************************************
 
+//==============================================================================
+//! Streaming decoder for run length encoded pixel data. Packets may span
+//! calls to decode(), so an image can be decoded a row at a time.
+//==============================================================================
+class rle_decoder {
+public:
+    //--------------------------------------------------------------------------
+    //! @param first, last
+    //!     The packets; may extend past the end of the image data.
+    //! @param bytes_per_pixel
+    //!     1 to 4.
+    //--------------------------------------------------------------------------
+    rle_decoder(byte const* first, byte const* last, unsigned bytes_per_pixel);
+
+    //--------------------------------------------------------------------------
+    //! Decode the next @c count pixels to @c out.
+    //! @throw targa_exception if the data is truncated.
+    //--------------------------------------------------------------------------
+    void decode(byte* out, size_t count) {
+        advance_(out, count);
+    }
+
+    //--------------------------------------------------------------------------
+    //! Move past the next @c count pixels without writing them; only the
+    //! packet headers are read. A copy of the decoder taken afterwards can
+    //! carry on from that point independently.
+    //! @throw targa_exception if the data is truncated.
+    //--------------------------------------------------------------------------
+    void skip(size_t count) {
+        advance_(nullptr, count);
+    }
+
+    //! One past the last byte of input consumed.
+    byte const* position() const {
+        return first_;
+    }
+
+    //! @c true if the last decode() ended part way through a packet.
+    bool in_packet() const {
+        return remaining_ != 0;
+    }
+private:
+    void advance_(byte* out, size_t count);
+
+    byte const* first_;
+    byte const* last_;
+    unsigned    bytes_per_pixel_;
+    size_t      remaining_; //!< pixels left in the current packet.
+    bool        is_run_;    //!< the current packet repeats the pixel at first_.
+};
+
+//==============================================================================
+//! Decode run length encoded pixel data.
+//! @param first, last
+//!     The packets; may extend past the end of the image data.
+//! @param out
+//!     Receives @c out_size bytes of pixels in file order.
+//! @param bytes_per_pixel
+//!     1 to 4.
+//! @return one past the last byte of input consumed.
+//! @throw targa_exception if the data is truncated or a packet would overrun
+//!        the output.
+//==============================================================================
+byte const* decode_rle(
+    byte const* first, byte const* last,
+    byte* out, size_t out_size,
+    unsigned bytes_per_pixel
+);
+
 //==============================================================================
 //! Targa image file.
+//! Uncompressed pixel data is not copied or rearranged; row() and stride()
+//! present it top down whichever way the file stores it. Run length encoded
+//! data is decoded into a private buffer, in file order, the first time the
+//! pixels are accessed; decode() never needs that buffer.
 //==============================================================================
 class image {
 public:
-    explicit image(utf8string filename);
+    //--------------------------------------------------------------------------
+    //! How the file contents are brought into memory.
+    //--------------------------------------------------------------------------
+    enum class load_mode {
+        map,  //!< map the file; pixels are read straight from the file cache.
+        copy, //!< read the whole file into a private buffer.
+    };
 
+    explicit image(utf8string filename, load_mode mode = load_mode::map);
+
+    //! The pixel data in file order.
     void const* cbegin() const {
-        return data_.get();
+        return pixels_();
     }
 
     void const* cend() const {
-        return data_.get() + data_size_;
+        return pixels_() + data_size_;
     }
 
     size_t size() const {
@@ -154,13 +243,306 @@ public:
     unsigned height() const {
         return header_.image_spec.height;
     }
+
+    unsigned bytes_per_pixel() const {
+        return (header_.image_spec.depth + 7) / 8;
+    }
+
+    //! The layout of the pixels as stored.
+    gfx::pixel_format format() const;
+
+    //! @c true if the file stores the top row first.
+    bool is_top_down() const {
+        return header_.image_spec.descriptor.top != 0;
+    }
+
+    //! @c true if the pixels are indices into palette().
+    bool is_color_mapped() const {
+        return !palette_.empty();
+    }
+
+    //--------------------------------------------------------------------------
+    //! The color map of a color mapped image as 256 bgra8 entries, indexed by
+    //! pixel value; entries the file doesn't define are zero. Empty for other
+    //! images. Keeping the indices (decode() to index8) and expanding them
+    //! with gfx::expand_palette when uploading saves three quarters of the
+    //! memory of decoding to bgra8.
+    //--------------------------------------------------------------------------
+    std::vector<uint32_t> const& palette() const {
+        return palette_;
+    }
+
+    //! @c true if the file is run length encoded.
+    bool is_rle() const {
+        return rle_first_ != nullptr;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Pointer to the first pixel of row @c y, counting from the top.
+    //--------------------------------------------------------------------------
+    byte const* row(unsigned y) const {
+        BK_ASSERT_MSG(y < height(), "out of range");
+        return pixels_() + first_row_ + static_cast<ptrdiff_t>(y) * stride_;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Offset in bytes from one row to the row below it; negative if the file
+    //! stores the rows bottom up.
+    //--------------------------------------------------------------------------
+    ptrdiff_t stride() const {
+        return stride_;
+    }
+
+    //--------------------------------------------------------------------------
+    //! Decode, flip and convert the image in a single pass. Large images are
+    //! split into bands of rows decoded in parallel.
+    //! @param out
+    //!     Receives height() rows of width() pixels, top row first.
+    //! @param out_stride
+    //!     Offset in bytes from one row of @c out to the next.
+    //! @param out_format
+    //!     Format to convert to; throws targa_exception if there is no
+    //!     conversion from format(). Color mapped images decode to index8,
+    //!     or are expanded through palette() to bgra8 or rgba8.
+    //--------------------------------------------------------------------------
+    void decode(void* out, ptrdiff_t out_stride, gfx::pixel_format out_format) const;
+
+    //--------------------------------------------------------------------------
+    //! Decode and convert just @c region of the image, so that images larger
+    //! than memory can be worked on a piece at a time. Only the rows covered
+    //! are touched: uncompressed rows are read in place, and run length
+    //! encoded images start from the nearest entry of a sparse row index
+    //! built on first use. Nothing is kept from call to call besides that
+    //! index.
+    //! @param region
+    //!     Must lie within the image; throws targa_exception otherwise.
+    //! @param out
+    //!     Receives region.height() rows of region.width() pixels, top row
+    //!     first.
+    //! @param out_stride, out_format
+    //!     As for decode().
+    //--------------------------------------------------------------------------
+    void decode_region(
+        rect_t const&     region,
+        void*             out,
+        ptrdiff_t         out_stride,
+        gfx::pixel_format out_format
+    ) const;
 private:
-    void load_ver_2(std::ifstream& in);
-    void load_ver_1(std::ifstream& in);
+    image(image const&); //=delete
+    image& operator=(image const&); //=delete
+
+    void load_(byte const* first, byte const* last);
+    void load_ver_2(byte const* first, byte const* last);
+    void load_ver_1(byte const* first, byte const* last);
+    void load_palette_(byte const* map);
+
+    //! The pixels in file order; decodes run length encoded images on first use.
+    byte const* pixels_() const;
+
+    //! A decoder positioned at the start of file row @c y; uses row_index_,
+    //! building it on first use.
+    rle_decoder seek_row_(unsigned y) const;
+
+    static unsigned const ROW_INDEX_STEP = 16;
+
+    header                       header_;
+    std::unique_ptr<mapped_file> file_;      //!< load_mode::map
+    std::vector<byte>            buffer_;    //!< load_mode::copy
+    byte const*                  pixels_data_;
+    size_t                       data_size_;
+    ptrdiff_t                    first_row_; //!< offset of the top row.
+    ptrdiff_t                    stride_;
+    std::vector<uint32_t>        palette_;   //!< bgra8; empty if not mapped.
+
+    byte const*                  rle_first_; //!< packets; null if not encoded.
+    byte const*                  rle_last_;
+    mutable std::once_flag       decoded_once_;
+    mutable std::vector<byte>    decoded_;
+    mutable std::once_flag       row_index_once_;
+    mutable std::vector<rle_decoder> row_index_; //!< every ROW_INDEX_STEP-th row.
+};
+
+//==============================================================================
+//! Splits an image into fixed size tiles that are decoded on demand with
+//! image::decode_region(); the tiles along the right and bottom edges may be
+//! smaller. The image must outlive the grid.
+//==============================================================================
+class tile_grid {
+public:
+    struct tile {
+        tile(unsigned column, unsigned row, rect_t const& bounds)
+            : column(column), row(row), bounds(bounds)
+        {
+        }
+
+        unsigned column;
+        unsigned row;
+        rect_t   bounds; //!< in image pixels.
+    };
+
+    //--------------------------------------------------------------------------
+    //! Visits the tiles of a block of the grid a row at a time.
+    //--------------------------------------------------------------------------
+    class iterator : public std::iterator<
+        std::forward_iterator_tag, tile, ptrdiff_t, tile const*, tile
+    > {
+    public:
+        iterator(
+            tile_grid const* grid,
+            unsigned first_column, unsigned last_column,
+            unsigned column, unsigned row
+        )
+            : grid_(grid)
+            , first_column_(first_column)
+            , last_column_(last_column)
+            , column_(column)
+            , row_(row)
+        {
+        }
+
+        tile operator*() const {
+            return grid_->at(column_, row_);
+        }
+
+        iterator& operator++() {
+            if (++column_ == last_column_) {
+                column_ = first_column_;
+                ++row_;
+            }
+
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto const result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(iterator const& rhs) const {
+            return column_ == rhs.column_ && row_ == rhs.row_;
+        }
+
+        bool operator!=(iterator const& rhs) const {
+            return !(*this == rhs);
+        }
+    private:
+        tile_grid const* grid_;
+        unsigned         first_column_;
+        unsigned         last_column_;
+        unsigned         column_;
+        unsigned         row_;
+    };
+
+    //! A block of tiles; usable with range based for.
+    struct range {
+        iterator begin() const { return first; }
+        iterator end()   const { return last; }
+
+        iterator first;
+        iterator last;
+    };
+
+    tile_grid(image const& source, unsigned tile_width, unsigned tile_height)
+        : image_(source)
+        , tile_width_(tile_width)
+        , tile_height_(tile_height)
+        , columns_((source.width()  + tile_width  - 1) / tile_width)
+        , rows_((source.height() + tile_height - 1) / tile_height)
+    {
+        BK_ASSERT_MSG(tile_width > 0 && tile_height > 0, "empty tile");
+    }
+
+    unsigned columns() const { return columns_; }
+    unsigned rows()    const { return rows_; }
+
+    unsigned tile_width()  const { return tile_width_; }
+    unsigned tile_height() const { return tile_height_; }
+
+    tile at(unsigned column, unsigned row) const {
+        BK_ASSERT_MSG(column < columns_ && row < rows_, "out of range");
+
+        auto const left = static_cast<int32_t>(column * tile_width_);
+        auto const top  = static_cast<int32_t>(row * tile_height_);
+        auto const right  = (std::min)(left + static_cast<int32_t>(tile_width_),
+                                       static_cast<int32_t>(image_.width()));
+        auto const bottom = (std::min)(top + static_cast<int32_t>(tile_height_),
+                                       static_cast<int32_t>(image_.height()));
+
+        return tile(column, row, rect_t(left, top, right, bottom));
+    }
+
+    iterator begin() const {
+        return block_(0, columns_, 0, rows_).first;
+    }
+
+    iterator end() const {
+        return block_(0, columns_, 0, rows_).last;
+    }
+
+    //--------------------------------------------------------------------------
+    //! The tiles overlapping @c region, which is clipped to the image; e.g.
+    //! the tiles a view needs.
+    //--------------------------------------------------------------------------
+    range tiles_in(rect_t const& region) const {
+        auto const clamp = [](int32_t v, int32_t hi) {
+            return static_cast<unsigned>((std::max)(0, (std::min)(v, hi)));
+        };
+
+        auto const w = static_cast<int32_t>(image_.width());
+        auto const h = static_cast<int32_t>(image_.height());
+
+        auto const left   = clamp(region.left,   w);
+        auto const top    = clamp(region.top,    h);
+        auto const right  = clamp(region.right,  w);
+        auto const bottom = clamp(region.bottom, h);
+
+        if (left >= right || top >= bottom) {
+            return block_(0, 0, 0, 0);
+        }
+
+        return block_(
+            left / tile_width_,  (right  + tile_width_  - 1) / tile_width_,
+            top  / tile_height_, (bottom + tile_height_ - 1) / tile_height_
+        );
+    }
+
+    //--------------------------------------------------------------------------
+    //! Decode @c t to @c out; see image::decode_region.
+    //--------------------------------------------------------------------------
+    void decode(
+        tile const&       t,
+        void*             out,
+        ptrdiff_t         out_stride,
+        gfx::pixel_format out_format
+    ) const {
+        image_.decode_region(t.bounds, out, out_stride, out_format);
+    }
+private:
+    tile_grid& operator=(tile_grid const&); //=delete
+
+    //! The tiles in columns [c0, c1) of rows [r0, r1).
+    range block_(unsigned c0, unsigned c1, unsigned r0, unsigned r1) const {
+        // an empty block starts where it ends.
+        if (c0 >= c1 || r0 >= r1) {
+            c1 = c0 + 1;
+            r0 = r1;
+        }
+
+        range const result = {
+            iterator(this, c0, c1, c0, r0),
+            iterator(this, c0, c1, c0, r1),
+        };
+
+        return result;
+    }
 
-    header                  header_;
-    std::unique_ptr<char[]> data_;
-    size_t                  data_size_;
+    image const& image_;
+    unsigned     tile_width_;
+    unsigned     tile_height_;
+    unsigned     columns_;
+    unsigned     rows_;
 };
 
 } // namespace tga
@@ -0,0 +1,349 @@
+#include "pch.hpp"
+#include "gfx/targa_writer.hpp"
+
+#if defined(BK_CONFIG_COMPILER_MSVC)
+#   include <intrin.h>
+#endif
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+#   include <emmintrin.h>
+#endif
+
+namespace tga = ::bklib::tga;
+namespace gfx = ::bklib::gfx;
+
+namespace {
+
+typedef tga::byte byte;
+
+inline unsigned lowest_bit(uint32_t const x) {
+#if defined(BK_CONFIG_COMPILER_MSVC)
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return i;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+//------------------------------------------------------------------------------
+//! Set bit i of @c bits if pixel i equals pixel i + 1; bits are 32 to a word,
+//! and must be zero on entry.
+//------------------------------------------------------------------------------
+void equal_neighbours(byte const* p, size_t n, unsigned bpp, uint32_t* bits) {
+    size_t i = 0;
+
+#if defined(BK_CONFIG_SIMD_SSE2)
+#   define BK_LOAD_128(p) _mm_loadu_si128(reinterpret_cast<__m128i const*>(p))
+    // each step compares k pixels with the k after them: k + 1 must exist.
+    switch (bpp) {
+    case 1 :
+        for (; i + 17 <= n; i += 16) {
+            auto const eq = _mm_cmpeq_epi8(BK_LOAD_128(p + i), BK_LOAD_128(p + i + 1));
+            bits[i / 32] |= static_cast<uint32_t>(_mm_movemask_epi8(eq)) << (i % 32);
+        }
+        break;
+    case 2 :
+        for (; i + 9 <= n; i += 8) {
+            auto const eq = _mm_cmpeq_epi16(BK_LOAD_128(p + i*2), BK_LOAD_128(p + i*2 + 2));
+            auto const m  = _mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128()));
+            bits[i / 32] |= static_cast<uint32_t>(m & 0xFF) << (i % 32);
+        }
+        break;
+    case 4 :
+        for (; i + 5 <= n; i += 4) {
+            auto const eq = _mm_cmpeq_epi32(BK_LOAD_128(p + i*4), BK_LOAD_128(p + i*4 + 4));
+            auto const m  = _mm_movemask_ps(_mm_castsi128_ps(eq));
+            bits[i / 32] |= static_cast<uint32_t>(m) << (i % 32);
+        }
+        break;
+    }
+#   undef BK_LOAD_128
+#endif
+
+    for (; i + 1 < n; ++i) {
+        if (std::memcmp(p + i*bpp, p + (i + 1)*bpp, bpp) == 0) {
+            bits[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//! The first bit at or after @c from equal to @c value; @c n if there is none.
+//------------------------------------------------------------------------------
+size_t find_bit(uint32_t const* bits, size_t from, size_t n, bool value) {
+    auto w    = from / 32;
+    auto word = (value ? bits[w] : ~bits[w]) & (~0u << (from % 32));
+
+    for (;;) {
+        if (word) {
+            return (std::min)(w*32 + lowest_bit(word), n);
+        } else if (++w * 32 >= n) {
+            return n;
+        }
+
+        word = value ? bits[w] : ~bits[w];
+    }
+}
+
+//------------------------------------------------------------------------------
+//! Header fields for pixels stored as @c format.
+//------------------------------------------------------------------------------
+void describe(gfx::pixel_format format, tga::image_type& type, byte& depth, byte& alpha) {
+    switch (format) {
+    case gfx::pixel_format::gray8  : type = tga::image_type::black_white; depth = 8;  alpha = 0; return;
+    case gfx::pixel_format::bgr5a1 : type = tga::image_type::true_color;  depth = 16; alpha = 1; return;
+    case gfx::pixel_format::bgr8   : type = tga::image_type::true_color;  depth = 24; alpha = 0; return;
+    case gfx::pixel_format::bgra8  :
+    case gfx::pixel_format::rgba8  : type = tga::image_type::true_color;  depth = 32; alpha = 8; return;
+    case gfx::pixel_format::index8 : break;
+    }
+
+    BOOST_THROW_EXCEPTION(tga::targa_exception()
+        << bklib::error_message("unsupported format.")
+    );
+}
+
+} //namespace
+
+tga::byte* tga::encode_rle(
+    byte const* const pixels,
+    size_t      const count,
+    unsigned    const bpp,
+    byte*             out
+) {
+    BK_ASSERT_MSG(bpp >= 1 && bpp <= 4, "bad pixel size");
+
+    if (count == 0) {
+        return out;
+    }
+
+    std::vector<uint32_t> bits((count + 31) / 32, 0);
+    equal_neighbours(pixels, count, bpp, bits.data());
+
+    size_t const MAX_PACKET = 128;
+
+    for (size_t i = 0; i < count; ) {
+        if (i + 1 < count && (bits[i / 32] >> (i % 32) & 1)) {
+            // a run ends at the first pixel unlike the next; the last pixel
+            // has no next, so there always is one.
+            auto const last = find_bit(bits.data(), i, count, false);
+
+            for (auto left = last + 1 - i; left; ) {
+                auto const n = (std::min)(left, MAX_PACKET);
+                *out++ = static_cast<byte>(0x80 | (n - 1));
+                std::memcpy(out, pixels + i*bpp, bpp);
+                out  += bpp;
+                i    += n;
+                left -= n;
+            }
+        } else {
+            // literals stop where the next run starts.
+            auto const end = find_bit(bits.data(), i, count, true);
+
+            while (i < end) {
+                auto const n = (std::min)(end - i, MAX_PACKET);
+                *out++ = static_cast<byte>(n - 1);
+                std::memcpy(out, pixels + i*bpp, n*bpp);
+                out += n*bpp;
+                i   += n;
+            }
+        }
+    }
+
+    return out;
+}
+
+void tga::write(
+    utf8string        const& filename,
+    void const*       const  pixels,
+    unsigned          const  width,
+    unsigned          const  height,
+    ptrdiff_t         const  stride,
+    gfx::pixel_format const  format,
+    bool              const  rle,
+    bool              const  top_down
+) {
+    if (width > 0xFFFF || height > 0xFFFF) {
+        BOOST_THROW_EXCEPTION(targa_exception()
+            << bklib::error_message("image too large.")
+            << boost::errinfo_file_name(filename)
+        );
+    }
+
+    header h;
+    std::memset(&h, 0, sizeof(h));
+
+    byte depth, alpha;
+    describe(format, h.image_type, depth, alpha);
+
+    if (rle) {
+        h.image_type = static_cast<image_type>(static_cast<byte>(h.image_type) + 8);
+    }
+
+    h.color_map_type              = color_map_type::absent;
+    h.image_spec.width            = endian(static_cast<uint16_t>(width),  endian_type::little);
+    h.image_spec.height           = endian(static_cast<uint16_t>(height), endian_type::little);
+    h.image_spec.depth            = depth;
+    h.image_spec.descriptor.alpha = alpha;
+    h.image_spec.descriptor.top   = top_down ? 1 : 0;
+
+    auto const bpp      = static_cast<unsigned>(depth / 8);
+    auto const row_size = static_cast<size_t>(width) * bpp;
+    auto const in       = static_cast<byte const*>(pixels);
+
+    // the whole file is put together in memory and written at once.
+    std::vector<byte> file(sizeof(h)
+        + height * (rle ? max_rle_size(width, bpp) : row_size)
+        + sizeof(footer)
+    );
+
+    std::memcpy(file.data(), &h, sizeof(h));
+    auto out = file.data() + sizeof(h);
+
+    std::vector<byte> scratch(format == gfx::pixel_format::rgba8 ? row_size : 0);
+
+    for (unsigned y = 0; y < height; ++y) {
+        auto const from = top_down ? y : height - 1 - y;
+        auto row = in + static_cast<ptrdiff_t>(from) * stride;
+
+        if (!scratch.empty()) {
+            gfx::convert<gfx::rgba8, gfx::bgra8>(row, row + row_size, scratch.data(), scratch.data() + row_size);
+            row = scratch.data();
+        }
+
+        if (rle) {
+            out = encode_rle(row, width, bpp, out);
+        } else {
+            std::memcpy(out, row, row_size);
+            out += row_size;
+        }
+    }
+
+    footer f;
+    std::memset(&f, 0, sizeof(f));
+    std::memcpy(f.signature, "TRUEVISION-XFILE", sizeof(f.signature));
+    f.dot_terminator = '.';
+
+    std::memcpy(out, &f, sizeof(f));
+    out += sizeof(f);
+
+    std::ofstream file_out(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+    file_out.write(reinterpret_cast<char const*>(file.data()), out - file.data());
+    file_out.close();
+
+    if (file_out.fail()) {
+        BOOST_THROW_EXCEPTION(targa_exception()
+            << bklib::error_message("write failed.")
+            << boost::errinfo_file_name(filename)
+        );
+    }
+}
+
+//==============================================================================
+// frame_writer
+//==============================================================================
+struct tga::frame_writer::frame {
+    utf8string        filename;
+    std::vector<byte> pixels;
+    unsigned          width;
+    unsigned          height;
+    gfx::pixel_format format;
+};
+
+tga::frame_writer::frame_writer(bool const rle)
+    : rle_(rle)
+    , pending_(0)
+{
+    thread_ = std::thread([this] { work_(); });
+}
+
+tga::frame_writer::~frame_writer() {
+    // an empty frame stops the thread once the queue ahead of it is done.
+    frames_.emplace(std::unique_ptr<frame>());
+    thread_.join();
+}
+
+std::vector<tga::byte> tga::frame_writer::acquire(size_t const size) {
+    std::vector<byte> result;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            result = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+
+    result.resize(size);
+    return result;
+}
+
+void tga::frame_writer::write(
+    utf8string              filename,
+    std::vector<byte>&&     pixels,
+    unsigned          const width,
+    unsigned          const height,
+    gfx::pixel_format const format
+) {
+    BK_ASSERT_MSG(pixels.size() >= static_cast<size_t>(width) * height * gfx::bytes_per_pixel(format), "buffer too small");
+
+    auto f = std::make_unique<frame>();
+    f->filename = std::move(filename);
+    f->pixels   = std::move(pixels);
+    f->width    = width;
+    f->height   = height;
+    f->format   = format;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++pending_;
+    }
+
+    frames_.emplace(std::move(f));
+}
+
+void tga::frame_writer::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (pending_ != 0) {
+        done_.wait(lock);
+    }
+
+    if (error_) {
+        auto const error = error_;
+        error_ = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+void tga::frame_writer::work_() {
+    for (;;) {
+        auto f = frames_.pop();
+        if (!f) {
+            return;
+        }
+
+        std::exception_ptr error;
+
+        try {
+            auto const stride = static_cast<ptrdiff_t>(f->width * gfx::bytes_per_pixel(f->format));
+            tga::write(f->filename, f->pixels.data(), f->width, f->height, stride, f->format, rle_);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (error && !error_) {
+            error_ = error;
+        }
+
+        if (free_.size() < MAX_FREE) {
+            free_.push_back(std::move(f->pixels));
+        }
+
+        --pending_;
+        done_.notify_all();
+    }
+}
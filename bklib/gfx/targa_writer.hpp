@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Targa image writing, e.g. for frame capture.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "gfx/targa.hpp"
+#include "util/blocking_queue.hpp"
+
+namespace bklib { namespace tga {
+
+//------------------------------------------------------------------------------
+//! Largest output of encode_rle for @c count pixels.
+//------------------------------------------------------------------------------
+inline size_t max_rle_size(size_t count, unsigned bytes_per_pixel) {
+    // every packet holds at least one pixel and costs one byte more.
+    return count * (bytes_per_pixel + 1);
+}
+
+//------------------------------------------------------------------------------
+//! Run length encode @c count pixels. Packets end with the pixels, so an
+//! image encoded a row at a time has no packets spanning rows. Neighbouring
+//! pixels are compared 4 to 16 at a time with SSE2.
+//! @param bytes_per_pixel
+//!     1 to 4.
+//! @param out
+//!     Receives up to max_rle_size(count, bytes_per_pixel) bytes.
+//! @return one past the last byte written.
+//------------------------------------------------------------------------------
+byte* encode_rle(byte const* pixels, size_t count, unsigned bytes_per_pixel, byte* out);
+
+//------------------------------------------------------------------------------
+//! Write a Targa file, in one write.
+//! @param pixels
+//!     The image, top row first.
+//! @param stride
+//!     Offset in bytes from one row of @c pixels to the next.
+//! @param format
+//!     Any but index8; rgba8 is stored as bgra8.
+//! @param rle
+//!     Run length encode the pixels.
+//! @param top_down
+//!     Store the top row first; otherwise the rows are stored bottom up, as
+//!     most older readers expect.
+//! @throw targa_exception for index8, and if the file can't be written.
+//------------------------------------------------------------------------------
+void write(
+    utf8string const& filename,
+    void const* pixels, unsigned width, unsigned height, ptrdiff_t stride,
+    gfx::pixel_format format,
+    bool rle = false,
+    bool top_down = true
+);
+
+//==============================================================================
+//! Writes images on a thread of its own, so that capturing frames costs the
+//! caller no more than filling a buffer. Buffers are handed over with each
+//! frame and recycled through acquire() once written, so a steady stream of
+//! frames doesn't allocate either.
+//==============================================================================
+class frame_writer {
+public:
+    //! @param rle run length encode every frame.
+    explicit frame_writer(bool rle = true);
+
+    //! Writes the frames still queued; failures are ignored.
+    ~frame_writer();
+
+    //--------------------------------------------------------------------------
+    //! A buffer of @c size bytes; one already written if there is one.
+    //--------------------------------------------------------------------------
+    std::vector<byte> acquire(size_t size);
+
+    //--------------------------------------------------------------------------
+    //! Queue a frame to be written to @c filename and return at once.
+    //! @param pixels
+    //!     The frame, top row first, rows packed; the writer takes it over.
+    //--------------------------------------------------------------------------
+    void write(
+        utf8string filename,
+        std::vector<byte>&& pixels, unsigned width, unsigned height,
+        gfx::pixel_format format
+    );
+
+    //--------------------------------------------------------------------------
+    //! Block until every frame queued so far is written.
+    //! @throw the first failure since the last call, if any.
+    //--------------------------------------------------------------------------
+    void wait();
+private:
+    frame_writer(frame_writer const&); //=delete
+    frame_writer& operator=(frame_writer const&); //=delete
+
+    struct frame;
+
+    void work_();
+
+    //! Buffers kept for acquire(); any more are freed.
+    static size_t const MAX_FREE = 4;
+
+    bool                                   rle_;
+    std::mutex                             mutex_;
+    std::condition_variable                done_;
+    size_t                                 pending_;
+    std::vector<std::vector<byte>>         free_;
+    std::exception_ptr                     error_;
+    blocking_queue<std::unique_ptr<frame>> frames_;
+    std::thread                            thread_;
+};
+
+} //namespace tga
+} //namespace bklib
@@ -0,0 +1,192 @@
+#include "pch.hpp"
+#include "gfx/texture_atlas.hpp"
+
+#include "gfx/targa.hpp"
+
+namespace gfx = ::bklib::gfx;
+
+gfx::texture_atlas::texture_atlas(
+    unsigned const page_width,
+    unsigned const page_height,
+    unsigned const padding
+)
+    : page_width_(page_width)
+    , page_height_(page_height)
+    , padding_(padding)
+    , generation_(0)
+    , removed_area_(0)
+{
+    BK_ASSERT_MSG(page_width > padding && page_height > padding, "pages too small");
+}
+
+gfx::texture_atlas::id_t
+gfx::texture_atlas::insert(tga::image const& image) {
+    auto const id = allocate_(image.width(), image.height());
+    auto const& where = entries_[id].where;
+
+    try {
+        image.decode(pixels_(where), page_width_ * 4, pixel_format::bgra8);
+    } catch (...) {
+        remove(id);
+        throw;
+    }
+
+    return id;
+}
+
+gfx::texture_atlas::id_t
+gfx::texture_atlas::insert(
+    unsigned const    width,
+    unsigned const    height,
+    void const* const pixels,
+    ptrdiff_t const   stride
+) {
+    auto const id = allocate_(width, height);
+
+    auto out = pixels_(entries_[id].where);
+    auto in  = static_cast<char const*>(pixels);
+
+    for (unsigned y = 0; y < height; ++y, in += stride, out += page_width_ * 4) {
+        std::memcpy(out, in, width * 4);
+    }
+
+    return id;
+}
+
+void gfx::texture_atlas::remove(id_t const id) {
+    BK_ASSERT_MSG(is_valid_(id), "invalid id");
+
+    auto& e = entries_[id];
+    e.alive = false;
+    free_.push_back(id);
+
+    removed_area_ += static_cast<int64_t>(e.where.rect.width()  + padding_)
+                                        * (e.where.rect.height() + padding_);
+}
+
+void gfx::texture_atlas::clean() {
+    for (auto& p : pages_) {
+        p.is_dirty = false;
+    }
+}
+
+gfx::texture_atlas::id_t
+gfx::texture_atlas::allocate_(unsigned const w, unsigned const h) {
+    if (w == 0 || h == 0 || w + padding_ > page_width_ || h + padding_ > page_height_) {
+        BOOST_THROW_EXCEPTION(atlas_exception()
+            << bklib::error_message("image doesn't fit on a page.")
+        );
+    }
+
+    location where;
+
+    if (!place_(w, h, where)) {
+        auto const page_area = static_cast<int64_t>(page_width_) * page_height_;
+
+        // repack rather than grow if a quarter of the pages is lost to holes.
+        if (removed_area_ * 4 > page_area * static_cast<int64_t>(pages_.size())) {
+            repack_();
+        }
+
+        if (!place_(w, h, where)) {
+            add_page_();
+            place_(w, h, where);
+        }
+    }
+
+    id_t id;
+    if (free_.empty()) {
+        id = static_cast<id_t>(entries_.size());
+        entries_.push_back(entry());
+    } else {
+        id = free_.back();
+        free_.pop_back();
+    }
+
+    entries_[id].where = where;
+    entries_[id].alive = true;
+    pages_[where.page].is_dirty = true;
+
+    return id;
+}
+
+bool gfx::texture_atlas::place_(unsigned const w, unsigned const h, location& out) {
+    auto const padded_w = static_cast<int32_t>(w + padding_);
+    auto const padded_h = static_cast<int32_t>(h + padding_);
+
+    for (size_t i = 0; i < packers_.size(); ++i) {
+        rect_t r(0, 0, 0, 0);
+
+        if (packers_[i].insert(padded_w, padded_h, r)) {
+            out.page = static_cast<unsigned>(i);
+            out.rect = rect_t(r.left, r.top, r.left + w, r.top + h);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void gfx::texture_atlas::add_page_() {
+    page p;
+    p.width    = page_width_;
+    p.height   = page_height_;
+    p.is_dirty = true;
+    p.pixels.resize(page_width_ * page_height_ * 4, 0);
+
+    pages_.push_back(std::move(p));
+    packers_.push_back(math::skyline_packer(page_width_, page_height_));
+}
+
+void gfx::texture_atlas::repack_() {
+    std::vector<id_t> order;
+    for (id_t id = 0; id < entries_.size(); ++id) {
+        if (entries_[id].alive) {
+            order.push_back(id);
+        }
+    }
+
+    // tallest first leaves the least space under the skyline.
+    std::sort(order.begin(), order.end(), [&](id_t a, id_t b) {
+        auto const& ra = entries_[a].where.rect;
+        auto const& rb = entries_[b].where.rect;
+
+        return ra.height() > rb.height() ||
+            (ra.height() == rb.height() && ra.width() > rb.width());
+    });
+
+    std::vector<page> old_pages;
+    old_pages.swap(pages_);
+    packers_.clear();
+
+    for (auto const id : order) {
+        auto& where = entries_[id].where;
+        auto const w = static_cast<unsigned>(where.rect.width());
+        auto const h = static_cast<unsigned>(where.rect.height());
+
+        location moved;
+        if (!place_(w, h, moved)) {
+            add_page_();
+            place_(w, h, moved);
+        }
+
+        auto const row_size = page_width_ * 4;
+        auto in  = old_pages[where.page].pixels.data()
+                 + where.rect.top * row_size + where.rect.left * 4;
+        auto out = pixels_(moved);
+
+        for (unsigned y = 0; y < h; ++y, in += row_size, out += row_size) {
+            std::memcpy(out, in, w * 4);
+        }
+
+        where = moved;
+    }
+
+    removed_area_ = 0;
+    ++generation_;
+}
+
+char* gfx::texture_atlas::pixels_(location const& where) {
+    auto& p = pages_[where.page];
+    return p.pixels.data() + (where.rect.top * p.width + where.rect.left) * 4;
+}
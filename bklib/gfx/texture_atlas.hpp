@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Packs many small images into a few large textures.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "exception.hpp"
+#include "common/math.hpp"
+#include "common/skyline_packer.hpp"
+
+namespace bklib {
+
+namespace tga { class image; }
+
+namespace gfx {
+
+struct atlas_exception : virtual exception_base { };
+
+//==============================================================================
+//! A set of bgra8 pages with images packed into them. Drawing many sprites
+//! from one page needs no texture switches.
+//!
+//! Images are packed with math::skyline_packer, a page at a time; a new
+//! page is started once none of the existing ones has room. Removing an
+//! image leaves a hole the packer can't reuse, so when the holes add up to
+//! a large part of the pages, the next insert that doesn't fit repacks
+//! every image, tallest first, instead of starting a page. A repack moves
+//! images; generation() changes whenever one happens.
+//==============================================================================
+class texture_atlas {
+public:
+    typedef uint32_t            id_t;
+    typedef math::rect<int32_t> rect_t;
+
+    struct page {
+        unsigned          width;
+        unsigned          height;
+        std::vector<char> pixels;   //!< bgra8, rows packed, top row first.
+        bool              is_dirty; //!< changed since clean() was last called.
+    };
+
+    //! Where an image is: a page and its pixel rect in that page.
+    struct location {
+        location() : page(0), rect(0, 0, 0, 0) {}
+
+        unsigned page;
+        rect_t   rect;
+    };
+
+    //--------------------------------------------------------------------------
+    //! @param padding
+    //!     Pixels left empty between images so that filtering doesn't pick up
+    //!     the neighbours.
+    //--------------------------------------------------------------------------
+    texture_atlas(unsigned page_width = 2048, unsigned page_height = 2048, unsigned padding = 1);
+
+    //! Add an image; it is decoded straight into the page.
+    id_t insert(tga::image const& image);
+
+    //--------------------------------------------------------------------------
+    //! Add a bgra8 image.
+    //! @param stride
+    //!     Offset in bytes from one row of @c pixels to the next.
+    //! @throw atlas_exception if the image is larger than a page.
+    //--------------------------------------------------------------------------
+    id_t insert(unsigned width, unsigned height, void const* pixels, ptrdiff_t stride);
+
+    void remove(id_t id);
+
+    location const& get(id_t id) const {
+        BK_ASSERT_MSG(is_valid_(id), "invalid id");
+        return entries_[id].where;
+    }
+
+    std::vector<page> const& pages() const {
+        return pages_;
+    }
+
+    //! Clear the dirty flag of every page, e.g. once they are uploaded.
+    void clean();
+
+    //! Changes whenever images are moved; reload locations when it does.
+    unsigned generation() const {
+        return generation_;
+    }
+private:
+    struct entry {
+        location where;
+        bool     alive;
+    };
+
+    //! Reserve room for a w by h image, repacking or adding a page as needed.
+    id_t allocate_(unsigned w, unsigned h);
+    bool place_(unsigned w, unsigned h, location& out);
+    void add_page_();
+    void repack_();
+
+    //! First pixel of @c where in its page.
+    char* pixels_(location const& where);
+
+    bool is_valid_(id_t id) const {
+        return id < entries_.size() && entries_[id].alive;
+    }
+
+    unsigned page_width_;
+    unsigned page_height_;
+    unsigned padding_;
+    unsigned generation_;
+    int64_t  removed_area_; //!< area lost to removals since the last repack.
+
+    std::vector<page>                 pages_;
+    std::vector<math::skyline_packer> packers_;
+    std::vector<entry>                entries_;
+    std::vector<id_t>                 free_;
+};
+
+} //namespace gfx
+} //namespace bklib
@@ -0,0 +1,307 @@
+#include "pch.hpp"
+#include "gfx/texture_cache.hpp"
+
+#include "gfx/targa.hpp"
+#include "util/file_util.hpp"
+
+namespace gfx = ::bklib::gfx;
+
+namespace {
+
+typedef uint8_t byte;
+
+char const     MAGIC[4] = {'B', 'K', 'T', 'C'};
+uint32_t const VERSION  = 2;
+
+//! Entries are made from Targa files, which are no larger than this.
+uint32_t const MAX_DIMENSION = 0xFFFF;
+
+//------------------------------------------------------------------------------
+//! Leads every cache file; the pixels start at pixels_offset.
+//------------------------------------------------------------------------------
+struct entry_header {
+    char     magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_levels;
+    uint32_t mip_filter;
+    uint64_t pixels_offset;
+    uint64_t source_size;
+    uint64_t source_time;
+    uint64_t source_hash;
+};
+
+static_assert(sizeof(entry_header) <= gfx::texture_cache::ALIGNMENT, "header too big");
+
+//------------------------------------------------------------------------------
+//! FNV-1a over 64 bit words, then the bytes left over; fast enough to hash
+//! an image file on a cache miss, but not an identity for any other use.
+//------------------------------------------------------------------------------
+uint64_t hash_bytes(byte const* first, byte const* last) {
+    uint64_t const PRIME = 0x100000001B3ull;
+    uint64_t       h     = 0xCBF29CE484222325ull;
+
+    for (; last - first >= 8; first += 8) {
+        uint64_t word;
+        std::memcpy(&word, first, sizeof(word));
+        h = (h ^ word) * PRIME;
+    }
+
+    for (; first != last; ++first) {
+        h = (h ^ *first) * PRIME;
+    }
+
+    return h;
+}
+
+uint64_t hash_file(bklib::utf8string const& filename) {
+    bklib::mapped_file const file(filename);
+    return hash_bytes(file.begin(), file.end());
+}
+
+//------------------------------------------------------------------------------
+//! Does @c header describe a whole entry in a file of @c size bytes? The
+//! header may be garbage, so the sizes are bounded before any arithmetic that
+//! could wrap.
+//------------------------------------------------------------------------------
+bool is_valid(entry_header const& header, uint64_t size) {
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.width  > MAX_DIMENSION ||
+        header.height > MAX_DIMENSION
+    ) {
+        return false;
+    }
+
+    auto const pixels_size = static_cast<uint64_t>(header.width) * header.height * 4
+        + (header.mip_levels ? gfx::mip_offset(header.width, header.height, header.mip_levels + 1) : 0);
+
+    return (header.mip_levels == 0 || header.mip_levels == gfx::mip_levels(header.width, header.height))
+        && header.pixels_offset % gfx::texture_cache::ALIGNMENT == 0
+        && header.pixels_offset >= sizeof(entry_header)
+        && header.pixels_offset <= size
+        && pixels_size <= size - header.pixels_offset;
+}
+
+//------------------------------------------------------------------------------
+//! Write @c head and then @c tail to a temporary file beside @c path.
+//! @return the name of the temporary file; empty on failure, in which case
+//!         nothing is left behind.
+//------------------------------------------------------------------------------
+bklib::utf8string write_temp(
+    bklib::utf8string const& path,
+    void const* head, size_t head_size,
+    void const* tail, size_t tail_size
+) {
+    auto const temp = bklib::temp_file_name(path);
+
+    bool ok = false;
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::out | std::ios::trunc);
+        out.write(static_cast<char const*>(head), static_cast<std::streamsize>(head_size));
+        out.write(static_cast<char const*>(tail), static_cast<std::streamsize>(tail_size));
+        out.close();
+        ok = !out.fail();
+    }
+
+    if (!ok) {
+        bklib::remove_file(temp);
+        return bklib::utf8string();
+    }
+
+    return temp;
+}
+
+//------------------------------------------------------------------------------
+//! Move the temporary file @c temp over @c path.
+//! @return false on failure; @c temp is removed either way.
+//------------------------------------------------------------------------------
+bool commit_entry(bklib::utf8string const& temp, bklib::utf8string const& path) {
+    if (temp.empty()) {
+        return false;
+    } else if (!bklib::replace_file(temp, path)) {
+        bklib::remove_file(temp);
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+//! Write @c data to @c path by way of a temporary file.
+//! @return false on failure; nothing is left behind.
+//------------------------------------------------------------------------------
+bool write_entry(bklib::utf8string const& path, byte const* data, size_t size) {
+    return commit_entry(write_temp(path, data, size, nullptr, 0), path);
+}
+
+} //namespace
+
+gfx::texture_cache::texture_cache(
+    utf8string       directory,
+    bool       const with_mips,
+    mip_filter const filter
+)
+    : directory_(std::move(directory))
+    , with_mips_(with_mips)
+    , filter_(filter)
+{
+    BK_ASSERT_MSG(!directory_.empty(), "empty directory");
+    create_directory(directory_);
+}
+
+bklib::utf8string gfx::texture_cache::entry_path(utf8string const& source) const {
+    auto const first = reinterpret_cast<byte const*>(source.data());
+    auto const hash  = hash_bytes(first, first + source.size());
+
+    std::ostringstream path;
+    path << directory_ << '/'
+         << std::hex << std::setfill('0') << std::setw(16) << hash
+         << ".tex";
+
+    return path.str();
+}
+
+gfx::texture_cache::texture_ptr
+gfx::texture_cache::load(utf8string const& source) const {
+    file_stamp stamp;
+    if (!get_file_stamp(source, stamp)) {
+        BOOST_THROW_EXCEPTION(texture_cache_exception()
+            << bklib::error_message("missing source.")
+            << boost::errinfo_file_name(source)
+        );
+    }
+
+    auto const path = entry_path(source);
+
+    if (auto result = map_entry_(source, path, stamp)) {
+        return result;
+    }
+
+    return convert_(source, path, stamp);
+}
+
+gfx::texture_cache::texture_ptr gfx::texture_cache::map_entry_(
+    utf8string const& source,
+    utf8string const& path,
+    file_stamp const& stamp
+) const {
+    file_stamp entry_stamp;
+    if (!get_file_stamp(path, entry_stamp) || entry_stamp.size < sizeof(entry_header)) {
+        return texture_ptr();
+    }
+
+    // a whole entry for the source as it is now, made with these settings.
+    auto const read_header = [&](mapped_file const& file, entry_header& header) {
+        if (file.size() < sizeof(header)) {
+            return false;
+        }
+
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        if (!is_valid(header, file.size()) || header.source_size != stamp.size) {
+            return false;
+        }
+
+        auto const levels = with_mips_ ? mip_levels(header.width, header.height) : 0;
+
+        return header.mip_levels == levels
+            && (!levels || header.mip_filter == static_cast<uint32_t>(filter_));
+    };
+
+    try {
+        auto file = std::make_unique<mapped_file>(path);
+
+        entry_header header;
+        if (!read_header(*file, header)) {
+            return texture_ptr();
+        }
+
+        if (header.source_time != stamp.write_time) {
+            if (header.source_hash != hash_file(source)) {
+                return texture_ptr();
+            }
+
+            // same contents; record the new time so the next load doesn't
+            // hash. The entry is replaced like any other, and keeps its old
+            // time if that fails.
+            header.source_time = stamp.write_time;
+
+            auto const temp = write_temp(path,
+                &header, sizeof(header),
+                file->data() + sizeof(header), file->size() - sizeof(header)
+            );
+
+            // a mapped file can't be replaced.
+            file.reset();
+            commit_entry(temp, path);
+
+            // the entry may have been replaced by someone else meanwhile.
+            file = std::make_unique<mapped_file>(path);
+            if (!read_header(*file, header)) {
+                return texture_ptr();
+            }
+        }
+
+        auto result = std::shared_ptr<texture>(new texture());
+        result->width_      = header.width;
+        result->height_     = header.height;
+        result->mip_levels_ = header.mip_levels;
+        result->pixels_     = file->data() + header.pixels_offset;
+        result->file_       = std::move(file);
+
+        return result;
+    } catch (bklib::exception_base&) {
+        // unreadable, e.g. being replaced; convert afresh.
+        return texture_ptr();
+    }
+}
+
+gfx::texture_cache::texture_ptr gfx::texture_cache::convert_(
+    utf8string const& source,
+    utf8string const& path,
+    file_stamp const& stamp
+) const {
+    tga::image const image(source);
+
+    entry_header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version       = VERSION;
+    header.width         = image.width();
+    header.height        = image.height();
+    header.mip_levels    = with_mips_ ? gfx::mip_levels(header.width, header.height) : 0;
+    header.mip_filter    = static_cast<uint32_t>(filter_);
+    header.pixels_offset = ALIGNMENT;
+    header.source_size   = stamp.size;
+    header.source_time   = stamp.write_time;
+    header.source_hash   = hash_file(source);
+
+    auto result = std::shared_ptr<texture>(new texture());
+    result->width_      = header.width;
+    result->height_     = header.height;
+    result->mip_levels_ = header.mip_levels;
+
+    auto const mips_size = header.mip_levels
+        ? mip_offset(header.width, header.height, header.mip_levels + 1) : 0;
+
+    // the file image, header and all, so it can be written in one go.
+    auto& buffer = result->buffer_;
+    buffer.resize(ALIGNMENT + result->size() + mips_size);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    result->pixels_ = buffer.data() + ALIGNMENT;
+    image.decode(buffer.data() + ALIGNMENT, result->width_ * 4, pixel_format::bgra8);
+
+    if (header.mip_levels) {
+        build_mips(
+            result->pixels_, result->width_, result->height_, result->width_ * 4,
+            buffer.data() + ALIGNMENT + result->size(),
+            filter_
+        );
+    }
+
+    write_entry(path, buffer.data(), buffer.size());
+
+    return result;
+}
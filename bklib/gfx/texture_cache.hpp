@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  On disk cache of images converted for the renderer.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "types.hpp"
+#include "exception.hpp"
+#include "util/mapped_file.hpp"
+#include "util/file_util.hpp"
+#include "gfx/mipmap.hpp"
+
+namespace bklib { namespace gfx {
+
+struct texture_cache_exception : virtual exception_base {};
+
+//==============================================================================
+//! Keeps a converted copy of each Targa file loaded through it: a small
+//! header followed by bgra8 pixels, top row first, starting on a page
+//! boundary, and optionally its mipmaps. Warm loads map the copy and hand out
+//! pointers into it; nothing is decoded, filtered or copied.
+//!
+//! An entry is current if the source's size and write time match those it
+//! was made from. If only the write time differs, a hash of the source's
+//! contents decides, so copying or touching the assets doesn't force them all
+//! to be converted again.
+//!
+//! Entries are written to a temporary file and renamed into place, so the
+//! cache is never left with a partial entry and can be shared by threads.
+//==============================================================================
+class texture_cache {
+public:
+    //! Pixels are aligned to this within a cache file, and so in memory.
+    static size_t const ALIGNMENT = 4096;
+
+    //==========================================================================
+    //! A cached image: bgra8, top row first, rows packed.
+    //==========================================================================
+    class texture {
+    public:
+        unsigned width()  const { return width_; }
+        unsigned height() const { return height_; }
+
+        void const* pixels() const { return pixels_; }
+
+        size_t size() const {
+            return static_cast<size_t>(width_) * height_ * 4;
+        }
+
+        //! Number of levels below the image; 0 unless the cache builds them.
+        unsigned mip_levels() const { return mip_levels_; }
+
+        //----------------------------------------------------------------------
+        //! The levels below the image, largest first, rows packed; see
+        //! gfx::mip_offset. Null if there are none.
+        //----------------------------------------------------------------------
+        void const* mips() const {
+            return mip_levels_ ? pixels_ + size() : nullptr;
+        }
+
+        //! @c true if the pixels are mapped from the cache file.
+        bool is_mapped() const {
+            return file_ != nullptr;
+        }
+    private:
+        friend class texture_cache;
+
+        texture()
+            : width_(0), height_(0), mip_levels_(0), pixels_(nullptr)
+        {
+        }
+
+        texture(texture const&); //=delete
+        texture& operator=(texture const&); //=delete
+
+        std::unique_ptr<mapped_file> file_;   //!< a warm load.
+        std::vector<uint8_t>         buffer_; //!< a fresh conversion.
+        unsigned                     width_;
+        unsigned                     height_;
+        unsigned                     mip_levels_;
+        uint8_t const*               pixels_;  //!< followed by the mipmaps.
+    };
+
+    typedef std::shared_ptr<texture const> texture_ptr;
+
+    //--------------------------------------------------------------------------
+    //! @param directory
+    //!     Where to keep the cache files; created if it doesn't exist.
+    //! @param with_mips
+    //!     Build and keep a full mip chain with each image; entries made with
+    //!     other settings are rebuilt.
+    //! @param filter
+    //!     How the mip chain is built.
+    //--------------------------------------------------------------------------
+    explicit texture_cache(
+        utf8string directory,
+        bool       with_mips = false,
+        mip_filter filter    = mip_filter::box
+    );
+
+    //--------------------------------------------------------------------------
+    //! Load the Targa file @c source, from the cache if its entry is current.
+    //! Otherwise @c source is decoded and its entry rewritten; failing to
+    //! write the entry doesn't fail the load.
+    //! @throw targa_exception if @c source must be decoded and can't be.
+    //--------------------------------------------------------------------------
+    texture_ptr load(utf8string const& source) const;
+
+    //! The cache file used for @c source.
+    utf8string entry_path(utf8string const& source) const;
+private:
+    texture_cache(texture_cache const&); //=delete
+    texture_cache& operator=(texture_cache const&); //=delete
+
+    //! The entry at @c path if it is current for @c source; null otherwise.
+    texture_ptr map_entry_(
+        utf8string const& source, utf8string const& path, file_stamp const& stamp
+    ) const;
+
+    //! Decode @c source and write its entry.
+    texture_ptr convert_(
+        utf8string const& source, utf8string const& path, file_stamp const& stamp
+    ) const;
+
+    utf8string directory_;
+    bool       with_mips_;
+    mip_filter filter_;
+};
+
+} //namespace gfx
+} //namespace bklib
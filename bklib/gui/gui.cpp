@@ -9,6 +9,16 @@ gui::color const gui::default_colors::border(0.5f, 0.5f, 0.5f, 0.7f);
 gui::color const gui::default_colors::text(0.8f, 0.8f, 0.8f);
 gui::color const gui::default_colors::highlight(0.7f, 0.7f, 0.7f);
 
+namespace {
+
+//! A rect containing everything; the damage before the first draw.
+gui::rect everything() {
+    auto const max = (std::numeric_limits<gui::scalar_t>::max)();
+    return gui::rect(-max, -max, max, max);
+}
+
+} //namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 // gui_state
 ////////////////////////////////////////////////////////////////////////////////
@@ -18,6 +28,7 @@ gui::gui_state::gui_state(shared_manager manager)
     , mouse_state_()
     , mouse_history_(MOUSE_HISTORY_SIZE, mouse_state())
     , ime_manager_(manager)
+    , damage_(everything())
     , on_redraw_()
 {
     manager->listen<bklib::input::ime::manager::event_on_composition_begin>(
@@ -130,6 +141,18 @@ gui::gui_state::set_ime_manager_(std::shared_ptr<bklib::input::ime::manager> man
     });
 }
 
+void
+gui::gui_state::redraw() {
+    damage_ = region(everything());
+    if (on_redraw_) on_redraw_();
+}
+
+void
+gui::gui_state::redraw(rect const& r) {
+    damage_ |= region(r);
+    if (on_redraw_) on_redraw_();
+}
+
 void
 gui::gui_state::ime_cancel_composition() {
     ime_manager_->cancel_composition();
@@ -144,22 +167,84 @@ gui::gui_state::ime_set_text(bklib::utf8string const& string) {
 ////////////////////////////////////////////////////////////////////////////////
 gui::parent_base_t::parent_base_t(
     size_t //reserve
-) {
+)
+    : zorder_top_(0)
+{
 }
 
+//------------------------------------------------------------------------------
+//! New children are placed on top of the z-order.
+//------------------------------------------------------------------------------
 gui::parent_base_t::handle_t gui::parent_base_t::add_child(unique_t child) {
+    auto const c = child.get();
+    BK_ASSERT_MSG(c->parent_ == nullptr, "Child already has a parent.");
+
+    zorder_.push_front(c);
+    zorder_record const record = {zorder_.begin(), ++zorder_top_};
+    zorder_info_.emplace(c, record);
+
+    child_index_.insert(c, c->get_bounding_rect());
+    c->parent_ = this;
+
     auto result = children_.add(std::move(child));
-    if (callback_on_child_add_) callback_on_child_add_(*this, *child);
+    if (callback_on_child_add_) callback_on_child_add_(*this, *c);
     return result;
 }
 
 gui::parent_base_t::unique_t
 gui::parent_base_t::remove_child(handle_t handle) {
     auto result = children_.remove(handle);
-    if (callback_on_child_remove_) callback_on_child_remove_(*this, *result);
+    auto const c = result.get();
+
+    auto const it = zorder_info_.find(c);
+    zorder_.erase(it->second.pos);
+    zorder_info_.erase(it);
+
+    child_index_.remove(c, c->get_bounding_rect());
+    c->parent_ = nullptr;
+
+    if (callback_on_child_remove_) callback_on_child_remove_(*this, *c);
+    return result;
+}
+
+//------------------------------------------------------------------------------
+//! Only the children sharing a grid cell with (x, y) are tested; of those that
+//! are hit, the one with the highest rank is top-most.
+//------------------------------------------------------------------------------
+gui::parent_base_t::child_t*
+gui::parent_base_t::find_child_at_(scalar_t x, scalar_t y) const {
+    child_t* result = nullptr;
+    unsigned rank   = 0;
+
+    child_index_.for_each_at(x, y, [&](child_t* const c) {
+        auto const r = zorder_info_.find(c)->second.rank;
+        if (r > rank && c->hit_test(x, y)) {
+            result = c;
+            rank   = r;
+        }
+    });
+
     return result;
 }
 
+void gui::parent_base_t::bring_to_front_(child_t& child) {
+    auto& record = zorder_info_.find(&child)->second;
+
+    if (record.pos != zorder_.begin()) {
+        zorder_.splice(zorder_.begin(), zorder_, record.pos);
+        record.pos = zorder_.begin();
+    }
+
+    record.rank = ++zorder_top_;
+}
+
+void gui::parent_base_t::on_child_bounds_change_(
+    child_t&    child,
+    rect const& old_rect
+) {
+    child_index_.update(&child, old_rect, child.get_bounding_rect());
+}
+
 gui::parent_base_t::child_t& gui::parent_base_t::get_child(handle_t handle) {
     return children_.get(handle);
 }
@@ -182,6 +267,7 @@ BK_UTIL_CALLBACK_DEFINE_IMPL(gui::parent_base_t, on_child_remove) {
 ////////////////////////////////////////////////////////////////////////////////
 gui::widget_base_t::widget_base_t(rect r)
     : gui_state_(nullptr)
+    , parent_(nullptr)
     , bounding_rect_(r)
 {
 }
@@ -200,15 +286,21 @@ void gui::widget_base_t::set_bounding_rect(rect r) {
         allow = callback_on_resize_(*this, r, bounding_rect_);
     }
 
+    auto const old_rect = bounding_rect_;
     bounding_rect_ = r;
+    on_bounds_change_(old_rect);
 }
 
 void gui::widget_base_t::resize(
     scalar_t dw, scalar_t dh,
     side_x sx, side_y sy
 ) {
+    auto const old_rect = bounding_rect_;
+
     bounding_rect_.resize(sx, dw);
     bounding_rect_.resize(sy, dh);
+
+    on_bounds_change_(old_rect);
 }
 
 gui::rect gui::widget_base_t::get_bounding_rect() const {
@@ -223,6 +315,7 @@ void gui::widget_base_t::translate(scalar_t dx, scalar_t dy) {
 }
 
 void gui::widget_base_t::move_to(scalar_t x, scalar_t y) {
+    auto const old_rect = bounding_rect_;
     bool allow = true;
 
     if (callback_on_move_) {
@@ -235,6 +328,8 @@ void gui::widget_base_t::move_to(scalar_t x, scalar_t y) {
     if (allow) {
         bounding_rect_.move_to(x, y);
     }
+
+    on_bounds_change_(old_rect);
 }
 
 bool gui::widget_base_t::hit_test(scalar_t x, scalar_t y) const {
@@ -302,6 +397,35 @@ void gui::widget_base_t::set_gui_state(gui_state& state) {
     gui_state_ = std::addressof(state);
 }
 
+//------------------------------------------------------------------------------
+//! Both where the widget was and where it is now need to be redrawn.
+//------------------------------------------------------------------------------
+void gui::widget_base_t::on_bounds_change_(rect const& old_rect) {
+    if (parent_) {
+        parent_->on_child_bounds_change_(*this, old_rect);
+    }
+
+    redraw_(old_rect);
+    redraw_();
+}
+
+void gui::widget_base_t::redraw_() const {
+    redraw_(bounding_rect_);
+}
+
+//------------------------------------------------------------------------------
+//! Borders are stroked on the edges of a rect, so half of the stroke is
+//! outside it; @c r is grown by a pixel to cover that.
+//------------------------------------------------------------------------------
+void gui::widget_base_t::redraw_(rect const& r) const {
+    if (gui_state_ == nullptr) {
+        return;
+    }
+
+    auto const grown = rect(r.left - 1, r.top - 1, r.right + 1, r.bottom + 1);
+    gui_state_->redraw(parent_ ? parent_->to_root(grown) : grown);
+}
+
 BK_UTIL_CALLBACK_DEFINE_IMPL(gui::widget_base_t, on_mouse_enter) {
     callback_on_mouse_enter_ = handler;
 }
@@ -342,8 +466,7 @@ BK_UTIL_CALLBACK_DEFINE_IMPL(gui::widget_base_t, on_input_char) {
 //root
 ////////////////////////////////////////////////////////////////////////////////
 gui::root::root(shared_manager manager)
-    : zorder_()
-    , gui_state_(manager)
+    : gui_state_(manager)
     , ime_candidate_list_()
 {
     namespace ime = bklib::input::ime;
@@ -369,13 +492,13 @@ gui::root::root(shared_manager manager)
     manager->listen<ime::manager::event_on_candidate_list_begin>(
     [&]() {
         ime_candidate_list_.show(true);
-        gui_state_.redraw();
+        gui_state_.redraw(ime_candidate_list_.get_bounding_rect());
     });
 
     manager->listen<ime::manager::event_on_candidate_list_end>(
     [&]() {
         ime_candidate_list_.show(false);
-        gui_state_.redraw();
+        gui_state_.redraw(ime_candidate_list_.get_bounding_rect());
     });
 
     manager->listen<ime::manager::event_on_candidate_list_change_page>(
@@ -386,7 +509,7 @@ gui::root::root(shared_manager manager)
     manager->listen<ime::manager::event_on_candidate_list_change_selection>(
     [&](unsigned selection) {
         ime_candidate_list_.set_current_selection(selection);
-        gui_state_.redraw();
+        gui_state_.redraw(ime_candidate_list_.get_bounding_rect());
     });
 
     manager->listen<ime::manager::event_on_candidate_list_change_strings>(
@@ -407,17 +530,25 @@ void gui::root::draw(renderer_t& renderer) const {
     ime_candidate_list_.draw(renderer);
 }
 
+gui::region gui::root::take_damage() {
+    region result;
+    std::swap(result, gui_state_.damage_);
+    return result;
+}
+
+void gui::root::invalidate() {
+    gui_state_.redraw();
+}
+
 gui::root::handle_t gui::root::add_child(unique_t child) {
-    zorder_.emplace_front(child.get());
     child->set_gui_state(gui_state_);
+    gui_state_.redraw(child->get_bounding_rect());
     return parent_base_t::add_child(std::move(child));
 }
 
 gui::root::unique_t gui::root::remove_child(handle_t handle) {
     auto result = parent_base_t::remove_child(handle);
-
-    zorder_.remove(result.get());
-
+    gui_state_.redraw(result->get_bounding_rect());
     return result;
 }
 
@@ -448,20 +579,15 @@ void gui::root::on_mouse_move_to(int x, int y) {
 
     // Find the topmost widgets for that are hit by the current and previous
     // mouse position.
-    widget_base_t* current = nullptr; //topmost widget the mouse is now over
-    widget_base_t* last    = nullptr; //topmost widget the mouse was last over
-
     auto const     mx = static_cast<scalar_t>(x);
     auto const     my = static_cast<scalar_t>(y);
     auto const last_x = static_cast<scalar_t>(gui_state_.mouse_x());
     auto const last_y = static_cast<scalar_t>(gui_state_.mouse_y());
 
-    for (auto w : zorder_) {
-        current = (!current && w->hit_test(mx, my))         ? w : current;
-        last    = (!last    && w->hit_test(last_x, last_y)) ? w : last;
-
-        if (current && last) break;
-    }
+    //topmost widget the mouse is now over
+    auto const current = find_child_at_(mx, my);
+    //topmost widget the mouse was last over
+    auto const last    = find_child_at_(last_x, last_y);
 
     // If the widget below the mouse has changed, class mouse_enter and
     // mouse_leave.
@@ -492,27 +618,20 @@ void gui::root::on_mouse_down(unsigned button) {
     auto const x = static_cast<scalar_t>(gui_state_.mouse_x());
     auto const y = static_cast<scalar_t>(gui_state_.mouse_y());
 
-    auto it = std::find_if(
-        std::begin(zorder_), std::end(zorder_),
-        [&](zorder_t::value_type const w) {
-            return w->hit_test(x, y);
-        }
-    );
+    auto const w = find_child_at_(x, y);
 
     // Nothing under the mouse.
-    if (it == zorder_.end()) {
+    if (w == nullptr) {
         return;
     }
 
     // Move the widget under the cursor to the top of the zorder if it isn't
     // already.
-    if (it != zorder_.begin()) {
-        zorder_.push_front(*it);
-        zorder_.erase(it);
-    }
+    bring_to_front_(*w);
+    gui_state_.redraw(w->get_bounding_rect());
 
-    gui_state_.capture_input_focus(zorder_.front());
-    zorder_.front()->on_mouse_down(button);
+    gui_state_.capture_input_focus(w);
+    w->on_mouse_down(button);
 }
 
 //------------------------------------------------------------------------------
@@ -533,19 +652,14 @@ void gui::root::on_mouse_up(unsigned button) {
     auto const x = static_cast<scalar_t>(gui_state_.mouse_x());
     auto const y = static_cast<scalar_t>(gui_state_.mouse_y());
 
-    auto const it = std::find_if(
-        std::begin(zorder_), std::end(zorder_),
-        [&](zorder_t::value_type const w) {
-            return w->hit_test(x, y);
-        }
-    );
+    auto const w = find_child_at_(x, y);
 
     // Nothing under the mouse.
-    if (it == zorder_.end()) {
+    if (w == nullptr) {
         return;
     }
 
-    (*it)->on_mouse_up(button);
+    w->on_mouse_up(button);
 }
 
 void gui::root::on_key_up(
@@ -620,6 +734,7 @@ gui::window::window(rect r)
     , text_color_(default_colors::text)
     , width_constraint_(150, 400)
     , height_constraint_(100, 300)
+    , hover_child_(nullptr)
 {
 }
 
@@ -636,6 +751,32 @@ gui::rect const& gui::window::get_client_rect() const {
     return client_rect_;
 }
 
+//------------------------------------------------------------------------------
+//! Children are placed relative to the top left of the client area.
+//------------------------------------------------------------------------------
+gui::rect gui::window::to_root(rect const& r) const {
+    auto result = r;
+    result.translate(client_rect_.left, client_rect_.top);
+
+    return widget_base_t::parent_
+      ? widget_base_t::parent_->to_root(result)
+      : result;
+}
+
+gui::window::unique_t gui::window::remove_child(handle_t handle) {
+    auto result = parent_base_t::remove_child(handle);
+
+    if (hover_child_ == result.get()) {
+        hover_child_ = nullptr;
+    }
+
+    auto r = result->get_bounding_rect();
+    r.translate(client_rect_.left, client_rect_.top);
+    redraw_(r);
+
+    return result;
+}
+
 void gui::window::draw(renderer_t& renderer) const {
     auto& brush = renderer.get_solid_brush();
 
@@ -669,11 +810,11 @@ void gui::window::draw(renderer_t& renderer) const {
     // Clip all drawing to the client area.
     renderer.push_clip_rect(window);
         // Translate the coordinate space.
-        renderer.translate(ox, oy);
-            children_.for_each_reverse([&](widget_base_t& child) {
-                child.draw(renderer);
-            });
-        renderer.translate(-ox, -oy);
+        renderer.push_transform(gfx2d::matrix::translation(ox, oy));
+            for (auto const child : reverse_adapter(zorder_)) {
+                child->draw(renderer);
+            }
+        renderer.pop_transform();
     renderer.pop_clip_rect();
 }
 
@@ -681,14 +822,19 @@ void gui::window::on_mouse_enter() {
     widget_base_t::on_mouse_enter();
 
     back_color_ = default_colors::highlight;
-    gui_state_->redraw();
+    redraw_();
 }
 
 void gui::window::on_mouse_leave() {
     widget_base_t::on_mouse_leave();
 
+    if (hover_child_) {
+        hover_child_->on_mouse_leave();
+        hover_child_ = nullptr;
+    }
+
     back_color_ = default_colors::window;
-    gui_state_->redraw();
+    redraw_();
 }
 
 void gui::window::on_mouse_down(unsigned button) {
@@ -715,17 +861,12 @@ void gui::window::on_mouse_down(unsigned button) {
     auto const x = mx - client_rect_.left;
     auto const y = my - client_rect_.top;
 
-    children_.for_each([&](widget_base_t& w) -> bool {
-        if (w.hit_test(x, y)) {
-            w.on_mouse_down(button);
-            return false;
-        }
-
-        return true;
-    });
+    if (auto const w = find_child_at_(x, y)) {
+        w->on_mouse_down(button);
+    }
 
     widget_base_t::on_mouse_down(button);
-    gui_state_->redraw();
+    redraw_();
 }
 
 void gui::window::on_mouse_up(unsigned button) {
@@ -735,9 +876,13 @@ void gui::window::on_mouse_up(unsigned button) {
     widget_base_t::on_mouse_up(button);
 
     back_color_ = default_colors::window;
-    gui_state_->redraw();
+    redraw_();
 }
 
+//------------------------------------------------------------------------------
+//! While the window is not being moved or sized, tell the children when the
+//! mouse enters or leaves them.
+//------------------------------------------------------------------------------
 void gui::window::on_mouse_move(
       unsigned x
     , unsigned y
@@ -751,12 +896,27 @@ void gui::window::on_mouse_move(
     auto const delta_x = static_cast<signed>(x - old_x);
     auto const delta_y = static_cast<signed>(y - old_y);
 
-    if (state_ == state::moving) {
+    if (state_ == state::none) {
+        auto const cx = static_cast<scalar_t>(x) - client_rect_.left;
+        auto const cy = static_cast<scalar_t>(y) - client_rect_.top;
+
+        auto const current = math::intersects(
+            static_cast<scalar_t>(x), static_cast<scalar_t>(y), client_rect_
+        ) ? find_child_at_(cx, cy) : nullptr;
+
+        if (current != hover_child_) {
+            if (hover_child_) hover_child_->on_mouse_leave();
+            if (current)      current->on_mouse_enter();
+
+            hover_child_ = current;
+        }
+    } else if (state_ == state::moving) {
         translate(
             static_cast<scalar_t>(delta_x),
             static_cast<scalar_t>(delta_y)
         );
     } else if (state_ == state::sizing) {
+        auto const  old_rect = bounding_rect_;
         auto&       r  = bounding_rect_;
         auto const& si = sizing_info_;
 
@@ -793,11 +953,12 @@ void gui::window::on_mouse_move(
         }
     
         client_rect_ = compute_client_rect_();
-        gui_state_->redraw();        
+        on_bounds_change_(old_rect);
     }
 }
 
 void gui::window::resize(scalar_t dw, scalar_t dh, side_x sx, side_y sy) {
+    auto const old_rect = bounding_rect_;
     auto& r = bounding_rect_;
 
     auto const delta_w = (sx == side_x::none) ? 0 :
@@ -809,16 +970,13 @@ void gui::window::resize(scalar_t dw, scalar_t dh, side_x sx, side_y sy) {
     BK_UNUSED_VAR(delta_h);
 
     client_rect_ = compute_client_rect_();
-
-    gui_state_->redraw();
+    on_bounds_change_(old_rect);
 }
 
 void gui::window::move_to(scalar_t x, scalar_t y) {
     widget_base_t::move_to(x, y);
 
     client_rect_ = compute_client_rect_();
-
-    gui_state_->redraw();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -846,13 +1004,14 @@ gui::input::input(rect r)
     , text_("Input")
     , composition_start_(0)
     , composition_end_(0)
+    , hover_(false)
 {
 }
 
 void gui::input::draw(renderer_t& renderer) const {
     auto& b = renderer.get_solid_brush();
 
-    b.set_color(gfx2d::color(0.8f, 0.8f, 0.8f));
+    b.set_color(hover_ ? gfx2d::color(0.9f, 0.9f, 0.9f) : gfx2d::color(0.8f, 0.8f, 0.8f));
     renderer.fill_rect(bounding_rect_, b);
 
     b.set_color(gfx2d::color(0.0f, 0.0f, 0.0f));
@@ -860,6 +1019,20 @@ void gui::input::draw(renderer_t& renderer) const {
     renderer.draw_text(bounding_rect_, text_);
 }
 
+void gui::input::on_mouse_enter() {
+    widget_base_t::on_mouse_enter();
+
+    hover_ = true;
+    redraw_();
+}
+
+void gui::input::on_mouse_leave() {
+    widget_base_t::on_mouse_leave();
+
+    hover_ = false;
+    redraw_();
+}
+
 void gui::input::on_mouse_down(unsigned button) {
     gui_state_->capture_input_focus(this);
     widget_base_t::on_mouse_down(button);
@@ -890,7 +1063,7 @@ void gui::input::on_input_char(bklib::utf32codepoint codepoint) {
         }
     }
 
-    gui_state_->redraw();
+    redraw_();
 }
 
 void gui::input::on_input_update_composition(
@@ -910,7 +1083,7 @@ void gui::input::on_input_update_composition(
 
     composition_end_ = static_cast<unsigned>(text_.size());
 
-    gui_state_->redraw();
+    redraw_();
 }
 
 void gui::input::on_input_begin_composition() {
@@ -2,6 +2,8 @@
 
 #include "gfx/renderer/renderer2d/renderer2d.hpp"
 #include "common/math.hpp"
+#include "common/region.hpp"
+#include "common/spatial_grid.hpp"
 #include "input/input.hpp"
 #include "util/cache.hpp"
 #include "util/callback.hpp"
@@ -13,6 +15,7 @@ typedef float                    scalar_t;
 typedef math::rect<scalar_t>     rect;
 typedef math::point<scalar_t, 2> point;
 typedef math::range<scalar_t>    range;
+typedef math::region<scalar_t>   region;
 
 typedef gfx2d::color      color;
 typedef gfx2d::renderer   renderer_t;
@@ -104,10 +107,10 @@ public:
     //! previous mouse y coord
     mouse_position mouse_last_y() const { return mouse_history_.back().y; }
 
-    //! Request that the root redraw itself.
-    void redraw() {
-        if (on_redraw_) on_redraw_();
-    }
+    //! Request that the root redraw everything.
+    void redraw();
+    //! Request that the root redraw @c r, in root coordinates.
+    void redraw(rect const& r);
 
     void ime_cancel_composition();
     void ime_set_text(utf8string const& string);
@@ -132,6 +135,9 @@ private:
 
     shared_manager ime_manager_;
 
+    //! What has changed since the root last drew, in root coordinates.
+    region damage_;
+
     std::function<void ()> on_redraw_;
 }; //---------------------------------------------------------------------------
 
@@ -139,6 +145,7 @@ private:
 //! Default implementation for widgets that act as containers for other widgets.
 //------------------------------------------------------------------------------
 class parent_base_t {
+    friend class widget_base_t;
 public:
     typedef widget_base_t           child_t;
     typedef bklib::cache_t<child_t> container_t;
@@ -153,6 +160,9 @@ public:
 
     virtual child_t&       get_child(handle_t handle);
     virtual child_t const& get_child(handle_t handle) const;
+
+    //! Map @c r from the coordinate space of the children to the root's.
+    virtual rect to_root(rect const& r) const { return r; }
     //--------------------------------------------------------------------------
     BK_UTIL_CALLBACK_BEGIN;
         BK_UTIL_CALLBACK_DECLARE( on_child_add,
@@ -161,10 +171,31 @@ public:
                                   void (parent_base_t& p, child_t& c) );
     BK_UTIL_CALLBACK_END;
 protected:
+    //! Children in z-order; the front is top-most.
+    typedef std::list<child_t*> zorder_t;
+    typedef math::spatial_grid<child_t*, scalar_t> child_index_t;
+
+    //! Top-most child containing the point (x, y), or nullptr.
+    child_t* find_child_at_(scalar_t x, scalar_t y) const;
+    //! Move @c child to the top of the z-order.
+    void bring_to_front_(child_t& child);
+    //! Called by a child after its bounding rect has changed.
+    void on_child_bounds_change_(child_t& child, rect const& old_rect);
+
     container_t children_;
+    zorder_t    zorder_;
 
     event_on_child_add::type    callback_on_child_add_;
     event_on_child_remove::type callback_on_child_remove_;
+private:
+    struct zorder_record {
+        zorder_t::iterator pos;
+        unsigned           rank; //!< larger is closer to the top.
+    };
+
+    child_index_t child_index_;
+    std::unordered_map<child_t const*, zorder_record> zorder_info_;
+    unsigned zorder_top_;
 }; //---------------------------------------------------------------------------
 
 BK_UTIL_CALLBACK_DECLARE_EXTERN(parent_base_t, on_child_add);
@@ -201,6 +232,7 @@ public:
 //! Default implementation for simple widgets.
 //------------------------------------------------------------------------------
 class widget_base_t {
+    friend class parent_base_t;
 public:
     typedef math::rect_base::side_x side_x;
     typedef math::rect_base::side_y side_y;
@@ -270,8 +302,17 @@ public:
         BK_UTIL_CALLBACK_DECLARE(on_input_char, void (widget_base_t& w, utf32codepoint code));
     BK_UTIL_CALLBACK_END;
 protected:
-    gui_state* gui_state_;
-    rect       bounding_rect_;
+    //! Must be called after any change to bounding_rect_.
+    void on_bounds_change_(rect const& old_rect);
+
+    //! Request that the whole widget be redrawn.
+    void redraw_() const;
+    //! Request that @c r, in the coordinate space of the parent, be redrawn.
+    void redraw_(rect const& r) const;
+
+    gui_state*     gui_state_;
+    parent_base_t* parent_;
+    rect           bounding_rect_;
 
     event_on_mouse_enter::type callback_on_mouse_enter_;
     event_on_mouse_leave::type callback_on_mouse_leave_;
@@ -347,6 +388,15 @@ public:
 
     void draw(renderer_t& renderer) const;
 
+    //--------------------------------------------------------------------------
+    //! What needs to be redrawn, for the renderer's draw_begin(); the damage
+    //! is cleared, so the caller must redraw all of it.
+    //--------------------------------------------------------------------------
+    region take_damage();
+
+    //! Mark everything as damaged, e.g. after the render target is resized.
+    void invalidate();
+
     handle_t add_child(unique_t child) override;
     unique_t remove_child(handle_t handle) override;
 
@@ -364,9 +414,6 @@ public:
         BK_UTIL_CALLBACK_DECLARE( on_update, void () );
     BK_UTIL_CALLBACK_END;
 private:
-    typedef std::list<widget_base_t*> zorder_t;
-    zorder_t zorder_;
-
     gui_state gui_state_;
     ime_candidate_list ime_candidate_list_;
 };
@@ -408,6 +455,10 @@ public:
     virtual rect const& get_client_rect() const;
 
     virtual void set_gui_state(gui_state& state) override;
+
+    virtual rect to_root(rect const& r) const override;
+
+    virtual unique_t remove_child(handle_t handle) override;
 private:
     scalar_t compute_minimum_width_() const {
         return BORDER_SIZE * 2;
@@ -460,6 +511,9 @@ private:
     range height_constraint_;
 
     rect client_rect_;
+
+    //! The child the mouse is over, if any.
+    child_t* hover_child_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -476,6 +530,8 @@ public:
     virtual void on_input_begin_composition()  override;
     virtual void on_input_end_composition()  override;
 
+    virtual void on_mouse_enter() override;
+    virtual void on_mouse_leave() override;
     virtual void on_mouse_down(unsigned button);
 
     virtual void draw(renderer_t& renderer) const;
@@ -486,6 +542,7 @@ private:
     utf8string text_;
     unsigned composition_start_;
     unsigned composition_end_;
+    bool     hover_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -5,7 +5,7 @@
 #include "gfx/renderer/renderer2d/renderer2d.hpp"
 #include "gui/gui.hpp"
 
-#include "gfx/targa.hpp"
+#include "gfx/asset_loader.hpp"
 
 //template <typename T>
 //struct realloc_allocator
@@ -68,85 +68,6 @@
 //};
 
 
-template <size_t N, typename tag_t, typename storage_t = unsigned>
-struct color_component {
-    static size_t const bits = N;
-    typedef tag_t type;
-    typedef storage_t storage;
-};
-
-namespace color {
-    struct tag_none;
-    struct tag_r;
-    struct tag_g;
-    struct tag_b;
-    struct tag_a;
-
-    template <typename T>
-    struct none : public color_component<0, tag_none, typename T::storage_t> {
-    };
-
-    typedef color_component<8, tag_r> r8;
-    typedef color_component<8, tag_g> g8;
-    typedef color_component<8, tag_b> b8;
-    typedef color_component<8, tag_a> a8;
-}
-
-template <
-    typename C1,
-    typename C2 = color::none<C1>,
-    typename C3 = color::none<C2>,
-    typename C4 = color::none<C3>
->
-struct color_format {
-    static_assert(
-        std::is_same<typename C1::storage_t, typename C2::storage_t>::value &&
-        std::is_same<typename C2::storage_t, typename C3::storage_t>::value &&
-        std::is_same<typename C3::storage_t, typename C4::storage_t>::value
-        , "mismatched storage types"
-    );
-
-    static size_t const bits = C1::bits + C2::bits + C3::bits + C4::bits;
-};
-
-typedef color_format<color::b8, color::g8, color::r8>            tga_24;
-typedef color_format<color::b8, color::g8, color::r8, color::a8> tga_32;
-
-typedef color_format<color::b8, color::g8, color::r8, color::a8> bgra8;
-
-template <typename src, typename dest>
-void convert(
-    void const* in_begin,  void const* in_end,
-    void*       out_begin, void*       out_end
-);
-
-template <>
-void convert<tga_24, bgra8> (
-    void const* in_begin,  void const* in_end,
-    void*       out_begin, void*       out_end
-) {
-    auto const in_size  = (ptrdiff_t)in_end  - (ptrdiff_t)in_begin;
-    auto const out_size = (ptrdiff_t)out_end - (ptrdiff_t)out_begin;
-
-    BK_ASSERT_MSG(in_size  >= 0, "bad pointers");
-    BK_ASSERT_MSG(out_size >= 0, "bad pointers");
-    BK_ASSERT_MSG(in_size  % 3 == 0, "wrong size");
-    BK_ASSERT_MSG(out_size % 4 == 0, "wrong size");
-    BK_ASSERT_MSG(out_size - in_size == in_size / 3, "wrong size");
-
-    auto in  = reinterpret_cast<char const*>(in_begin);
-    auto out = reinterpret_cast<char*>(out_begin);
-
-    while (in != reinterpret_cast<char const*>(in_end)) {
-        *reinterpret_cast<uint32_t*>(out) = *reinterpret_cast<uint32_t const*>(in);
-        out[3] = 0;
-        
-        in  += 3;
-        out += 4;
-    }
-}
-
-
 struct tile_set {
     tile_set(unsigned tile_w, unsigned tile_h, unsigned texture_w, unsigned texture_h)
         : tile_width_(tile_w), tile_height_(tile_h)
@@ -200,31 +121,70 @@ try {
     gfx2d::renderer renderer(win);
 
     ////////
-    tga::image image("tiles.tga");
-
-    std::vector<char> converted((image.size() / 3)*4, 0);
+    // the first frames draw placeholders while the tiles load; converted
+    // copies, with mipmaps for zooming out, are kept so later runs only map
+    // them.
+    gfx::texture_cache texture_cache("cache", true);
+    gfx::asset_loader  loader(0, &texture_cache);
+    bool has_tiles = false;
+    gfx2d::texture_handle tiles_texture;
+
+    loader.load_image("tiles.tga", [&](gfx::asset_loader::image_future const& f) {
+        gfx::asset_loader::image_ptr image;
+
+        // a missing or bad file keeps the placeholders; letting the exception
+        // out of dispatch_completions() would end the main loop.
+        try {
+            image = f.get();
+        } catch (std::exception const& e) {
+            OutputDebugStringA(boost::diagnostic_information(e).c_str());
+            return;
+        }
 
-    convert<tga_24, bgra8>(
-        image.cbegin(), image.cend(),
-        converted.data(), converted.data() + converted.size()
-    );
+        tiles_texture = renderer.create_texture(
+            image->width, image->height, image->pixels, image->mip_levels, image->mips
+        );
+        has_tiles = true;
+        gui_root.invalidate();
+    });
 
-    renderer.create_texture(image.width(), image.height(), converted.data());
-    
     auto image_rect_src  = bklib::gfx2d::rect(16, 16, 32, 32);
+
+    // the background is drawn as one batch rather than a call per tile.
+    std::vector<gfx2d::sprite> tiles;
+    tiles.reserve(16 * 16);
+
+    for (int x = 0; x < 16; ++x) {
+        for (int y = 0; y < 16; ++y) {
+            tiles.push_back(gfx2d::sprite(
+                image_rect_src, bklib::gfx2d::rect(x*16, y*16, x*16+16, y*16+16)
+            ));
+        }
+    }
     
     ////////
 
     //set up event handlers
+    // only what the gui reports as changed is redrawn; the rest of the window
+    // keeps the last frame.
     auto on_paint = [&] {
-        renderer.draw_begin();
+        auto const damage = gui_root.take_damage();
+        if (damage.empty()) {
+            return;
+        }
+
+        renderer.draw_begin(damage);
         
         renderer.clear(bklib::gfx2d::color(0.5f, 0.5f, 0.0f));
         
-        for (int x = 0; x < 16; ++x) {
-            for (int y = 0; y < 16; ++y) {
-                auto image_rect_dest = bklib::gfx2d::rect(x*16, y*16, x*16+16, y*16+16);
-                renderer.draw_texture(image_rect_src, image_rect_dest);
+        auto& brush = renderer.get_solid_brush();
+        brush.set_color(bklib::gfx2d::color(0.25f, 0.25f, 0.25f));
+
+        if (has_tiles) {
+            renderer.draw_sprites(tiles_texture, tiles.data(), tiles.size());
+        } else {
+            for (auto const& tile : tiles) {
+                renderer.fill_rect(tile.dest, brush);
             }
         }
         
@@ -270,12 +230,14 @@ try {
         quit_flag = true;
     });
 
+    // the system may have discarded what was on screen.
     win.listen<window::event_on_paint>([&] {
-        //on_paint();
+        gui_root.invalidate();
     });
 
     win.listen<window::event_on_size>([&](unsigned w, unsigned h) {
         renderer.resize(w, h);
+        gui_root.invalidate();
     });
 
     ////////////////////
@@ -295,7 +257,6 @@ try {
         gui_root.add_child(std::move(w));
     }
 
-    gui_root.listen<gui::root::event_on_update>(on_paint);
     ////////////////////
 
     win.show();
@@ -303,6 +264,7 @@ try {
     while (!quit_flag) {
         win.do_pending_events();
         ime_manager->do_pending_events();
+        loader.dispatch_completions();
         Sleep(1);
         on_paint();
     }
@@ -1,7 +1,8 @@
 #include "pch.hpp"
 
 #include "platform/win/com/com.hpp"
-#include "gfx/renderer/renderer2d/renderer2d.hpp"
+#include "gfx/renderer/renderer2d/backend.hpp"
+#include "gfx/mipmap.hpp"
 
 namespace g2d = ::bklib::gfx2d;
 namespace win = ::bklib::platform::win;
@@ -35,8 +36,26 @@ struct solid_color_brush_impl : public g2d::solid_color_brush {
     }
 };
 
-struct g2d::renderer::impl_t {
-    impl_t(window& win) {
+struct d2d_backend : public g2d::renderer::impl_t {
+    //--------------------------------------------------------------------------
+    //! Bitmaps can't be read back, so textures with mips keep a copy of every
+    //! level to rebuild the mips from when the image changes.
+    //--------------------------------------------------------------------------
+    struct texture {
+        struct level_copy {
+            unsigned              width;
+            unsigned              height;
+            std::vector<uint32_t> pixels;
+        };
+
+        std::vector<win::com_ptr<ID2D1Bitmap>> levels; //!< the image, then its mips.
+        std::vector<level_copy>                copies; //!< empty without mips.
+        ::bklib::gfx::mip_filter               filter; //!< that the mips were built with.
+    };
+
+    explicit d2d_backend(bklib::window& win)
+        : transform_(g2d::matrix::identity())
+    {
         HWND hwnd = win.handle();
 
         factory_ = win::make_com_ptr([](ID2D1Factory** out) {
@@ -51,10 +70,16 @@ struct g2d::renderer::impl_t {
             r.bottom - r.top
         );
 
+        // a partial frame draws only the damage, so the rest of the back
+        // buffer must still hold the last frame.
+        auto const present = static_cast<D2D1_PRESENT_OPTIONS>(
+            ::D2D1_PRESENT_OPTIONS_IMMEDIATELY | ::D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS
+        );
+
         target_ = win::make_com_ptr([&](ID2D1HwndRenderTarget** out) {
             return factory_->CreateHwndRenderTarget(
                 D2D1::RenderTargetProperties(),
-                D2D1::HwndRenderTargetProperties(hwnd, size, ::D2D1_PRESENT_OPTIONS_IMMEDIATELY),
+                D2D1::HwndRenderTargetProperties(hwnd, size, present),
                 out
             );
         });
@@ -100,51 +125,51 @@ struct g2d::renderer::impl_t {
     }
 
     void
-    update()
+    update() override
     {
         ::InvalidateRect(target_->GetHwnd(), nullptr, FALSE);
     }
 
     void
-    resize(unsigned w, unsigned h)
+    resize(unsigned w, unsigned h) override
     {
         target_->Resize(D2D1::SizeU(w, h));
     }
 
     g2d::solid_color_brush&
-    get_solid_brush()
+    get_solid_brush() override
     {
         return solid_brush_;
     }
 
-    void begin() {
+    void begin() override {
         target_->BeginDraw();
     }
 
-    void end() {
+    void end() override {
         target_->EndDraw();
     }
 
-    void clear(color color) {
+    void clear(g2d::color color) override {
         target_->Clear(D2D1::ColorF(color.r, color.g, color.b));
     }
 
-    void push_clip_rect(rect const& r) {
+    void push_clip_rect(g2d::rect const& r) override {
         target_->PushAxisAlignedClip(make_rect(r), D2D1_ANTIALIAS_MODE_ALIASED);
     }
 
-    void pop_clip_rect() {
+    void pop_clip_rect() override {
         target_->PopAxisAlignedClip();
     }
 
-    void fill_rect(rect const& r, brush const& b) {
+    void fill_rect(g2d::rect const& r, g2d::brush const& b) override {
         target_->FillRectangle(
             make_rect(r),
             ((brush_impl&)b).brush
         );
     }
 
-    void draw_rect(rect const& r, brush const& b, float width) {
+    void draw_rect(g2d::rect const& r, g2d::brush const& b, float width) override {
         target_->DrawRectangle(
             make_rect(r),
             ((brush_impl&)b).brush,
@@ -152,7 +177,7 @@ struct g2d::renderer::impl_t {
         );
     }
 
-    void draw_text(rect const& r, utf8string const& text) {
+    void draw_text(g2d::rect const& r, bklib::utf8string const& text) override {
         auto const t = convert.from_bytes(text);
 
         target_->DrawTextW(
@@ -164,22 +189,16 @@ struct g2d::renderer::impl_t {
         );
     }
     
-    //void set_transformation(renderer::matrix const& m) {
-    //    auto const mat = reinterpret_cast<D2D1_MATRIX_3X2_F const*>(m.data());
-    //    target_->SetTransform(mat);
-    //}
-
-    void translate(float x, float y) {
-        D2D1_MATRIX_3X2_F m;
-        target_->GetTransform(&m);
+    void set_transform(g2d::matrix const& m) override {
+        transform_ = m;
 
-        m = D2D1::Matrix3x2F::Translation(x, y) * m;
-
-        target_->SetTransform(m);
+        target_->SetTransform(
+            D2D1::Matrix3x2F(m.m11, m.m12, m.m21, m.m22, m.dx, m.dy)
+        );
     }
 
     std::unique_ptr<g2d::solid_color_brush>
-    create_soild_brush(color color) {
+    create_soild_brush(g2d::color color) override {
         auto brush = win::make_com_ptr([&](ID2D1SolidColorBrush** out) {
             return target_->CreateSolidColorBrush(D2D1::ColorF(color.r, color.g, color.b, color.a), out);
         });
@@ -187,29 +206,174 @@ struct g2d::renderer::impl_t {
         return std::make_unique<solid_color_brush_impl>(std::move(brush));
     }
 
-    void draw_texture(rect src, rect dest) {
+    void draw_texture(g2d::texture_handle tex, g2d::rect src, g2d::rect dest) override {
+        draw_bitmap_(textures_.get(tex), src, dest, 1.0f);
+    }
+
+    //--------------------------------------------------------------------------
+    //! ID2D1RenderTarget has no sprite batch and no way to modulate a bitmap's
+    //! color, so this is a loop of DrawBitmap calls using the tints' alpha.
+    //--------------------------------------------------------------------------
+    void draw_sprites(g2d::texture_handle tex, g2d::sprite const* sprites, size_t count) override {
+        auto const& t = textures_.get(tex);
+
+        for (size_t i = 0; i < count; ++i) {
+            auto const& s = sprites[i];
+            draw_bitmap_(t, s.src, s.dest, s.tint.a);
+        }
+    }
+
+    g2d::texture_handle create_texture(
+        unsigned                 w,
+        unsigned                 h,
+        void const*              data,
+        unsigned                 mip_levels,
+        void const*              mips,
+        ::bklib::gfx::mip_filter filter
+    ) override {
+        auto const make_bitmap = [&](unsigned w, unsigned h, void const* data) {
+            return win::make_com_ptr([&](ID2D1Bitmap** out) {
+                return target_->CreateBitmap(
+                    D2D1::SizeU(w, h),
+                    data,
+                    w * 4,
+                    D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE)),
+                    out
+                );
+            });
+        };
+
+        auto result = std::make_unique<texture>();
+        result->filter = filter;
+
+        auto const levels = static_cast<uint8_t const*>(mips);
+        auto const keep   = levels && mip_levels;
+
+        auto const add_level = [&](unsigned w, unsigned h, void const* pixels) {
+            result->levels.push_back(make_bitmap(w, h, pixels));
+
+            if (keep) {
+                texture::level_copy copy;
+                copy.width  = w;
+                copy.height = h;
+                copy.pixels.resize(static_cast<size_t>(w) * h);
+
+                if (pixels) {
+                    std::memcpy(copy.pixels.data(), pixels, copy.pixels.size() * sizeof(uint32_t));
+                }
+
+                result->copies.push_back(std::move(copy));
+            }
+        };
+
+        add_level(w, h, data);
+
+        for (unsigned l = 1; levels && l <= mip_levels; ++l) {
+            add_level(
+                ::bklib::gfx::mip_extent(w, l),
+                ::bklib::gfx::mip_extent(h, l),
+                levels + ::bklib::gfx::mip_offset(w, h, l)
+            );
+        }
+
+        return textures_.add(std::move(result));
+    }
+
+    void destroy_texture(g2d::texture_handle tex) override {
+        textures_.remove(tex);
+    }
+
+    g2d::texel_rect texture_bounds(g2d::texture_handle tex) override {
+        auto const size = textures_.get(tex).levels.front()->GetPixelSize();
+        return g2d::texel_rect(0, 0, size.width, size.height);
+    }
+
+    void update_texture_region(
+        g2d::texture_handle    tex,
+        g2d::texel_rect const& region,
+        void const*            data
+    ) override {
+        auto& t = textures_.get(tex);
+
+        auto const size = t.levels.front()->GetPixelSize();
+        BK_ASSERT_MSG(region.left >= 0 && region.top >= 0, "region out of bounds");
+        BK_ASSERT_MSG(region.right  <= static_cast<int32_t>(size.width),  "region out of bounds");
+        BK_ASSERT_MSG(region.bottom <= static_cast<int32_t>(size.height), "region out of bounds");
+
+        auto const upload = [&](size_t l, g2d::texel_rect const& r, void const* pixels, unsigned pitch) {
+            auto const rect = D2D1::RectU(r.left, r.top, r.right, r.bottom);
+            t.levels[l]->CopyFromMemory(&rect, pixels, pitch);
+        };
+
+        upload(0, region, data, region.width() * 4);
+
+        if (t.copies.empty()) {
+            return;
+        }
+
+        auto&      image = t.copies.front();
+        auto const n     = static_cast<size_t>(region.width());
+        auto const in    = static_cast<uint32_t const*>(data);
+
+        for (auto y = region.top; y < region.bottom; ++y) {
+            std::memcpy(
+                image.pixels.data() + static_cast<size_t>(y) * image.width + region.left,
+                in + static_cast<size_t>(y - region.top) * n,
+                n * sizeof(uint32_t)
+            );
+        }
+
+        // each level only where the one above it changed.
+        auto changed = region;
+        for (size_t l = 1; l < t.copies.size() && changed.width() > 0; ++l) {
+            auto const& above = t.copies[l - 1];
+            auto&       level = t.copies[l];
+
+            changed = ::bklib::gfx::update_mip_level(
+                above.pixels.data(), above.width, above.height, above.width * 4,
+                changed,
+                level.pixels.data(), level.width * 4,
+                t.filter
+            );
+
+            if (changed.width() > 0) {
+                upload(l, changed,
+                    level.pixels.data() + static_cast<size_t>(changed.top) * level.width + changed.left,
+                    level.width * 4
+                );
+            }
+        }
+    }
+
+    //! Draw from the mip level that best matches the scale of src to dest
+    //! once transformed, as the software backend does.
+    void draw_bitmap_(texture const& t, g2d::rect const& src, g2d::rect const& dest, float opacity) {
+        // source texels per device pixel along the more shrunk axis.
+        auto const device = transform_.apply(dest);
+        auto const dest_w = std::abs(device.right  - device.left);
+        auto const dest_h = std::abs(device.bottom - device.top);
+        auto const scale  = (std::max)(
+            dest_w > 0.0f ? std::abs(src.right  - src.left) / dest_w : 0.0f,
+            dest_h > 0.0f ? std::abs(src.bottom - src.top)  / dest_h : 0.0f
+        );
+
+        auto const level = ::bklib::gfx::mip_level_for(
+            scale, static_cast<unsigned>(t.levels.size() - 1)
+        );
+
+        auto const k = 1.0f / static_cast<float>(1u << level);
+        auto const level_src = g2d::rect(src.left * k, src.top * k, src.right * k, src.bottom * k);
+
         target_->DrawBitmap(
-            texture_,
+            t.levels[level],
             make_rect(dest),
-            1.0f,
+            opacity,
             D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
-            make_rect(src)
+            make_rect(level_src)
         );
     }
 
-    void create_texture(unsigned w, unsigned h, void const* data) {
-        texture_ = win::make_com_ptr([&](ID2D1Bitmap** out) {
-            return target_->CreateBitmap(
-                D2D1::SizeU(w, h),
-                data,
-                w * 4,
-                D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE)),
-                out
-            );
-        });
-    }
-
-    utf8_16_converter convert;
+    bklib::utf8_16_converter convert;
 
     win::com_ptr<ID2D1Factory>          factory_;
     win::com_ptr<ID2D1HwndRenderTarget> target_;
@@ -217,7 +381,8 @@ struct g2d::renderer::impl_t {
     win::com_ptr<IDWriteFactory>        write_factory_;
     win::com_ptr<IDWriteTextFormat>     text_format_;
 
-    win::com_ptr<ID2D1Bitmap> texture_;
+    bklib::cache_t<texture> textures_;
+    g2d::matrix             transform_; //!< as last set; for choosing mip levels.
 
     solid_color_brush_impl  solid_brush_;
 };
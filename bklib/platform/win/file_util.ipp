@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------------
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Windows implementation of util/file_util.hpp.
+//------------------------------------------------------------------------------
+
+#include "pch.hpp"
+#include "util/file_util.hpp"
+
+bool bklib::get_file_stamp(utf8string const& filename, file_stamp& out) {
+    auto const name = utf8_16_converter().from_bytes(filename);
+
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!::GetFileAttributesExW(name.c_str(), GetFileExInfoStandard, &data)) {
+        return false;
+    }
+
+    out.size       = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    out.write_time = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32)
+                   | data.ftLastWriteTime.dwLowDateTime;
+
+    return true;
+}
+
+bool bklib::replace_file(utf8string const& from, utf8string const& to) {
+    utf8_16_converter convert;
+
+    auto const from_name = convert.from_bytes(from);
+    auto const to_name   = convert.from_bytes(to);
+
+    return ::MoveFileExW(from_name.c_str(), to_name.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool bklib::remove_file(utf8string const& filename) {
+    auto const name = utf8_16_converter().from_bytes(filename);
+    return ::DeleteFileW(name.c_str()) != 0;
+}
+
+bklib::utf8string bklib::temp_file_name(utf8string const& path) {
+    std::ostringstream name;
+    name << path << ".tmp" << ::GetCurrentProcessId() << '.' << ::GetCurrentThreadId();
+
+    return name.str();
+}
+
+void bklib::create_directory(utf8string const& path) {
+    auto const name = utf8_16_converter().from_bytes(path);
+
+    if (!::CreateDirectoryW(name.c_str(), nullptr)) {
+        auto const error = ::GetLastError();
+        BK_THROW_ON_FAIL(::CreateDirectoryW,
+            error == ERROR_ALREADY_EXISTS ? S_OK : HRESULT_FROM_WIN32(error)
+        );
+    }
+}
@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Windows implementation of bklib::mapped_file.
+//------------------------------------------------------------------------------
+
+#include "pch.hpp"
+#include "util/mapped_file.hpp"
+
+//------------------------------------------------------------------------------
+//! Windows specific implementation for bklib::mapped_file.
+//------------------------------------------------------------------------------
+struct bklib::mapped_file::impl_t {
+    explicit impl_t(utf8string const& filename)
+        : file_(INVALID_HANDLE_VALUE)
+        , mapping_(nullptr)
+        , view_(nullptr)
+        , size_(0)
+    {
+        auto const name = utf8_16_converter().from_bytes(filename);
+
+        file_ = ::CreateFileW(
+            name.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+        );
+
+        BK_THROW_ON_FAIL(::CreateFileW,
+            file_ != INVALID_HANDLE_VALUE ? S_OK : HRESULT_FROM_WIN32(::GetLastError())
+        );
+
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(file_, &size)) {
+            auto const hr = HRESULT_FROM_WIN32(::GetLastError());
+            close_();
+            BK_THROW_ON_FAIL(::GetFileSizeEx, hr);
+        }
+
+        // empty files can't be mapped; leave the view null.
+        if (size.QuadPart == 0) {
+            return;
+        }
+
+        if (static_cast<uint64_t>(size.QuadPart) > (std::numeric_limits<size_t>::max)()) {
+            close_();
+            BK_THROW_ON_FAIL(::GetFileSizeEx, E_OUTOFMEMORY);
+        }
+
+        size_ = static_cast<size_t>(size.QuadPart);
+
+        mapping_ = ::CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr) {
+            auto const hr = HRESULT_FROM_WIN32(::GetLastError());
+            close_();
+            BK_THROW_ON_FAIL(::CreateFileMappingW, hr);
+        }
+
+        view_ = ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (view_ == nullptr) {
+            auto const hr = HRESULT_FROM_WIN32(::GetLastError());
+            close_();
+            BK_THROW_ON_FAIL(::MapViewOfFile, hr);
+        }
+    }
+
+    ~impl_t() {
+        close_();
+    }
+
+    uint8_t const* data() const {
+        return static_cast<uint8_t const*>(view_);
+    }
+
+    size_t size() const {
+        return size_;
+    }
+private:
+    impl_t(impl_t const&); //=delete
+    impl_t& operator=(impl_t const&); //=delete
+
+    void close_() {
+        if (view_)                         ::UnmapViewOfFile(view_);
+        if (mapping_)                      ::CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) ::CloseHandle(file_);
+
+        view_    = nullptr;
+        mapping_ = nullptr;
+        file_    = INVALID_HANDLE_VALUE;
+    }
+
+    HANDLE      file_;
+    HANDLE      mapping_;
+    void const* view_;
+    size_t      size_;
+};
@@ -0,0 +1,48 @@
+#include "pch.hpp"
+#include "util/cpu.hpp"
+
+#if defined(BK_CONFIG_ARCH_X64) || defined(BK_CONFIG_ARCH_X86)
+#   include <intrin.h>
+
+namespace {
+
+void cpuid(int info[4], int leaf) {
+    __cpuidex(info, leaf, 0);
+}
+
+//! The register state the OS saves on a context switch (XCR0).
+uint64_t enabled_state() {
+    return _xgetbv(0);
+}
+
+} //namespace
+
+bklib::cpu_features bklib::detect_cpu_features() {
+    cpu_features result = {};
+
+    int info[4];
+    cpuid(info, 0);
+    auto const max_leaf = info[0];
+
+    cpuid(info, 1);
+    result.sse2  = (info[3] & (1 << 26)) != 0;
+    result.ssse3 = (info[2] & (1 << 9))  != 0;
+    result.sse41 = (info[2] & (1 << 19)) != 0;
+
+    auto const has_xsave = (info[2] & (1 << 27)) != 0;
+    auto const has_avx   = (info[2] & (1 << 28)) != 0;
+
+    // xmm and ymm state (bits 1 and 2) must both be enabled.
+    if (has_xsave && has_avx && (enabled_state() & 6) == 6 && max_leaf >= 7) {
+        cpuid(info, 7);
+        result.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    return result;
+}
+#else
+bklib::cpu_features bklib::detect_cpu_features() {
+    cpu_features const result = {};
+    return result;
+}
+#endif
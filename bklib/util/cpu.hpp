@@ -0,0 +1,27 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Run time detection of instruction set extensions.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+namespace bklib {
+
+//------------------------------------------------------------------------------
+//! Instruction set extensions usable on this machine.
+//------------------------------------------------------------------------------
+struct cpu_features {
+    bool sse2;
+    bool ssse3;
+    bool sse41;
+    bool avx2; //!< also requires the OS to save the ymm registers.
+};
+
+//------------------------------------------------------------------------------
+//! Query the processor; all false on architectures other than x86 and x64.
+//! Not cheap; call once and keep the result.
+//------------------------------------------------------------------------------
+cpu_features detect_cpu_features();
+
+} //namespace bklib
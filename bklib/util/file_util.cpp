@@ -0,0 +1,4 @@
+#include "pch.hpp"
+#include "file_util.hpp"
+
+#include "platform/win/file_util.ipp"
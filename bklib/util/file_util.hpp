@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  File system queries and operations missing from the standard
+//!         library.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+#include "types.hpp"
+
+namespace bklib {
+
+//------------------------------------------------------------------------------
+//! What changes when a file is written.
+//------------------------------------------------------------------------------
+struct file_stamp {
+    bool operator==(file_stamp const& rhs) const {
+        return size == rhs.size && write_time == rhs.write_time;
+    }
+
+    bool operator!=(file_stamp const& rhs) const {
+        return !(*this == rhs);
+    }
+
+    uint64_t size;
+    uint64_t write_time; //!< in platform units; only good for comparisons.
+};
+
+//------------------------------------------------------------------------------
+//! Get the size and last write time of @c filename.
+//! @return false if the file doesn't exist or can't be queried.
+//------------------------------------------------------------------------------
+bool get_file_stamp(utf8string const& filename, file_stamp& out);
+
+//------------------------------------------------------------------------------
+//! Rename @c from to @c to in one step, replacing any file already there.
+//! @return false on failure, e.g. if @c to is open elsewhere.
+//------------------------------------------------------------------------------
+bool replace_file(utf8string const& from, utf8string const& to);
+
+//! Delete @c filename; returns false on failure.
+bool remove_file(utf8string const& filename);
+
+//------------------------------------------------------------------------------
+//! A name for a temporary file beside @c path, unique to the calling thread
+//! of the calling process, e.g. to write a file and replace_file() it into
+//! place.
+//------------------------------------------------------------------------------
+utf8string temp_file_name(utf8string const& path);
+
+//------------------------------------------------------------------------------
+//! Create the directory @c path unless it exists; its parent must exist.
+//! @throw platform::windows_exception on failure.
+//------------------------------------------------------------------------------
+void create_directory(utf8string const& path);
+
+} //namespace bklib
@@ -0,0 +1,36 @@
+#include "pch.hpp"
+#include "mapped_file.hpp"
+
+#include "platform/win/mapped_file.ipp"
+
+bklib::mapped_file::mapped_file(utf8string const& filename)
+    : impl_(std::make_unique<impl_t>(filename))
+    , data_(impl_->data())
+    , size_(impl_->size())
+{
+}
+
+bklib::mapped_file::~mapped_file() {
+}
+
+bklib::mapped_file::mapped_file(mapped_file&& other)
+    : impl_(std::move(other.impl_))
+    , data_(other.data_)
+    , size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+bklib::mapped_file& bklib::mapped_file::operator=(mapped_file&& rhs) {
+    if (this != &rhs) {
+        impl_ = std::move(rhs.impl_);
+        data_ = rhs.data_;
+        size_ = rhs.size_;
+
+        rhs.data_ = nullptr;
+        rhs.size_ = 0;
+    }
+
+    return *this;
+}
@@ -0,0 +1,47 @@
+////////////////////////////////////////////////////////////////////////////////
+//! @file
+//! @author Brandon Kentel
+//! @date   Feb 2013
+//! @brief  Read only memory mapped files.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <memory>
+#include <cstdint>
+
+#include "types.hpp"
+
+namespace bklib {
+//------------------------------------------------------------------------------
+//! A read only view of the entire contents of a file. The pages are served
+//! straight from the system file cache; nothing is read until it is touched.
+//! An empty file can't be mapped; its view has a null data() and a size() of
+//! 0. The OS handles are kept in impl_t, and the view is copied out of it so
+//! data() and size() stay inline. A moved from mapped_file is empty.
+//------------------------------------------------------------------------------
+class mapped_file {
+public:
+    //! Map the file @c filename; throws if it can't be opened or mapped.
+    explicit mapped_file(utf8string const& filename);
+    ~mapped_file();
+
+    mapped_file(mapped_file&& other);
+    mapped_file& operator=(mapped_file&& rhs);
+
+    uint8_t const* data() const { return data_; }
+    size_t         size() const { return size_; }
+
+    uint8_t const* begin() const { return data_; }
+    uint8_t const* end()   const { return data_ + size_; }
+public:
+    struct impl_t;
+private:
+    mapped_file(mapped_file const&); //=delete
+    mapped_file& operator=(mapped_file const&); //=delete
+
+    std::unique_ptr<impl_t> impl_;
+    uint8_t const*          data_;
+    size_t                  size_;
+};
+
+} //namespace bklib
@@ -2,6 +2,26 @@
 #include "CppUnitTest.h"
 
 #include "util/cache.hpp"
+#include "common/spatial_grid.hpp"
+#include "common/math.hpp"
+#include "common/affine.hpp"
+#include "common/region.hpp"
+#include "common/fixed.hpp"
+#include "common/broadphase.hpp"
+#include "common/kd_tree.hpp"
+#include "util/mapped_file.hpp"
+#include "gfx/pixel_convert.hpp"
+#include "gfx/targa.hpp"
+#include "gfx/targa_writer.hpp"
+#include "gfx/asset_loader.hpp"
+#include "gfx/texture_cache.hpp"
+#include "common/skyline_packer.hpp"
+#include "gfx/texture_atlas.hpp"
+#include "gfx/mipmap.hpp"
+#include "gfx/renderer/renderer2d/renderer2d.hpp"
+#include "gfx/renderer/renderer2d/software.hpp"
+#include "gfx/renderer/renderer2d/command_list.hpp"
+#include "gui/gui.hpp"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -191,4 +211,1883 @@ namespace test_suite
 		}*/
 
 	};
+
+	TEST_CLASS(SpatialGridTest) {
+	public:
+        typedef bklib::math::rect<float>              rect_t;
+        typedef bklib::math::spatial_grid<int, float> grid_t;
+
+        static unsigned count_at(grid_t const& grid, float x, float y, int value) {
+            unsigned n = 0;
+            grid.for_each_at(x, y, [&](int v) {
+                if (v == value) ++n;
+            });
+            return n;
+        }
+
+        TEST_METHOD(TestInsertRemove) {
+            grid_t grid(64.0f);
+            rect_t const r(10.0f, 10.0f, 200.0f, 100.0f);
+
+            grid.insert(1, r);
+            Assert::AreEqual(1u, count_at(grid, 10.0f, 10.0f, 1));
+            Assert::AreEqual(1u, count_at(grid, 200.0f, 100.0f, 1));
+            Assert::AreEqual(0u, count_at(grid, 300.0f, 300.0f, 1));
+
+            grid.remove(1, r);
+            Assert::AreEqual(0u, count_at(grid, 10.0f, 10.0f, 1));
+        }
+
+        TEST_METHOD(TestUpdate) {
+            grid_t grid(64.0f);
+            rect_t const a(0.0f, 0.0f, 100.0f, 100.0f);
+            rect_t const b(-300.0f, -300.0f, 20.0f, 50.0f);
+
+            grid.insert(1, a);
+            grid.insert(2, a);
+            grid.update(1, a, b);
+
+            Assert::AreEqual(0u, count_at(grid, 90.0f, 90.0f, 1));
+            Assert::AreEqual(1u, count_at(grid, 90.0f, 90.0f, 2));
+            Assert::AreEqual(1u, count_at(grid, -260.0f, 40.0f, 1));
+            // cells shared by both areas must not be duplicated.
+            Assert::AreEqual(1u, count_at(grid, 10.0f, 10.0f, 1));
+        }
+	};
+
+	TEST_CLASS(GuiHitTest) {
+	public:
+        typedef bklib::gui::rect rect;
+
+        //! Makes the hit-testing of parent_base_t callable.
+        struct test_parent : bklib::gui::parent_base_t {
+            using parent_base_t::find_child_at_;
+            using parent_base_t::bring_to_front_;
+        };
+
+        TEST_METHOD(TestFindChildAt) {
+            test_parent parent;
+
+            auto const a = parent.add_child(std::make_unique<bklib::gui::window>(rect(0.0f, 0.0f, 200.0f, 200.0f)));
+            auto const b = parent.add_child(std::make_unique<bklib::gui::window>(rect(100.0f, 100.0f, 300.0f, 300.0f)));
+
+            auto& wa = parent.get_child(a);
+            auto& wb = parent.get_child(b);
+
+            // the last child added is on top.
+            Assert::IsTrue(parent.find_child_at_(150.0f, 150.0f) == &wb);
+            Assert::IsTrue(parent.find_child_at_(50.0f, 50.0f) == &wa);
+            Assert::IsTrue(parent.find_child_at_(350.0f, 350.0f) == nullptr);
+
+            parent.bring_to_front_(wa);
+            Assert::IsTrue(parent.find_child_at_(150.0f, 150.0f) == &wa);
+            Assert::IsTrue(parent.find_child_at_(250.0f, 250.0f) == &wb);
+
+            // moved into other grid cells: found only where it is now.
+            wa.move_to(400.0f, 400.0f);
+            Assert::IsTrue(parent.find_child_at_(150.0f, 150.0f) == &wb);
+            Assert::IsTrue(parent.find_child_at_(50.0f, 50.0f) == nullptr);
+            Assert::IsTrue(parent.find_child_at_(450.0f, 450.0f) == &wa);
+
+            // grown under the child on top of it.
+            wb.set_bounding_rect(rect(100.0f, 100.0f, 500.0f, 500.0f));
+            Assert::IsTrue(parent.find_child_at_(450.0f, 450.0f) == &wa);
+            Assert::IsTrue(parent.find_child_at_(350.0f, 350.0f) == &wb);
+        }
+
+        TEST_METHOD(TestHoverDamage) {
+            bklib::gui::root root(std::make_shared<bklib::input::ime::manager>());
+
+            // the field is at (10, 10) in the client area, which starts
+            // (BORDER_SIZE, HEADER_SIZE) into the window.
+            auto window = std::make_unique<bklib::gui::window>(rect(0.0f, 0.0f, 200.0f, 200.0f));
+            window->add_child(std::make_unique<bklib::gui::input>(rect(10.0f, 10.0f, 60.0f, 30.0f)));
+            root.add_child(std::move(window));
+
+            // onto the window, away from the field.
+            root.on_mouse_move_to(100, 150);
+            root.take_damage();
+
+            // onto the field: only it is redrawn, grown by a pixel for its border.
+            root.on_mouse_move_to(30, 40);
+            auto const damage = root.take_damage().bounding_rect();
+
+            auto const left = static_cast<float>(bklib::gui::window::BORDER_SIZE) + 10.0f;
+            auto const top  = static_cast<float>(bklib::gui::window::HEADER_SIZE) + 10.0f;
+
+            Assert::AreEqual(left - 1.0f,  damage.left,   0.0f);
+            Assert::AreEqual(top  - 1.0f,  damage.top,    0.0f);
+            Assert::AreEqual(left + 51.0f, damage.right,  0.0f);
+            Assert::AreEqual(top  + 21.0f, damage.bottom, 0.0f);
+        }
+	};
+
+	TEST_CLASS(PointTest) {
+	public:
+        typedef bklib::math::point<int, 3>   point3i;
+        typedef bklib::math::point<float, 4> point4f;
+        typedef bklib::math::point<float, 2> point2f;
+
+        TEST_METHOD(TestArithmetic) {
+            point3i const a(1, 2, 3);
+            point3i const b(4, 5, 6);
+
+            Assert::IsTrue(a + b == point3i(5, 7, 9));
+            Assert::IsTrue(b - a == point3i(3, 3, 3));
+            Assert::IsTrue(a * 2 == 2 * a);
+            Assert::IsTrue(-a == point3i(-1, -2, -3));
+            Assert::AreEqual(32, bklib::math::dot(a, b));
+            Assert::AreEqual(14, bklib::math::length2(a));
+            Assert::AreEqual(27, bklib::math::distance2(a, b));
+        }
+
+        TEST_METHOD(TestMinMaxClamp) {
+            point3i const a(1, 5, 3);
+            point3i const b(4, 2, 6);
+
+            Assert::IsTrue(bklib::math::min(a, b) == point3i(1, 2, 3));
+            Assert::IsTrue(bklib::math::max(a, b) == point3i(4, 5, 6));
+
+            auto const lo = bklib::math::min(a, b);
+            auto const hi = bklib::math::max(a, b);
+            Assert::IsTrue(
+                bklib::math::clamp(point3i(-5, 3, 9), lo, hi) == point3i(1, 3, 6)
+            );
+        }
+
+        //! point<float, 4> uses the SSE overloads when they are available.
+        TEST_METHOD(TestFloat4) {
+            static auto const e = std::numeric_limits<float>::epsilon();
+
+            point4f const a(1.0f, 2.0f, 3.0f, 4.0f);
+            point4f const b(4.0f, 3.0f, 2.0f, 1.0f);
+
+            Assert::IsTrue(a + b == point4f(5.0f, 5.0f, 5.0f, 5.0f));
+            Assert::IsTrue(
+                bklib::math::lerp(a, b, 0.5f) == point4f(2.5f, 2.5f, 2.5f, 2.5f)
+            );
+            Assert::AreEqual(20.0f, bklib::math::dot(a, b), e);
+        }
+
+        TEST_METHOD(TestBatch) {
+            std::vector<point2f> points(5, point2f(1.0f, 1.0f));
+            auto const first = points.data();
+            auto const last  = first + points.size();
+
+            bklib::math::translate(first, last, point2f(1.0f, 2.0f));
+            bklib::math::scale(first, last, 2.0f);
+
+            for (auto const& p : points) {
+                Assert::IsTrue(p == point2f(4.0f, 6.0f));
+            }
+        }
+	};
+
+	TEST_CLASS(AffineTest) {
+	public:
+        typedef bklib::math::affine2<float>  matrix_t;
+        typedef bklib::math::point<float, 2> point_t;
+        typedef bklib::math::rect<float>     rect_t;
+
+        TEST_METHOD(TestCompose) {
+            auto const t = matrix_t::translation(10.0f, 20.0f);
+            auto const s = matrix_t::scaling(2.0f, 3.0f);
+
+            // translate first, then scale.
+            Assert::IsTrue((t * s).apply(point_t(1.0f, 1.0f)) == point_t(22.0f, 63.0f));
+            Assert::IsTrue(matrix_t::identity() * t == t);
+        }
+
+        TEST_METHOD(TestInvert) {
+            static auto const e = 1.0e-4f;
+
+            auto const m = matrix_t::translation(10.0f, 20.0f)
+                         * matrix_t::rotation(0.5f)
+                         * matrix_t::scaling(2.0f, 3.0f);
+
+            auto const p = bklib::math::inverse(m).apply(m.apply(point_t(3.0f, 4.0f)));
+            Assert::AreEqual(3.0f, bklib::math::x(p), e);
+            Assert::AreEqual(4.0f, bklib::math::y(p), e);
+
+            auto singular = matrix_t::scaling(0.0f, 1.0f);
+            Assert::IsFalse(singular.invert());
+        }
+
+        TEST_METHOD(TestBatch) {
+            auto const m = matrix_t::rotation(0.25f) * matrix_t::translation(1.0f, 2.0f);
+
+            point_t const in[] = {
+                point_t(1.0f, 1.0f), point_t(2.0f, 3.0f), point_t(-4.0f, 5.0f)
+            };
+            point_t out[3];
+
+            bklib::math::transform(m, in, out, 3);
+
+            for (size_t i = 0; i < 3; ++i) {
+                auto const expected = m.apply(in[i]);
+                Assert::AreEqual(bklib::math::x(expected), bklib::math::x(out[i]), 1.0e-5f);
+                Assert::AreEqual(bklib::math::y(expected), bklib::math::y(out[i]), 1.0e-5f);
+            }
+
+            rect_t const r(0.0f, 0.0f, 10.0f, 10.0f);
+            rect_t result(0.0f, 0.0f, 0.0f, 0.0f);
+            bklib::math::transform(matrix_t::scaling(-1.0f, 2.0f), &r, &result, 1);
+
+            Assert::AreEqual(-10.0f, result.left);
+            Assert::AreEqual( 20.0f, result.bottom);
+        }
+	};
+
+	TEST_CLASS(RegionTest) {
+	public:
+        typedef bklib::math::region<int> region_t;
+        typedef region_t::rect_t         rect_t;
+
+        TEST_METHOD(TestUnion) {
+            // two overlapping squares -> three bands
+            auto const r = region_t(rect_t(0, 0, 10, 10)) | region_t(rect_t(5, 5, 15, 15));
+
+            Assert::AreEqual(size_t(3), r.size());
+            Assert::AreEqual(175, r.area());
+            Assert::IsTrue(r.contains(12, 12));
+            Assert::IsFalse(r.contains(12, 2));
+            Assert::IsFalse(r.contains(10, 2)); // half open
+
+            auto const bounds = r.bounding_rect();
+            Assert::AreEqual(0,  bounds.left);
+            Assert::AreEqual(15, bounds.bottom);
+        }
+
+        TEST_METHOD(TestCoalesce) {
+            // adjacent halves merge back into a single rect
+            rect_t const rects[] = {
+                rect_t(0, 0, 5, 10), rect_t(5, 0, 10, 10), rect_t(0, 10, 10, 20)
+            };
+
+            region_t const r(std::begin(rects), std::end(rects));
+
+            Assert::AreEqual(size_t(1), r.size());
+            Assert::IsTrue(r == region_t(rect_t(0, 0, 10, 20)));
+        }
+
+        TEST_METHOD(TestIntersectSubtract) {
+            region_t const a(rect_t(0, 0, 10, 10));
+            region_t const b(rect_t(2, 2, 8, 8));
+
+            auto const hole = a - b;
+            Assert::AreEqual(64, hole.area());
+            Assert::IsFalse(hole.contains(5, 5));
+            Assert::IsTrue((hole & b).empty());
+            Assert::IsTrue((hole | b) == a);
+            Assert::IsTrue((a - a).empty());
+        }
+
+        TEST_METHOD(TestTranslate) {
+            auto r = region_t(rect_t(0, 0, 4, 4)) | region_t(rect_t(8, 0, 12, 4));
+            r.translate(-2, 3);
+
+            Assert::IsTrue(r.contains(-2, 3));
+            Assert::IsTrue(r.contains(9, 6));
+            Assert::IsFalse(r.contains(3, 3));
+            Assert::AreEqual(32, r.area());
+        }
+	};
+
+	TEST_CLASS(FixedRectTest) {
+	public:
+        typedef bklib::math::fixed24_8          fixed_t;
+        typedef bklib::math::rect<int32_t>      irect_t;
+        typedef bklib::math::rect<fixed_t>      xrect_t;
+        typedef bklib::math::rect_base::side_x  side_x;
+        typedef bklib::math::rect_base::side_y  side_y;
+
+        TEST_METHOD(TestFixed) {
+            fixed_t const a(1.5f);
+            fixed_t const b(2.25);
+
+            Assert::AreEqual(3.375f, static_cast<float>(a * b));
+            Assert::AreEqual(1.5f,   static_cast<float>(b / a));
+            Assert::AreEqual(-2, fixed_t(-1.5f).floor());
+            Assert::AreEqual(3,  fixed_t(2.5f).round());
+            Assert::IsTrue(fixed_t(3) == fixed_t(3.0f));
+        }
+
+        TEST_METHOD(TestIntersects) {
+            irect_t const r(0, 0, 100, 50);
+
+            Assert::IsTrue(bklib::math::intersects(100, 50, r)); // closed
+            Assert::IsFalse(bklib::math::intersects(-1, 10, r));
+
+            auto const i = bklib::math::intersects_border(98, 2, r, 4);
+            Assert::IsTrue(i.is_inside);
+            Assert::IsTrue(i.x == side_x::right);
+            Assert::IsTrue(i.y == side_y::top);
+
+            xrect_t const xr(0, 0, 100, 50);
+            auto const xi = bklib::math::intersects_border(
+                fixed_t(0.5f), fixed_t(49.75f), xr, fixed_t(1)
+            );
+            Assert::IsTrue(xi.x == side_x::left);
+            Assert::IsTrue(xi.y == side_y::bottom);
+        }
+
+        TEST_METHOD(TestResizeConstrained) {
+            bklib::math::range<int32_t> const constraint(10, 40);
+
+            irect_t r(0, 0, 20, 20);
+            Assert::AreEqual(20, r.resize_constrained(side_x::right, 50, constraint));
+            Assert::AreEqual(40, r.right);
+            Assert::AreEqual(10, r.resize_constrained(side_y::top, -10, constraint));
+            Assert::AreEqual(-10, r.top);
+
+            xrect_t xr(0, 0, 20, 20);
+            xr.resize_constrained(side_x::left, fixed_t(5), bklib::math::range<fixed_t>(10, 40));
+            Assert::IsTrue(xr.left == fixed_t(5));
+        }
+
+        TEST_METHOD(TestRectCast) {
+            auto const r = bklib::math::rect_cast<float>(xrect_t(fixed_t(0.5f), 1, 2, 3));
+            Assert::AreEqual(0.5f, r.left);
+            Assert::AreEqual(3.0f, r.bottom);
+        }
+	};
+
+	TEST_CLASS(BroadphaseTest) {
+	public:
+        typedef bklib::math::broadphase<float> broadphase_t;
+        typedef broadphase_t::rect_t           rect_t;
+        typedef broadphase_t::pair_t           pair_t;
+
+        static bool has_pair(broadphase_t::pair_list_t const& pairs, pair_t const& p) {
+            return std::find(pairs.begin(), pairs.end(), p) != pairs.end();
+        }
+
+        TEST_METHOD(TestPairs) {
+            broadphase_t bp;
+
+            auto const a = bp.insert(rect_t(0.0f,  0.0f,  10.0f, 10.0f));
+            auto const b = bp.insert(rect_t(5.0f,  5.0f,  15.0f, 15.0f));
+            auto const c = bp.insert(rect_t(5.0f,  20.0f, 15.0f, 30.0f)); // overlaps a, b on x only
+            auto const d = bp.insert(rect_t(15.0f, 15.0f, 20.0f, 20.0f)); // touches b and c
+
+            auto const& pairs = bp.find_pairs();
+            Assert::AreEqual(size_t(3), pairs.size());
+            Assert::IsTrue(has_pair(pairs, pair_t(a, b)));
+            Assert::IsTrue(has_pair(pairs, pair_t(b, d)));
+            Assert::IsTrue(has_pair(pairs, pair_t(c, d)));
+        }
+
+        TEST_METHOD(TestUpdate) {
+            broadphase_t bp;
+
+            auto const a = bp.insert(rect_t(0.0f,  0.0f, 10.0f, 10.0f));
+            auto const b = bp.insert(rect_t(20.0f, 0.0f, 30.0f, 10.0f));
+            Assert::IsTrue(bp.find_pairs().empty());
+
+            bp.update(b, rect_t(8.0f, 0.0f, 18.0f, 10.0f));
+            Assert::AreEqual(size_t(1), bp.find_pairs().size());
+
+            bp.remove(a);
+            Assert::IsTrue(bp.find_pairs().empty());
+
+            auto const c = bp.insert(rect_t(0.0f, 0.0f, 10.0f, 10.0f));
+            Assert::AreEqual(a, c); // reused
+            Assert::IsTrue(has_pair(bp.find_pairs(), pair_t(c, b)));
+        }
+	};
+
+	TEST_CLASS(KdTreeTest) {
+	public:
+        typedef bklib::math::point<float, 2>  point_t;
+        typedef bklib::math::kd_tree<point_t> tree_t;
+
+        //! A 10x10 grid of points at integer coordinates; index = y*10 + x.
+        static std::vector<point_t> make_grid() {
+            std::vector<point_t> result;
+            for (int y = 0; y < 10; ++y) {
+                for (int x = 0; x < 10; ++x) {
+                    result.push_back(point_t(static_cast<float>(x), static_cast<float>(y)));
+                }
+            }
+            return result;
+        }
+
+        TEST_METHOD(TestNearest) {
+            auto const points = make_grid();
+            tree_t const tree(points.begin(), points.end());
+
+            auto const r = tree.nearest(point_t(3.2f, 6.9f));
+            Assert::AreEqual(73u, r.index);
+
+            tree_t::result_list_t out;
+            tree.nearest(point_t(5.0f, 5.0f), 5, out);
+
+            Assert::AreEqual(size_t(5), out.size());
+            Assert::AreEqual(55u, out[0].index);
+            Assert::AreEqual(0.0f, out[0].distance2);
+            for (size_t i = 1; i < 5; ++i) {
+                Assert::AreEqual(1.0f, out[i].distance2);
+            }
+
+            tree.nearest(point_t(0.0f, 0.0f), 1000, out);
+            Assert::AreEqual(points.size(), out.size());
+        }
+
+        TEST_METHOD(TestWithin) {
+            auto const points = make_grid();
+            tree_t const tree(points.begin(), points.end());
+
+            tree_t::result_list_t out;
+            tree.within(point_t(0.0f, 0.0f), 1.5f, out);
+
+            // (0,0), (1,0), (0,1), (1,1)
+            Assert::AreEqual(size_t(4), out.size());
+
+            tree.within(point_t(-10.0f, -10.0f), 1.0f, out);
+            Assert::IsTrue(out.empty());
+        }
+	};
+	TEST_CLASS(MappedFileTest) {
+	public:
+        static void write_file(char const* filename, std::vector<uint8_t> const& contents) {
+            std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<char const*>(contents.data()), contents.size());
+        }
+
+        TEST_METHOD(TestContents) {
+            // more than a page.
+            std::vector<uint8_t> contents(10000);
+            for (size_t i = 0; i < contents.size(); ++i) {
+                contents[i] = static_cast<uint8_t>(i * 7);
+            }
+            write_file("test_mapped.bin", contents);
+
+            bklib::mapped_file const file("test_mapped.bin");
+            Assert::AreEqual(contents.size(), file.size());
+            Assert::IsTrue(file.end() == file.data() + file.size());
+            Assert::IsTrue(std::equal(file.begin(), file.end(), contents.begin()));
+        }
+
+        TEST_METHOD(TestEmpty) {
+            write_file("test_mapped_empty.bin", std::vector<uint8_t>());
+
+            bklib::mapped_file const file("test_mapped_empty.bin");
+            Assert::IsTrue(file.data() == nullptr);
+            Assert::AreEqual(size_t(0), file.size());
+            Assert::IsTrue(file.begin() == file.end());
+        }
+
+        TEST_METHOD(TestMissing) {
+            Assert::ExpectException<bklib::platform::platform_exception>([] {
+                bklib::mapped_file const file("test_mapped_missing.bin");
+            });
+        }
+
+        TEST_METHOD(TestMove) {
+            std::vector<uint8_t> const a_contents(3, 'a');
+            std::vector<uint8_t> const b_contents(5, 'b');
+            write_file("test_mapped_a.bin", a_contents);
+            write_file("test_mapped_b.bin", b_contents);
+
+            bklib::mapped_file a("test_mapped_a.bin");
+            auto const view = a.data();
+
+            // the view moves with the handles and the source is left empty.
+            bklib::mapped_file b(std::move(a));
+            Assert::IsTrue(b.data() == view);
+            Assert::AreEqual(size_t(3), b.size());
+            Assert::IsTrue(a.data() == nullptr);
+            Assert::AreEqual(size_t(0), a.size());
+
+            // assigning over a mapped file unmaps what it held.
+            bklib::mapped_file c("test_mapped_b.bin");
+            c = std::move(b);
+            Assert::IsTrue(c.data() == view);
+            Assert::AreEqual(size_t(3), c.size());
+            Assert::IsTrue(b.data() == nullptr);
+            Assert::AreEqual(size_t(0), b.size());
+
+            Assert::IsTrue(std::equal(c.begin(), c.end(), a_contents.begin()));
+        }
+	};
+	TEST_CLASS(PixelConvertTest) {
+	public:
+        // long enough to take both the SIMD and the scalar paths
+        static size_t const COUNT = 67;
+
+        TEST_METHOD(Test24To32) {
+            std::vector<uint8_t> in(COUNT * 3);
+            for (size_t i = 0; i < in.size(); ++i) in[i] = static_cast<uint8_t>(i);
+
+            std::vector<uint8_t> bgra(COUNT * 4), rgba(COUNT * 4), back(COUNT * 3);
+            bklib::gfx::convert<bklib::gfx::bgr8, bklib::gfx::bgra8>(
+                in.data(), in.data() + in.size(), bgra.data(), bgra.data() + bgra.size()
+            );
+            bklib::gfx::convert<bklib::gfx::bgr8, bklib::gfx::rgba8>(
+                in.data(), in.data() + in.size(), rgba.data(), rgba.data() + rgba.size()
+            );
+
+            for (size_t i = 0; i < COUNT; ++i) {
+                Assert::AreEqual(in[i*3 + 0], bgra[i*4 + 0]);
+                Assert::AreEqual(in[i*3 + 2], bgra[i*4 + 2]);
+                Assert::AreEqual(in[i*3 + 0], rgba[i*4 + 2]);
+                Assert::AreEqual(in[i*3 + 2], rgba[i*4 + 0]);
+                Assert::AreEqual(uint8_t(0xFF), bgra[i*4 + 3]);
+            }
+
+            bklib::gfx::convert<bklib::gfx::bgra8, bklib::gfx::bgr8>(
+                bgra.data(), bgra.data() + bgra.size(), back.data(), back.data() + back.size()
+            );
+            Assert::IsTrue(in == back);
+
+            std::vector<uint8_t> swapped(COUNT * 4);
+            bklib::gfx::convert<bklib::gfx::rgba8, bklib::gfx::bgra8>(
+                rgba.data(), rgba.data() + rgba.size(), swapped.data(), swapped.data() + swapped.size()
+            );
+            Assert::IsTrue(swapped == bgra);
+        }
+
+        TEST_METHOD(Test16To32) {
+            // white with alpha, pure red without, pure green with
+            uint16_t const in[] = {0xFFFF, 0x7C00, 0x83E0};
+            uint8_t out[3 * 4];
+
+            bklib::gfx::convert<bklib::gfx::bgr5a1, bklib::gfx::bgra8>(
+                in, in + 3, out, out + 12
+            );
+
+            uint8_t const expected[] = {
+                0xFF, 0xFF, 0xFF, 0xFF,
+                0x00, 0x00, 0xFF, 0x00,
+                0x00, 0xFF, 0x00, 0xFF,
+            };
+
+            for (size_t i = 0; i < 12; ++i) {
+                Assert::AreEqual(expected[i], out[i]);
+            }
+        }
+
+        TEST_METHOD(TestGrayTo32) {
+            std::vector<uint8_t> in(COUNT);
+            for (size_t i = 0; i < in.size(); ++i) in[i] = static_cast<uint8_t>(i * 3);
+
+            std::vector<uint8_t> out(COUNT * 4);
+            bklib::gfx::convert<bklib::gfx::gray8, bklib::gfx::rgba8>(
+                in.data(), in.data() + in.size(), out.data(), out.data() + out.size()
+            );
+
+            for (size_t i = 0; i < COUNT; ++i) {
+                Assert::AreEqual(in[i], out[i*4 + 0]);
+                Assert::AreEqual(in[i], out[i*4 + 1]);
+                Assert::AreEqual(in[i], out[i*4 + 2]);
+                Assert::AreEqual(uint8_t(0xFF), out[i*4 + 3]);
+            }
+        }
+
+        TEST_METHOD(TestPalette) {
+            std::vector<uint32_t> palette(256);
+            for (size_t i = 0; i < palette.size(); ++i) {
+                palette[i] = static_cast<uint32_t>(i * 0x01010101u) ^ 0xFF00FF00u;
+            }
+
+            std::vector<uint8_t> in(COUNT);
+            for (size_t i = 0; i < in.size(); ++i) in[i] = static_cast<uint8_t>(i * 7);
+
+            std::vector<uint32_t> out(COUNT);
+            bklib::gfx::expand_palette(
+                in.data(), in.data() + in.size(), out.data(), out.data() + out.size(), palette.data()
+            );
+
+            for (size_t i = 0; i < COUNT; ++i) {
+                Assert::AreEqual(palette[in[i]], out[i]);
+            }
+        }
+	};
+	TEST_CLASS(TargaTest) {
+	public:
+        typedef bklib::tga::byte byte;
+
+        //! Write a Targa file of @c payload without an id; the color map, if
+        //! any, holds @c map_entry_size bit entries starting at @c map_first.
+        static void write_targa(
+            char const* filename, bklib::tga::image_type type,
+            unsigned width, unsigned height, unsigned depth, bool top_down,
+            std::vector<byte> const& payload,
+            std::vector<byte> const& map = std::vector<byte>(),
+            unsigned map_first = 0, unsigned map_entry_size = 0
+        ) {
+            bklib::tga::header header = {};
+            header.image_type                = type;
+            header.image_spec.width          = static_cast<uint16_t>(width);
+            header.image_spec.height         = static_cast<uint16_t>(height);
+            header.image_spec.depth          = static_cast<byte>(depth);
+            header.image_spec.descriptor.top = top_down ? 1 : 0;
+
+            if (!map.empty()) {
+                header.color_map_type                   = bklib::tga::color_map_type::present;
+                header.color_map_spec.first_entry_index = static_cast<uint16_t>(map_first);
+                header.color_map_spec.length            = static_cast<uint16_t>(map.size() * 8 / map_entry_size);
+                header.color_map_spec.entry_size        = static_cast<byte>(map_entry_size);
+            }
+
+            std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            out.write(reinterpret_cast<char const*>(map.data()), map.size());
+            out.write(reinterpret_cast<char const*>(payload.data()), payload.size());
+        }
+
+        TEST_METHOD(TestDecodeRle) {
+            // a run of 4 and a raw packet of 2; rows of 3 pixels.
+            byte const runs[] = {0x83, 7, 0x01, 1, 2};
+            // a raw packet of 4 and a run of 2.
+            byte const raws[] = {0x03, 1, 2, 3, 4, 0x81, 9};
+
+            byte const expect_runs[] = {7, 7, 7, 7, 1, 2};
+            byte const expect_raws[] = {1, 2, 3, 4, 9, 9};
+
+            byte out[6];
+            auto const end = bklib::tga::decode_rle(runs, runs + sizeof(runs), out, sizeof(out), 1);
+            Assert::IsTrue(end == runs + sizeof(runs));
+            Assert::IsTrue(std::equal(out, out + 6, expect_runs));
+
+            bklib::tga::decode_rle(raws, raws + sizeof(raws), out, sizeof(out), 1);
+            Assert::IsTrue(std::equal(out, out + 6, expect_raws));
+
+            // a row at a time, so that each first packet spans the rows.
+            bklib::tga::rle_decoder by_row(runs, runs + sizeof(runs), 1);
+            by_row.decode(out, 3);
+            Assert::IsTrue(by_row.in_packet());
+            by_row.decode(out + 3, 3);
+            Assert::IsFalse(by_row.in_packet());
+            Assert::IsTrue(std::equal(out, out + 6, expect_runs));
+
+            bklib::tga::rle_decoder raw_by_row(raws, raws + sizeof(raws), 1);
+            raw_by_row.decode(out, 3);
+            Assert::IsTrue(raw_by_row.in_packet());
+            raw_by_row.decode(out + 3, 3);
+            Assert::IsTrue(std::equal(out, out + 6, expect_raws));
+
+            // wider pixels; a run of 3 spanning rows of 2.
+            byte const wide[] = {0x82, 1, 2, 3, 0x00, 4, 5, 6};
+            byte const expect_wide[] = {1, 2, 3, 1, 2, 3, 1, 2, 3, 4, 5, 6};
+            byte wide_out[12];
+
+            bklib::tga::rle_decoder wide_by_row(wide, wide + sizeof(wide), 3);
+            wide_by_row.decode(wide_out, 2);
+            wide_by_row.decode(wide_out + 6, 2);
+            Assert::IsTrue(std::equal(wide_out, wide_out + 12, expect_wide));
+        }
+
+        TEST_METHOD(TestDecodeRleCorrupt) {
+            typedef bklib::tga::targa_exception targa_exception;
+
+            byte out[6];
+
+            // a run missing its pixel, a raw packet missing pixels, and data
+            // that ends before the image does.
+            byte const no_pixel[]  = {0x83};
+            byte const short_raw[] = {0x05, 1, 2, 3};
+            byte const too_few[]   = {0x81, 7};
+
+            Assert::ExpectException<targa_exception>([&] {
+                bklib::tga::decode_rle(no_pixel, no_pixel + sizeof(no_pixel), out, sizeof(out), 1);
+            });
+            Assert::ExpectException<targa_exception>([&] {
+                bklib::tga::decode_rle(short_raw, short_raw + sizeof(short_raw), out, sizeof(out), 1);
+            });
+            Assert::ExpectException<targa_exception>([&] {
+                bklib::tga::decode_rle(too_few, too_few + sizeof(too_few), out, sizeof(out), 1);
+            });
+
+            // packets that run past the end of the image.
+            byte const long_run[] = {0x87, 7};
+            byte const long_raw[] = {0x06, 1, 2, 3, 4, 5, 6, 7};
+
+            Assert::ExpectException<targa_exception>([&] {
+                bklib::tga::decode_rle(long_run, long_run + sizeof(long_run), out, sizeof(out), 1);
+            });
+            Assert::ExpectException<targa_exception>([&] {
+                bklib::tga::decode_rle(long_raw, long_raw + sizeof(long_raw), out, sizeof(out), 1);
+            });
+        }
+
+        TEST_METHOD(TestDecodeBands) {
+            // over the 1 << 18 bytes below which decode() stays on one thread,
+            // stored bottom up, in packets of 100 pixels that span rows and
+            // bands.
+            unsigned const w = 641, h = 480;
+            size_t const count = w * h;
+
+            std::vector<byte> pixels(count * 3);
+            std::vector<byte> packets;
+
+            for (size_t first = 0; first < count; first += 100) {
+                auto const n  = (std::min)(count - first, size_t(100));
+                auto const id = first / 100;
+
+                for (size_t i = first; i < first + n; ++i) {
+                    pixels[i*3 + 0] = static_cast<byte>(id % 2 ? i : id);
+                    pixels[i*3 + 1] = static_cast<byte>(id % 2 ? i >> 8 : id * 7);
+                    pixels[i*3 + 2] = static_cast<byte>(id);
+                }
+
+                if (id % 2) {
+                    packets.push_back(static_cast<byte>(n - 1));
+                    packets.insert(packets.end(), &pixels[first*3], &pixels[first*3] + n*3);
+                } else {
+                    packets.push_back(static_cast<byte>(0x80 | (n - 1)));
+                    packets.insert(packets.end(), &pixels[first*3], &pixels[first*3] + 3);
+                }
+            }
+
+            // a single thread decode, flipped.
+            std::vector<byte> decoded(count * 3);
+            bklib::tga::decode_rle(packets.data(), packets.data() + packets.size(), decoded.data(), decoded.size(), 3);
+            Assert::IsTrue(decoded == pixels);
+
+            std::vector<byte> expected(count * 4);
+            for (unsigned y = 0; y < h; ++y) {
+                auto const in  = &decoded[(h - 1 - y) * w * 3];
+                auto const out = &expected[y * w * 4];
+
+                bklib::gfx::convert<bklib::gfx::bgr8, bklib::gfx::bgra8>(
+                    in, in + w * 3, out, out + w * 4
+                );
+            }
+
+            write_targa("test_bands.tga", bklib::tga::image_type::true_color, w, h, 24, false, pixels);
+            write_targa("test_bands_rle.tga", bklib::tga::image_type::rle_true_color, w, h, 24, false, packets);
+
+            char const* const names[] = {"test_bands.tga", "test_bands_rle.tga"};
+
+            for (auto name : names) {
+                bklib::tga::image const image(name);
+
+                std::vector<byte> out(count * 4);
+                image.decode(out.data(), w * 4, bklib::gfx::pixel_format::bgra8);
+                Assert::IsTrue(out == expected);
+            }
+        }
+
+        TEST_METHOD(TestColorMapped) {
+            // entries 5 to 7; 0, 8 and 255 are out of the map.
+            byte const index_data[] = {5, 6, 7, 0, 8, 255};
+
+            byte const map24_data[] = {
+                10, 20, 30,  11, 21, 31,  12, 22, 32,
+            };
+            byte const map32_data[] = {
+                10, 20, 30, 40,  11, 21, 31, 41,  12, 22, 32, 42,
+            };
+
+            std::vector<byte> const indices(std::begin(index_data), std::end(index_data));
+            std::vector<byte> const map24(std::begin(map24_data), std::end(map24_data));
+            std::vector<byte> const map32(std::begin(map32_data), std::end(map32_data));
+
+            uint32_t const expect24[] = {
+                0xFF1E140A, 0xFF1F150B, 0xFF20160C, 0, 0, 0,
+            };
+            uint32_t const expect32[] = {
+                0x281E140A, 0x291F150B, 0x2A20160C, 0, 0, 0,
+            };
+
+            write_targa("test_mapped24.tga", bklib::tga::image_type::color_mapped, 3, 2, 8, true, indices, map24, 5, 24);
+            write_targa("test_mapped32.tga", bklib::tga::image_type::color_mapped, 3, 2, 8, true, indices, map32, 5, 32);
+
+            auto const check = [&](char const* filename, uint32_t const* expected) {
+                bklib::tga::image const image(filename);
+                Assert::IsTrue(image.is_color_mapped());
+                Assert::IsTrue(image.format() == bklib::gfx::pixel_format::index8);
+
+                // the indices themselves.
+                byte index[6];
+                image.decode(index, 3, bklib::gfx::pixel_format::index8);
+                Assert::IsTrue(std::equal(index, index + 6, indices.begin()));
+
+                // expanded, in both channel orders.
+                uint32_t bgra[6], rgba[6];
+                image.decode(bgra, 3 * 4, bklib::gfx::pixel_format::bgra8);
+                image.decode(rgba, 3 * 4, bklib::gfx::pixel_format::rgba8);
+
+                for (size_t i = 0; i < 6; ++i) {
+                    auto const swapped = (expected[i] & 0xFF00FF00)
+                        | ((expected[i] & 0xFF) << 16) | ((expected[i] >> 16) & 0xFF);
+
+                    Assert::AreEqual(expected[i], bgra[i]);
+                    Assert::AreEqual(swapped, rgba[i]);
+                }
+            };
+
+            check("test_mapped24.tga", expect24);
+            check("test_mapped32.tga", expect32);
+        }
+	};
+	TEST_CLASS(TargaWriterTest) {
+	public:
+        typedef bklib::tga::byte byte;
+        typedef bklib::gfx::pixel_format pixel_format;
+
+        //----------------------------------------------------------------------
+        //! Rows of runs and literals longer than the 128 pixel packet limit,
+        //! and runs of 5 that end part way through the 4 to 16 pixels compared
+        //! at once.
+        //----------------------------------------------------------------------
+        static std::vector<byte> make_pixels(unsigned w, unsigned h, unsigned bpp) {
+            std::vector<byte> result(w * h * bpp);
+
+            for (unsigned y = 0; y < h; ++y) {
+                for (unsigned x = 0; x < w; ++x) {
+                    auto const row = y % 3;
+                    auto const is_run =
+                        row == 0 ? x < 200 :
+                        row == 1 ? x >= 150 :
+                                   true;
+                    auto const v = is_run ? (row == 2 ? x / 5 : y) : x * 37 + y;
+
+                    for (unsigned c = 0; c < bpp; ++c) {
+                        result[(y * w + x) * bpp + c] = static_cast<byte>(v + c * 11);
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        TEST_METHOD(TestEncodeRle) {
+            unsigned const w = 300;
+
+            for (unsigned bpp = 1; bpp <= 4; ++bpp) {
+                auto const pixels = make_pixels(w, 3, bpp);
+
+                std::vector<byte> packets(bklib::tga::max_rle_size(w * 3, bpp));
+                std::vector<byte> decoded(pixels.size());
+
+                auto out = packets.data();
+                for (unsigned y = 0; y < 3; ++y) {
+                    out = bklib::tga::encode_rle(&pixels[y * w * bpp], w, bpp, out);
+                }
+
+                // rows of three runs or fewer compress.
+                Assert::IsTrue(static_cast<size_t>(out - packets.data()) < pixels.size());
+
+                auto const end = bklib::tga::decode_rle(packets.data(), out, decoded.data(), decoded.size(), bpp);
+                Assert::IsTrue(end == out);
+                Assert::IsTrue(decoded == pixels);
+            }
+        }
+
+        TEST_METHOD(TestWriteRoundTrip) {
+            unsigned const w = 300, h = 4;
+
+            pixel_format const formats[] = {
+                pixel_format::gray8, pixel_format::bgr5a1, pixel_format::bgr8, pixel_format::bgra8,
+            };
+
+            for (auto format : formats) {
+                for (int mode = 0; mode < 4; ++mode) {
+                    auto const rle      = (mode & 1) != 0;
+                    auto const top_down = (mode & 2) != 0;
+                    auto const bpp      = static_cast<unsigned>(bklib::gfx::bytes_per_pixel(format));
+                    auto const pixels   = make_pixels(w, h, bpp);
+
+                    bklib::tga::write("test_write.tga", pixels.data(), w, h, w * bpp, format, rle, top_down);
+
+                    bklib::tga::image const image("test_write.tga");
+                    Assert::IsTrue(image.format() == format);
+                    Assert::AreEqual(rle, image.is_rle());
+                    Assert::AreEqual(top_down, image.is_top_down());
+                    Assert::AreEqual(w, image.width());
+                    Assert::AreEqual(h, image.height());
+
+                    std::vector<byte> out(pixels.size());
+                    image.decode(out.data(), w * bpp, format);
+                    Assert::IsTrue(out == pixels);
+                }
+            }
+        }
+
+        TEST_METHOD(TestFrameWriter) {
+            unsigned const w = 300, h = 4;
+            auto const pixels = make_pixels(w, h, 4);
+
+            bklib::tga::frame_writer writer;
+
+            auto buffer = writer.acquire(pixels.size());
+            Assert::AreEqual(pixels.size(), buffer.size());
+            std::copy(pixels.begin(), pixels.end(), buffer.begin());
+
+            auto const storage = buffer.data();
+            writer.write("test_frame.tga", std::move(buffer), w, h, pixel_format::bgra8);
+            writer.wait();
+
+            bklib::tga::image const image("test_frame.tga");
+            Assert::IsTrue(image.is_rle());
+
+            std::vector<byte> out(pixels.size());
+            image.decode(out.data(), w * 4, pixel_format::bgra8);
+            Assert::IsTrue(out == pixels);
+
+            // the buffer comes back once written.
+            Assert::IsTrue(writer.acquire(pixels.size()).data() == storage);
+
+            // failures surface from the next wait, and only that one.
+            writer.write("test_no_such_dir/test_frame.tga", writer.acquire(pixels.size()), w, h, pixel_format::bgra8);
+            writer.write("test_frame.tga", writer.acquire(pixels.size()), w, h, pixel_format::index8);
+
+            Assert::ExpectException<bklib::tga::targa_exception>([&] { writer.wait(); });
+            writer.wait();
+        }
+	};
+	TEST_CLASS(TileGridTest) {
+	public:
+        typedef bklib::tga::byte byte;
+        typedef bklib::tga::rect_t rect_t;
+
+        TEST_METHOD(TestDecodeRegion) {
+            // neither a multiple of the tiles nor of the rle row index.
+            unsigned const w = 70, h = 37;
+            auto const pixels = TargaWriterTest::make_pixels(w, h, 3);
+
+            for (int mode = 0; mode < 4; ++mode) {
+                auto const rle      = (mode & 1) != 0;
+                auto const top_down = (mode & 2) != 0;
+
+                // the rows in file order, packed or run length encoded.
+                std::vector<byte> payload;
+                for (unsigned i = 0; i < h; ++i) {
+                    auto const row = &pixels[(top_down ? i : h - 1 - i) * w * 3];
+
+                    if (rle) {
+                        auto const size = payload.size();
+                        payload.resize(size + bklib::tga::max_rle_size(w, 3));
+
+                        auto const end = bklib::tga::encode_rle(row, w, 3, &payload[size]);
+                        payload.resize(static_cast<size_t>(end - payload.data()));
+                    } else {
+                        payload.insert(payload.end(), row, row + w * 3);
+                    }
+                }
+
+                TargaTest::write_targa("test_region.tga",
+                    rle ? bklib::tga::image_type::rle_true_color : bklib::tga::image_type::true_color,
+                    w, h, 24, top_down, payload
+                );
+
+                bklib::tga::image const image("test_region.tga");
+
+                std::vector<uint32_t> full(w * h);
+                image.decode(full.data(), w * 4, bklib::gfx::pixel_format::bgra8);
+
+                bklib::tga::tile_grid const grid(image, 16, 16);
+                Assert::AreEqual(5u, grid.columns());
+                Assert::AreEqual(3u, grid.rows());
+
+                unsigned tiles = 0;
+                for (auto const& t : grid) {
+                    auto const tw = static_cast<unsigned>(t.bounds.width());
+                    auto const th = static_cast<unsigned>(t.bounds.height());
+
+                    // the right and bottom edges are cut short.
+                    Assert::AreEqual(t.column == 4 ? 6u : 16u, tw);
+                    Assert::AreEqual(t.row    == 2 ? 5u : 16u, th);
+
+                    std::vector<uint32_t> tile(tw * th);
+                    grid.decode(t, tile.data(), tw * 4, bklib::gfx::pixel_format::bgra8);
+
+                    for (unsigned y = 0; y < th; ++y) {
+                        auto const expected = &full[(t.bounds.top + y) * w + t.bounds.left];
+                        Assert::IsTrue(std::equal(expected, expected + tw, &tile[y * tw]));
+                    }
+
+                    ++tiles;
+                }
+                Assert::AreEqual(15u, tiles);
+
+                // a region across tiles, into a buffer filled bottom up.
+                rect_t const region(10, 12, 61, 35);
+                auto const rw = static_cast<unsigned>(region.width());
+                auto const rh = static_cast<unsigned>(region.height());
+
+                std::vector<uint32_t> out(rw * rh);
+                image.decode_region(region, &out[(rh - 1) * rw], -static_cast<ptrdiff_t>(rw * 4),
+                    bklib::gfx::pixel_format::bgra8
+                );
+
+                for (unsigned y = 0; y < rh; ++y) {
+                    auto const expected = &full[(region.top + y) * w + region.left];
+                    Assert::IsTrue(std::equal(expected, expected + rw, &out[(rh - 1 - y) * rw]));
+                }
+
+                Assert::ExpectException<bklib::tga::targa_exception>([&] {
+                    image.decode_region(rect_t(60, 30, 71, 37), out.data(), rw * 4, bklib::gfx::pixel_format::bgra8);
+                });
+            }
+        }
+
+        TEST_METHOD(TestTilesIn) {
+            std::vector<byte> const pixels(70 * 37);
+            bklib::tga::write("test_tiles.tga", pixels.data(), 70, 37, 70, bklib::gfx::pixel_format::gray8);
+
+            bklib::tga::image const image("test_tiles.tga");
+            bklib::tga::tile_grid const grid(image, 16, 16);
+
+            // clipped to the image: columns 3 to 4 of rows 1 to 2.
+            std::vector<std::pair<unsigned, unsigned>> found;
+            for (auto const& t : grid.tiles_in(rect_t(50, 20, 100, 100))) {
+                found.push_back(std::make_pair(t.column, t.row));
+            }
+
+            std::pair<unsigned, unsigned> const clipped[] = {
+                std::make_pair(3u, 1u), std::make_pair(4u, 1u),
+                std::make_pair(3u, 2u), std::make_pair(4u, 2u),
+            };
+            std::vector<std::pair<unsigned, unsigned>> const expected(std::begin(clipped), std::end(clipped));
+            Assert::IsTrue(found == expected);
+
+            // outside the image.
+            auto const none = grid.tiles_in(rect_t(80, 0, 90, 10));
+            Assert::IsTrue(none.begin() == none.end());
+        }
+	};
+	TEST_CLASS(AssetLoaderTest) {
+	public:
+        typedef bklib::gfx::asset_loader asset_loader;
+
+        TEST_METHOD(TestLoad) {
+            // 2x2 bgr8, top down.
+            uint8_t const rows[] = {
+                1, 2, 3,  4, 5, 6,
+                7, 8, 9,  10, 11, 12,
+            };
+            std::vector<uint8_t> const pixels(std::begin(rows), std::end(rows));
+            TargaTest::write_targa("test_loader.tga", bklib::tga::image_type::true_color, 2, 2, 24, true, pixels);
+
+            asset_loader loader(2);
+
+            int loaded = 0;
+            auto const on_loaded = [&](asset_loader::image_future const& f) {
+                Assert::AreEqual(2u, f.get()->width);
+                ++loaded;
+            };
+
+            // the same path is loaded once.
+            auto const a = loader.load_image("test_loader.tga", on_loaded);
+            auto const b = loader.load_image("test_loader.tga", on_loaded);
+            Assert::IsTrue(a.get() == b.get());
+
+            auto const image = a.get();
+            Assert::AreEqual(2u, image->height);
+            auto const bgra = static_cast<uint8_t const*>(image->pixels);
+            Assert::AreEqual(uint8_t(4), bgra[4]);
+            Assert::AreEqual(uint8_t(12), bgra[14]);
+            Assert::AreEqual(uint8_t(0xFF), bgra[15]);
+
+            // handlers only run from dispatch_completions, on this thread.
+            Assert::AreEqual(0, loaded);
+            for (size_t n = 0; n < 2; ) {
+                n += loader.dispatch_completions();
+                std::this_thread::yield();
+            }
+            Assert::AreEqual(2, loaded);
+
+            // once loaded, a handler is queued straight away.
+            auto const c = loader.load_image("test_loader.tga", on_loaded);
+            Assert::IsTrue(c.get() == image);
+            Assert::AreEqual(size_t(1), loader.dispatch_completions());
+            Assert::AreEqual(3, loaded);
+
+            // forgotten paths load again.
+            loader.forget("test_loader.tga");
+            auto const d = loader.load_image("test_loader.tga");
+            Assert::IsTrue(d.get() != image);
+            Assert::IsTrue(d.get()->width == 2);
+
+            // failures surface through the future.
+            auto const e = loader.load_image("test_loader_missing.tga");
+            Assert::ExpectException<std::exception>([&] { e.get(); });
+        }
+
+        TEST_METHOD(TestDestroyWhileLoading) {
+            std::vector<asset_loader::image_future> futures;
+            int loaded = 0;
+
+            {
+                asset_loader loader(1);
+                for (int i = 0; i < 32; ++i) {
+                    futures.push_back(loader.load_image(
+                        "test_loader_missing" + std::to_string(static_cast<long long>(i)) + ".tga",
+                        [&](asset_loader::image_future const&) { ++loaded; }
+                    ));
+                }
+            }
+
+            // finished or abandoned; either way nobody is left waiting.
+            for (auto const& f : futures) {
+                Assert::IsTrue(f.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+                Assert::ExpectException<std::exception>([&] { f.get(); });
+            }
+
+            Assert::AreEqual(0, loaded);
+        }
+	};
+	TEST_CLASS(TextureCacheTest) {
+	public:
+        typedef bklib::gfx::texture_cache texture_cache;
+
+        //! A w x h bgra8 source; the pixels depend on @c seed.
+        static std::vector<uint8_t> write_source(char const* filename, unsigned w, unsigned h, unsigned seed) {
+            std::vector<uint8_t> pixels(w * h * 4);
+            for (size_t i = 0; i < pixels.size(); ++i) {
+                pixels[i] = static_cast<uint8_t>(i * 13 + seed);
+            }
+
+            bklib::tga::write(filename, pixels.data(), w, h, w * 4, bklib::gfx::pixel_format::bgra8);
+
+            return pixels;
+        }
+
+        static std::vector<uint8_t> read_file(bklib::utf8string const& filename) {
+            bklib::mapped_file const file(filename);
+            return std::vector<uint8_t>(file.begin(), file.end());
+        }
+
+        static bool has_pixels(texture_cache::texture_ptr const& tex, std::vector<uint8_t> const& pixels) {
+            return tex->size() == pixels.size()
+                && std::memcmp(tex->pixels(), pixels.data(), pixels.size()) == 0;
+        }
+
+        TEST_METHOD(TestColdWarm) {
+            texture_cache const cache("test_cache");
+            auto const pixels = write_source("test_cache_a.tga", 4, 4, 1);
+            auto const entry  = cache.entry_path("test_cache_a.tga");
+            bklib::remove_file(entry);
+
+            // a cold load converts and writes the entry.
+            auto cold = cache.load("test_cache_a.tga");
+            Assert::IsFalse(cold->is_mapped());
+            Assert::IsTrue(has_pixels(cold, pixels));
+
+            bklib::file_stamp stamp;
+            Assert::IsTrue(bklib::get_file_stamp(entry, stamp));
+            Assert::IsTrue(stamp.size >= texture_cache::ALIGNMENT + pixels.size());
+
+            // a warm load maps it, aligned.
+            auto const warm = cache.load("test_cache_a.tga");
+            Assert::IsTrue(warm->is_mapped());
+            Assert::AreEqual(4u, warm->width());
+            Assert::AreEqual(4u, warm->height());
+            Assert::AreEqual(0u, warm->mip_levels());
+            Assert::IsTrue(warm->mips() == nullptr);
+            Assert::AreEqual(size_t(0), reinterpret_cast<uintptr_t>(warm->pixels()) % texture_cache::ALIGNMENT);
+            Assert::IsTrue(has_pixels(warm, pixels));
+        }
+
+        TEST_METHOD(TestSourceChanged) {
+            texture_cache const cache("test_cache");
+            write_source("test_cache_b.tga", 4, 4, 2);
+            bklib::remove_file(cache.entry_path("test_cache_b.tga"));
+            cache.load("test_cache_b.tga");
+
+            // a different size is a different image.
+            auto const pixels = write_source("test_cache_b.tga", 4, 2, 3);
+
+            auto const tex = cache.load("test_cache_b.tga");
+            Assert::IsFalse(tex->is_mapped());
+            Assert::AreEqual(2u, tex->height());
+            Assert::IsTrue(has_pixels(tex, pixels));
+
+            Assert::IsTrue(cache.load("test_cache_b.tga")->is_mapped());
+        }
+
+        TEST_METHOD(TestSourceTouched) {
+            texture_cache const cache("test_cache");
+            auto const pixels = write_source("test_cache_c.tga", 4, 4, 4);
+            bklib::remove_file(cache.entry_path("test_cache_c.tga"));
+            cache.load("test_cache_c.tga");
+
+            bklib::file_stamp before;
+            Assert::IsTrue(bklib::get_file_stamp("test_cache_c.tga", before));
+
+            // the same contents, written again later.
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            write_source("test_cache_c.tga", 4, 4, 4);
+
+            bklib::file_stamp after;
+            Assert::IsTrue(bklib::get_file_stamp("test_cache_c.tga", after));
+            Assert::IsTrue(before.write_time != after.write_time);
+
+            auto tex = cache.load("test_cache_c.tga");
+            Assert::IsTrue(tex->is_mapped());
+            Assert::IsTrue(has_pixels(tex, pixels));
+
+            // and again, now the entry has the new time.
+            tex.reset();
+            tex = cache.load("test_cache_c.tga");
+            Assert::IsTrue(tex->is_mapped());
+            Assert::IsTrue(has_pixels(tex, pixels));
+        }
+
+        TEST_METHOD(TestBadEntry) {
+            texture_cache const cache("test_cache");
+            auto const pixels = write_source("test_cache_d.tga", 4, 4, 5);
+            auto const entry  = cache.entry_path("test_cache_d.tga");
+            bklib::remove_file(entry);
+            cache.load("test_cache_d.tga");
+
+            auto const good = read_file(entry);
+
+            // part of a header, the header without all of the pixels, and a
+            // bad magic number.
+            std::vector<uint8_t> bad[3];
+            bad[0].assign(good.begin(), good.begin() + 16);
+            bad[1].assign(good.begin(), good.begin() + texture_cache::ALIGNMENT + 8);
+            bad[2] = good;
+            bad[2][0] ^= 0xFF;
+
+            for (auto const& contents : bad) {
+                MappedFileTest::write_file(entry.c_str(), contents);
+
+                auto tex = cache.load("test_cache_d.tga");
+                Assert::IsFalse(tex->is_mapped());
+                Assert::IsTrue(has_pixels(tex, pixels));
+
+                // rebuilt.
+                tex = cache.load("test_cache_d.tga");
+                Assert::IsTrue(tex->is_mapped());
+                Assert::IsTrue(has_pixels(tex, pixels));
+            }
+        }
+
+        TEST_METHOD(TestSettingsChanged) {
+            texture_cache const plain("test_cache");
+            texture_cache const mipped("test_cache", true);
+
+            auto const pixels = write_source("test_cache_e.tga", 4, 4, 6);
+            bklib::remove_file(plain.entry_path("test_cache_e.tga"));
+            plain.load("test_cache_e.tga");
+
+            // an entry without mipmaps doesn't do for a cache that wants them.
+            auto tex = mipped.load("test_cache_e.tga");
+            Assert::IsFalse(tex->is_mapped());
+            Assert::AreEqual(bklib::gfx::mip_levels(4, 4), tex->mip_levels());
+
+            tex = mipped.load("test_cache_e.tga");
+            Assert::IsTrue(tex->is_mapped());
+            Assert::AreEqual(bklib::gfx::mip_levels(4, 4), tex->mip_levels());
+            Assert::IsTrue(tex->mips() != nullptr);
+            Assert::IsTrue(has_pixels(tex, pixels));
+
+            // nor the other way around.
+            tex = plain.load("test_cache_e.tga");
+            Assert::IsFalse(tex->is_mapped());
+            Assert::AreEqual(0u, tex->mip_levels());
+        }
+	};
+	TEST_CLASS(SkylinePackerTest) {
+	public:
+        typedef bklib::math::skyline_packer packer_t;
+        typedef packer_t::rect_t            rect_t;
+
+        static void check(rect_t const& r, int32_t left, int32_t top, int32_t right, int32_t bottom) {
+            Assert::AreEqual(left,   r.left);
+            Assert::AreEqual(top,    r.top);
+            Assert::AreEqual(right,  r.right);
+            Assert::AreEqual(bottom, r.bottom);
+        }
+
+        TEST_METHOD(TestBottomLeft) {
+            packer_t packer(10, 10);
+            rect_t r(0, 0, 0, 0);
+
+            Assert::IsTrue(packer.insert(4, 3, r));
+            check(r, 0, 0, 4, 3);
+
+            Assert::IsTrue(packer.insert(6, 2, r));
+            check(r, 4, 0, 10, 2);
+
+            // lowest spot is on the second rect
+            Assert::IsTrue(packer.insert(6, 5, r));
+            check(r, 4, 2, 10, 7);
+
+            Assert::AreEqual(int64_t(12 + 12 + 30), packer.used_area());
+        }
+
+        TEST_METHOD(TestFull) {
+            packer_t packer(8, 8);
+            rect_t r(0, 0, 0, 0);
+
+            for (int i = 0; i < 4; ++i) {
+                Assert::IsTrue(packer.insert(4, 4, r));
+            }
+
+            Assert::IsFalse(packer.insert(1, 1, r));
+            Assert::IsFalse(packer_t(8, 8).insert(9, 1, r));
+
+            packer.clear();
+            Assert::IsTrue(packer.insert(8, 8, r));
+        }
+	};
+
+	TEST_CLASS(TextureAtlasTest) {
+	public:
+        typedef bklib::gfx::texture_atlas atlas_t;
+        typedef atlas_t::location         location;
+
+        //! Insert a w x h image of one color.
+        static atlas_t::id_t insert(atlas_t& atlas, unsigned w, unsigned h, uint32_t color) {
+            std::vector<uint32_t> const pixels(w * h, color);
+            return atlas.insert(w, h, pixels.data(), w * 4);
+        }
+
+        static uint32_t texel(atlas_t const& atlas, unsigned page, int32_t x, int32_t y) {
+            auto const& p = atlas.pages()[page];
+
+            uint32_t result;
+            std::memcpy(&result, &p.pixels[(y * p.width + x) * 4], sizeof(result));
+            return result;
+        }
+
+        //! Is all of @c where the color @c color?
+        static bool is_filled(atlas_t const& atlas, location const& where, uint32_t color) {
+            for (auto y = where.rect.top; y < where.rect.bottom; ++y) {
+                for (auto x = where.rect.left; x < where.rect.right; ++x) {
+                    if (texel(atlas, where.page, x, y) != color) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        TEST_METHOD(TestPadding) {
+            atlas_t atlas(16, 16, 2);
+
+            auto const a = insert(atlas, 4, 4, 0xFF0000FFu);
+            auto const b = insert(atlas, 4, 4, 0xFF00FF00u);
+
+            auto const ra = atlas.get(a).rect;
+            auto const rb = atlas.get(b).rect;
+            Assert::AreEqual(4, ra.width());
+            Assert::AreEqual(4, rb.height());
+            Assert::IsTrue(is_filled(atlas, atlas.get(a), 0xFF0000FFu));
+            Assert::IsTrue(is_filled(atlas, atlas.get(b), 0xFF00FF00u));
+
+            // the gutter right of and below each image is left clear.
+            for (int32_t i = 0; i < 2; ++i) {
+                for (int32_t j = 0; j < 4; ++j) {
+                    Assert::AreEqual(0u, texel(atlas, 0, ra.right + i, ra.top + j));
+                    Assert::AreEqual(0u, texel(atlas, 0, ra.left + j, ra.bottom + i));
+                    Assert::AreEqual(0u, texel(atlas, 0, rb.right + i, rb.top + j));
+                    Assert::AreEqual(0u, texel(atlas, 0, rb.left + j, rb.bottom + i));
+                }
+            }
+
+            // and so the images are at least a gutter apart.
+            Assert::IsTrue(
+                ra.right + 2 <= rb.left || rb.right + 2 <= ra.left ||
+                ra.bottom + 2 <= rb.top || rb.bottom + 2 <= ra.top
+            );
+
+            // nothing larger than a page, less the gutter.
+            Assert::ExpectException<bklib::gfx::atlas_exception>([&] {
+                insert(atlas, 15, 4, 0);
+            });
+        }
+
+        TEST_METHOD(TestGrow) {
+            atlas_t atlas(8, 8, 0);
+
+            atlas_t::id_t ids[4];
+            for (unsigned i = 0; i < 4; ++i) {
+                ids[i] = insert(atlas, 4, 4, 0xFF000000u + i);
+            }
+            Assert::AreEqual(size_t(1), atlas.pages().size());
+
+            atlas.clean();
+            Assert::IsFalse(atlas.pages()[0].is_dirty);
+
+            // the first page is full; a second is started and nothing moves.
+            auto const e = insert(atlas, 4, 4, 0xFF0000FFu);
+            Assert::AreEqual(size_t(2), atlas.pages().size());
+            Assert::AreEqual(1u, atlas.get(e).page);
+            Assert::IsTrue(is_filled(atlas, atlas.get(e), 0xFF0000FFu));
+            Assert::AreEqual(0u, atlas.generation());
+
+            Assert::IsFalse(atlas.pages()[0].is_dirty);
+            Assert::IsTrue(atlas.pages()[1].is_dirty);
+
+            for (unsigned i = 0; i < 4; ++i) {
+                Assert::AreEqual(0u, atlas.get(ids[i]).page);
+                Assert::IsTrue(is_filled(atlas, atlas.get(ids[i]), 0xFF000000u + i));
+            }
+        }
+
+        TEST_METHOD(TestRepack) {
+            atlas_t atlas(8, 8, 0);
+
+            atlas_t::id_t ids[4];
+            for (unsigned i = 0; i < 4; ++i) {
+                ids[i] = insert(atlas, 4, 4, 0xFF000000u + i);
+            }
+
+            // the last two images, as a renderer would have cached them.
+            auto const generation = atlas.generation();
+            location const old_c = atlas.get(ids[2]);
+            location const old_d = atlas.get(ids[3]);
+
+            // half the page is holes, so the next insert repacks rather than
+            // starting a page.
+            atlas.remove(ids[0]);
+            atlas.remove(ids[1]);
+            Assert::AreEqual(generation, atlas.generation());
+
+            auto const e = insert(atlas, 4, 4, 0xFF0000FFu);
+            Assert::AreEqual(size_t(1), atlas.pages().size());
+            Assert::IsTrue(is_filled(atlas, atlas.get(e), 0xFF0000FFu));
+
+            // the cached locations are stale, which the generation tells.
+            Assert::IsTrue(atlas.generation() != generation);
+
+            auto const& c = atlas.get(ids[2]);
+            auto const& d = atlas.get(ids[3]);
+            Assert::IsTrue(c.rect.top != old_c.rect.top || c.rect.left != old_c.rect.left);
+            Assert::IsTrue(d.rect.top != old_d.rect.top || d.rect.left != old_d.rect.left);
+
+            // the pixels moved with them.
+            Assert::AreEqual(4, c.rect.width());
+            Assert::AreEqual(4, d.rect.height());
+            Assert::IsTrue(is_filled(atlas, c, 0xFF000002u));
+            Assert::IsTrue(is_filled(atlas, d, 0xFF000003u));
+        }
+	};
+	TEST_CLASS(MipmapTest) {
+	public:
+        TEST_METHOD(TestLevels) {
+            Assert::AreEqual(0u, bklib::gfx::mip_levels(1, 1));
+            Assert::AreEqual(1u, bklib::gfx::mip_levels(2, 1));
+            Assert::AreEqual(8u, bklib::gfx::mip_levels(256, 3));
+
+            Assert::AreEqual(1u, bklib::gfx::mip_extent(3, 5));
+            Assert::AreEqual(size_t(0), bklib::gfx::mip_offset(8, 4, 1));
+            Assert::AreEqual(size_t(4*2*4 + 2*1*4 + 1*1*4), bklib::gfx::mip_offset(8, 4, 4));
+        }
+
+        TEST_METHOD(TestBox) {
+            // 10 x 3: the odd row and both halves of the SIMD and scalar paths.
+            unsigned const w = 10;
+            unsigned const h = 3;
+
+            std::vector<uint8_t> image(w * h * 4);
+            for (size_t i = 0; i < image.size(); ++i) {
+                image[i] = static_cast<uint8_t>(i * 37);
+            }
+
+            auto const n = bklib::gfx::mip_levels(w, h);
+            std::vector<uint8_t> mips(bklib::gfx::mip_offset(w, h, n + 1));
+            bklib::gfx::build_mips(image.data(), w, h, w * 4, mips.data());
+
+            // level 1 is 5 x 1 from rows 0 and 1.
+            for (unsigned x = 0; x < 5; ++x) {
+                for (unsigned c = 0; c < 4; ++c) {
+                    auto const at = [&](unsigned px, unsigned py) {
+                        return static_cast<unsigned>(image[(py * w + px) * 4 + c]);
+                    };
+
+                    auto const expected = (at(2*x, 0) + at(2*x + 1, 0) + at(2*x, 1) + at(2*x + 1, 1) + 2) / 4;
+                    Assert::AreEqual(expected, static_cast<unsigned>(mips[x * 4 + c]));
+                }
+            }
+        }
+
+        TEST_METHOD(TestSrgbFlat) {
+            // a flat image stays the same color however it is filtered.
+            std::vector<uint8_t> image(16 * 16 * 4);
+            for (size_t i = 0; i < image.size(); i += 4) {
+                image[i + 0] = 10;
+                image[i + 1] = 128;
+                image[i + 2] = 250;
+                image[i + 3] = 77;
+            }
+
+            auto const n = bklib::gfx::mip_levels(16, 16);
+            std::vector<uint8_t> mips(bklib::gfx::mip_offset(16, 16, n + 1));
+            bklib::gfx::build_mips(image.data(), 16, 16, 16 * 4, mips.data(), bklib::gfx::mip_filter::srgb_box);
+
+            for (size_t i = 0; i < mips.size(); ++i) {
+                Assert::AreEqual(image[i % 4], mips[i]);
+            }
+        }
+
+        TEST_METHOD(TestUpdateLevels) {
+            // odd sizes, so that some levels drop a column or row, and a 1
+            // texel high tail.
+            unsigned const w = 37;
+            unsigned const h = 11;
+            auto const n = bklib::gfx::mip_levels(w, h);
+
+            bklib::gfx::texel_rect const regions[] = {
+                bklib::gfx::texel_rect(5, 3, 20, 9),
+                bklib::gfx::texel_rect(36, 10, 37, 11), // dropped from level 1.
+                bklib::gfx::texel_rect(0, 0, 1, 1),
+                bklib::gfx::texel_rect(0, 0, 37, 11),
+            };
+
+            bklib::gfx::mip_filter const filters[] = {
+                bklib::gfx::mip_filter::box, bklib::gfx::mip_filter::srgb_box,
+            };
+
+            for (auto filter : filters) {
+                for (auto const& region : regions) {
+                    std::vector<uint8_t> image(w * h * 4);
+                    for (size_t i = 0; i < image.size(); ++i) {
+                        image[i] = static_cast<uint8_t>(i * 37);
+                    }
+
+                    std::vector<uint8_t> mips(bklib::gfx::mip_offset(w, h, n + 1));
+                    bklib::gfx::build_mips(image.data(), w, h, w * 4, mips.data(), filter);
+
+                    for (auto y = region.top; y < region.bottom; ++y) {
+                        for (auto x = region.left * 4; x < region.right * 4; ++x) {
+                            image[y * w * 4 + x] ^= 0x5A;
+                        }
+                    }
+
+                    // a level at a time, from the image down.
+                    auto changed = region;
+                    for (unsigned l = 1; l <= n; ++l) {
+                        auto const above = l == 1 ? image.data() : mips.data() + bklib::gfx::mip_offset(w, h, l - 1);
+                        auto const above_w = bklib::gfx::mip_extent(w, l - 1);
+
+                        changed = bklib::gfx::update_mip_level(
+                            above, above_w, bklib::gfx::mip_extent(h, l - 1), above_w * 4,
+                            changed,
+                            mips.data() + bklib::gfx::mip_offset(w, h, l), bklib::gfx::mip_extent(w, l) * 4,
+                            filter
+                        );
+                    }
+
+                    std::vector<uint8_t> expected(mips.size());
+                    bklib::gfx::build_mips(image.data(), w, h, w * 4, expected.data(), filter);
+                    Assert::IsTrue(mips == expected);
+                }
+            }
+        }
+	};
+
+	TEST_CLASS(SoftwareRendererTest) {
+	public:
+        typedef bklib::gfx2d::rect  rect;
+        typedef bklib::gfx2d::color color;
+
+        TEST_METHOD(TestFillAndClip) {
+            bklib::gfx2d::framebuffer target(16, 8);
+            bklib::gfx2d::renderer renderer(target);
+
+            renderer.draw_begin();
+            renderer.clear(color(1.0f, 0.0f, 0.0f));
+
+            auto const brush = renderer.create_solid_brush(color(0.0f, 0.0f, 1.0f));
+
+            renderer.push_clip_rect(rect(0.0f, 0.0f, 8.0f, 8.0f));
+            renderer.translate(2.0f, 1.0f);
+            renderer.fill_rect(rect(0.0f, 0.0f, 10.0f, 2.0f), *brush);
+            renderer.pop_clip_rect();
+
+            renderer.draw_end();
+
+            for (unsigned y = 0; y < 8; ++y) {
+                for (unsigned x = 0; x < 16; ++x) {
+                    auto const in = x >= 2 && x < 8 && y >= 1 && y < 3;
+                    Assert::AreEqual(in ? 0xFF0000FFu : 0xFFFF0000u, target.pixel(x, y));
+                }
+            }
+        }
+
+        TEST_METHOD(TestBlend) {
+            bklib::gfx2d::framebuffer target(4, 1);
+            bklib::gfx2d::renderer renderer(target);
+
+            renderer.draw_begin();
+            renderer.clear(color(0.0f, 0.0f, 0.0f));
+
+            auto const brush = renderer.create_solid_brush(color(1.0f, 1.0f, 1.0f, 0.5f));
+            renderer.fill_rect(rect(0.0f, 0.0f, 4.0f, 1.0f), *brush);
+            renderer.draw_end();
+
+            Assert::AreEqual(0xFF808080u, target.pixel(3, 0));
+        }
+
+        TEST_METHOD(TestTexture) {
+            uint32_t const texels[] = {
+                0x01, 0x02, 0x03, 0x04,
+                0x05, 0x06, 0x07, 0x08,
+            };
+
+            bklib::gfx2d::framebuffer target(8, 4);
+            bklib::gfx2d::renderer renderer(target);
+
+            auto const tex = renderer.create_texture(4, 2, texels);
+
+            renderer.draw_begin();
+            renderer.clear(color(0.0f, 0.0f, 0.0f));
+            renderer.draw_texture(tex, rect(1.0f, 0.0f, 3.0f, 2.0f), rect(0.0f, 0.0f, 4.0f, 4.0f));
+            renderer.draw_end();
+
+            // magnified 2x, nearest neighbour, drawn opaque.
+            for (unsigned y = 0; y < 4; ++y) {
+                for (unsigned x = 0; x < 4; ++x) {
+                    Assert::AreEqual(texels[(y / 2) * 4 + 1 + x / 2] | 0xFF000000u, target.pixel(x, y));
+                }
+            }
+
+            Assert::AreEqual(0xFF000000u, target.pixel(4, 0));
+        }
+
+        TEST_METHOD(TestSprites) {
+            uint32_t const texels[] = {0xFF204060, 0xFFFFFFFF};
+
+            bklib::gfx2d::framebuffer target(3, 1);
+            bklib::gfx2d::renderer renderer(target);
+
+            auto const tex = renderer.create_texture(2, 1, texels);
+
+            bklib::gfx2d::sprite const sprites[] = {
+                bklib::gfx2d::sprite(rect(0.0f, 0.0f, 1.0f, 1.0f), rect(0.0f, 0.0f, 1.0f, 1.0f)),
+                bklib::gfx2d::sprite(rect(1.0f, 0.0f, 2.0f, 1.0f), rect(1.0f, 0.0f, 2.0f, 1.0f), color(1.0f, 0.0f, 0.0f)),
+                bklib::gfx2d::sprite(rect(1.0f, 0.0f, 2.0f, 1.0f), rect(2.0f, 0.0f, 3.0f, 1.0f), color(1.0f, 1.0f, 1.0f, 0.5f)),
+            };
+
+            renderer.draw_begin();
+            renderer.clear(color(0.0f, 0.0f, 0.0f));
+            renderer.draw_sprites(tex, sprites, 3);
+            renderer.draw_end();
+
+            Assert::AreEqual(0xFF204060u, target.pixel(0, 0));
+            Assert::AreEqual(0xFFFF0000u, target.pixel(1, 0));
+            Assert::AreEqual(0xFF808080u, target.pixel(2, 0));
+        }
+
+        TEST_METHOD(TestTextureHandles) {
+            uint32_t const a_texels[] = {0xFF0000FF, 0xFF0000FF};
+            uint32_t const b_texels[] = {0xFF00FF00, 0xFF00FF00};
+            uint32_t const update[]   = {0xFFFF0000};
+
+            bklib::gfx2d::framebuffer target(4, 1);
+            bklib::gfx2d::renderer renderer(target);
+
+            auto const a = renderer.create_texture(2, 1, a_texels);
+            auto const b = renderer.create_texture(2, 1, b_texels);
+
+            renderer.update_texture_region(b, bklib::gfx2d::texel_rect(1, 0, 2, 1), update);
+
+            renderer.draw_begin();
+            renderer.clear(color(0.0f, 0.0f, 0.0f));
+            renderer.draw_texture(a, rect(0.0f, 0.0f, 2.0f, 1.0f), rect(0.0f, 0.0f, 2.0f, 1.0f));
+            renderer.draw_texture(b, rect(0.0f, 0.0f, 2.0f, 1.0f), rect(2.0f, 0.0f, 4.0f, 1.0f));
+            renderer.draw_end();
+
+            Assert::AreEqual(0xFF0000FFu, target.pixel(0, 0));
+            Assert::AreEqual(0xFF0000FFu, target.pixel(1, 0));
+            Assert::AreEqual(0xFF00FF00u, target.pixel(2, 0));
+            Assert::AreEqual(0xFFFF0000u, target.pixel(3, 0));
+
+            renderer.destroy_texture(a);
+
+            auto const c = renderer.create_texture(2, 1, b_texels);
+            Assert::IsFalse(a.index == c.index && a.count == c.count);
+
+            Assert::ExpectException<bklib::cache_exception>([&] {
+                renderer.draw_texture(a, rect(0.0f, 0.0f, 2.0f, 1.0f), rect(0.0f, 0.0f, 2.0f, 1.0f));
+            });
+        }
+
+        TEST_METHOD(TestDamage) {
+            uint32_t const texels[] = {0xFFFFFFFF};
+
+            bklib::gfx2d::framebuffer target(4, 1);
+            bklib::gfx2d::renderer renderer(target);
+
+            renderer.draw_begin();
+            renderer.clear(color(0.0f, 0.0f, 0.0f));
+            renderer.draw_end();
+
+            auto const tex = renderer.create_texture(1, 1, texels);
+            renderer.destroy_texture(tex);
+
+            auto const brush = renderer.create_solid_brush(color(0.0f, 1.0f, 0.0f));
+
+            renderer.draw_begin(bklib::gfx2d::region(rect(1.0f, 0.0f, 3.0f, 1.0f)));
+            renderer.clear(color(1.0f, 0.0f, 0.0f));
+            renderer.translate(2.0f, 0.0f);
+            renderer.fill_rect(rect(0.0f, 0.0f, 2.0f, 1.0f), *brush);
+            renderer.draw_end();
+
+            Assert::AreEqual(0xFF000000u, target.pixel(0, 0));
+            Assert::AreEqual(0xFFFF0000u, target.pixel(1, 0));
+            Assert::AreEqual(0xFF00FF00u, target.pixel(2, 0));
+            Assert::AreEqual(0xFF000000u, target.pixel(3, 0));
+
+            // a stale handle throws whether or not the draw is culled.
+            bklib::gfx2d::sprite const outside(rect(0.0f, 0.0f, 1.0f, 1.0f), rect(3.0f, 0.0f, 4.0f, 1.0f));
+
+            renderer.draw_begin(bklib::gfx2d::region(rect(1.0f, 0.0f, 3.0f, 1.0f)));
+            Assert::ExpectException<bklib::cache_exception>([&] {
+                renderer.draw_texture(tex, rect(0.0f, 0.0f, 1.0f, 1.0f), rect(1.0f, 0.0f, 2.0f, 1.0f));
+            });
+            Assert::ExpectException<bklib::cache_exception>([&] {
+                renderer.draw_texture(tex, outside.src, outside.dest);
+            });
+            Assert::ExpectException<bklib::cache_exception>([&] {
+                renderer.draw_sprites(tex, &outside, 1);
+            });
+            renderer.draw_end();
+        }
+
+        TEST_METHOD(TestUpdateTextureMips) {
+            unsigned const w = 8, h = 8;
+            auto const n = bklib::gfx::mip_levels(w, h);
+
+            std::vector<uint32_t> image(w * h);
+            for (size_t i = 0; i < image.size(); ++i) {
+                image[i] = static_cast<uint32_t>(i * 0x01030507u) | 0xFF000000u;
+            }
+
+            std::vector<uint8_t> mips(bklib::gfx::mip_offset(w, h, n + 1));
+            bklib::gfx::build_mips(image.data(), w, h, w * 4, mips.data());
+
+            bklib::gfx2d::framebuffer target(4, 1);
+            bklib::gfx2d::renderer renderer(target);
+
+            auto const tex = renderer.create_texture(w, h, image.data(), n, mips.data());
+
+            // shrunk to 1 x 1 and to 2 x 2, so that levels 3 and 2 are drawn.
+            auto const draw = [&](bklib::gfx2d::texture_handle t, float x) {
+                renderer.draw_texture(t, rect(0.0f, 0.0f, 8.0f, 8.0f), rect(x, 0.0f, x + 1.0f, 1.0f));
+                renderer.draw_texture(t, rect(4.0f, 4.0f, 8.0f, 8.0f), rect(x + 2.0f, 0.0f, x + 3.0f, 1.0f));
+            };
+
+            renderer.draw_begin();
+            draw(tex, 0.0f);
+            renderer.draw_end();
+
+            auto const before_level3 = target.pixel(0, 0);
+            auto const before_level2 = target.pixel(2, 0);
+
+            // a 2x2 block in the lower right quarter.
+            uint32_t const update[] = {0xFF102030, 0xFF405060, 0xFF708090, 0xFFA0B0C0};
+            renderer.update_texture_region(tex, bklib::gfx2d::texel_rect(4, 6, 6, 8), update);
+
+            for (unsigned i = 0; i < 4; ++i) {
+                image[(6 + i / 2) * w + 4 + i % 2] = update[i];
+            }
+
+            bklib::gfx::build_mips(image.data(), w, h, w * 4, mips.data());
+            auto const expected = renderer.create_texture(w, h, image.data(), n, mips.data());
+
+            renderer.draw_begin();
+            draw(tex, 0.0f);
+            draw(expected, 1.0f);
+            renderer.draw_end();
+
+            Assert::IsTrue(target.pixel(0, 0) != before_level3);
+            Assert::IsTrue(target.pixel(2, 0) != before_level2);
+            Assert::AreEqual(target.pixel(1, 0), target.pixel(0, 0));
+            Assert::AreEqual(target.pixel(3, 0), target.pixel(2, 0));
+        }
+
+        TEST_METHOD(TestUpdateTextureBounds) {
+            uint32_t const texels[4] = {};
+            uint32_t const update[4] = {};
+
+            bklib::gfx2d::framebuffer target(1, 1);
+            bklib::gfx2d::renderer renderer(target);
+
+            auto const tex = renderer.create_texture(2, 2, texels);
+
+            bklib::gfx2d::texel_rect const bad[] = {
+                bklib::gfx2d::texel_rect(1, 0, 0, 1), // right before left
+                bklib::gfx2d::texel_rect(0, 1, 1, 0), // bottom above top
+                bklib::gfx2d::texel_rect(-1, 0, 1, 1),
+                bklib::gfx2d::texel_rect(1, 1, 3, 2),
+                bklib::gfx2d::texel_rect(0, 1, 1, 3),
+            };
+
+            for (auto const& r : bad) {
+                Assert::ExpectException<bklib::gfx2d::renderer_exception>([&] {
+                    renderer.update_texture_region(tex, r, update);
+                });
+            }
+
+            // empty but in bounds is fine.
+            renderer.update_texture_region(tex, bklib::gfx2d::texel_rect(2, 2, 2, 2), update);
+            renderer.update_texture_region(tex, bklib::gfx2d::texel_rect(0, 0, 2, 2), update);
+        }
+	};
+	TEST_CLASS(CommandListTest) {
+	public:
+        typedef bklib::gfx2d::rect  rect;
+        typedef bklib::gfx2d::color color;
+
+        TEST_METHOD(TestReplayMatchesImmediate) {
+            color const red(1.0f, 0.0f, 0.0f);
+            color const blue(0.0f, 0.0f, 1.0f, 0.5f);
+
+            bklib::gfx2d::framebuffer expected(16, 8);
+            bklib::gfx2d::framebuffer actual(16, 8);
+
+            bklib::gfx2d::renderer immediate(expected);
+            bklib::gfx2d::renderer replayed(actual);
+
+            auto& brush = immediate.get_solid_brush();
+            bklib::gfx2d::command_list list;
+
+            immediate.draw_begin();
+            immediate.clear(color(0.0f, 0.0f, 0.0f));
+
+            // alternating colors; the overlapping pair must keep its order.
+            for (int i = 0; i < 4; ++i) {
+                auto const r = rect(i * 4.0f, 0.0f, i * 4.0f + 3.0f, 3.0f);
+                auto const& c = (i % 2) ? red : blue;
+
+                brush.set_color(c);
+                immediate.fill_rect(r, brush);
+                list.fill_rect(r, c);
+            }
+
+            immediate.push_transform(bklib::gfx2d::matrix::translation(1.0f, 4.0f));
+            list.push_transform(bklib::gfx2d::matrix::translation(1.0f, 4.0f));
+
+            brush.set_color(blue);
+            immediate.fill_rect(rect(0.0f, 0.0f, 6.0f, 3.0f), brush);
+            list.fill_rect(rect(0.0f, 0.0f, 6.0f, 3.0f), blue);
+
+            brush.set_color(red);
+            immediate.fill_rect(rect(2.0f, 1.0f, 8.0f, 4.0f), brush);
+            list.fill_rect(rect(2.0f, 1.0f, 8.0f, 4.0f), red);
+
+            brush.set_color(blue);
+            immediate.fill_rect(rect(4.0f, 0.0f, 10.0f, 2.0f), brush);
+            list.fill_rect(rect(4.0f, 0.0f, 10.0f, 2.0f), blue);
+
+            immediate.pop_transform();
+            list.pop_transform();
+
+            immediate.draw_end();
+
+            // twice, to use the cached order.
+            for (int i = 0; i < 2; ++i) {
+                replayed.draw_begin();
+                replayed.clear(color(0.0f, 0.0f, 0.0f));
+                list.replay(replayed);
+                replayed.draw_end();
+
+                for (unsigned y = 0; y < 8; ++y) {
+                    for (unsigned x = 0; x < 16; ++x) {
+                        Assert::AreEqual(expected.pixel(x, y), actual.pixel(x, y));
+                    }
+                }
+            }
+        }
+	};
 }
\ No newline at end of file